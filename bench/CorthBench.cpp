@@ -0,0 +1,226 @@
+// Compiler throughput benchmark
+// Generates synthetic Corth programs of increasing size, compiles each of
+//   them with `Corth -gen -time-json`, and reports tokens per second for every
+//   compiler phase. Any phase whose time grows faster than the size of its
+//   input is flagged, as is any program that crashes the compiler.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <filesystem>
+
+#ifndef CORTH_EXECUTABLE
+#define CORTH_EXECUTABLE "Corth"
+#endif
+
+namespace CorthBench {
+    // How much slower a phase may get per doubling of the input before it counts as superlinear.
+    // Linear scaling doubles the time; anything above this is flagged.
+    const double SUPERLINEAR_RATIO = 3.0;
+    // Phases quicker than this are too noisy to judge scaling from.
+    const double MIN_MEASURABLE_SECONDS = 0.005;
+
+    struct Shape {
+        std::string name;
+        std::string description;
+        // Write a program of roughly `tokens` tokens.
+        std::function<void(std::ostream&, uint64_t tokens)> generate;
+    };
+
+    struct Measurement {
+        uint64_t tokens = 0;
+        std::map<std::string, double> phase_seconds;
+        bool crashed = false;
+    };
+
+    // Long runs of straight-line arithmetic: `1 2 + 3 * #` (6 tokens)
+    void GenerateArithmetic(std::ostream& out, uint64_t tokens) {
+        for (uint64_t i = 0; i < tokens / 6; i++) {
+            out << i % 100 << ' ' << (i + 1) % 100 << " + 3 * #\n";
+        }
+    }
+
+    // `if` blocks nested as deep as they go: `1 if` ... `endif` (3 tokens per level)
+    void GenerateNestedIf(std::ostream& out, uint64_t tokens) {
+        uint64_t depth = tokens / 3;
+        for (uint64_t i = 0; i < depth; i++) { out << "1 if\n"; }
+        for (uint64_t i = 0; i < depth; i++) { out << "endif\n"; }
+    }
+
+    // `while` loops nested as deep as they go: `while 0 do` ... `endwhile` (4 tokens per level)
+    void GenerateNestedWhile(std::ostream& out, uint64_t tokens) {
+        uint64_t depth = tokens / 4;
+        for (uint64_t i = 0; i < depth; i++) { out << "while 0 do\n"; }
+        for (uint64_t i = 0; i < depth; i++) { out << "endwhile\n"; }
+    }
+
+    // A huge table of distinct string literals: `"string N\n" dump_s` (2 tokens)
+    void GenerateStrings(std::ostream& out, uint64_t tokens) {
+        for (uint64_t i = 0; i < tokens / 2; i++) {
+            out << "\"string literal number " << i << "\\n\" dump_s\n";
+        }
+    }
+
+    // Pull the phases of the first compilation out of a `-time-json` report.
+    bool ReadTimingReport(const std::string& path, Measurement& measurement) {
+        std::ifstream file(path);
+        if (!file) { return false; }
+        std::stringstream contents;
+        contents << file.rdbuf();
+        std::string json = contents.str();
+
+        size_t position = 0;
+        const std::string name_key = "\"name\": \"";
+        const std::string seconds_key = "\"seconds\": ";
+        while ((position = json.find(name_key, position)) != std::string::npos) {
+            position += name_key.size();
+            size_t name_end = json.find('"', position);
+            std::string name = json.substr(position, name_end - position);
+            size_t seconds = json.find(seconds_key, name_end);
+            if (seconds == std::string::npos) { return false; }
+            measurement.phase_seconds[name] += strtod(json.c_str() + seconds + seconds_key.size(), nullptr);
+            position = seconds;
+        }
+
+        size_t tokens = json.find("\"tokens\": ");
+        if (tokens == std::string::npos) { return false; }
+        measurement.tokens = strtoull(json.c_str() + tokens + 10, nullptr, 10);
+        return true;
+    }
+
+    Measurement Measure(const Shape& shape, uint64_t tokens, const std::filesystem::path& work_dir) {
+        Measurement measurement;
+        std::filesystem::path source = work_dir / (shape.name + "_" + std::to_string(tokens) + ".corth");
+        std::filesystem::path report = work_dir / "timing.json";
+        std::filesystem::path output = work_dir / "bench_program";
+        {
+            std::ofstream out(source);
+            shape.generate(out, tokens);
+        }
+        std::filesystem::remove(report);
+
+        #ifdef _WIN64
+        std::string platform = "-win";
+        std::string null_device = "NUL";
+        #else
+        std::string platform = "-linux";
+        std::string null_device = "/dev/null";
+        #endif
+        std::string cmd = std::string("\"") + CORTH_EXECUTABLE + "\" " + platform + " -GAS -gen"
+            + " -o \"" + output.string() + "\""
+            + " -time-json \"" + report.string() + "\""
+            + " \"" + source.string() + "\" >" + null_device + " 2>&1";
+        int result = system(cmd.c_str());
+        if (result != 0 || !ReadTimingReport(report.string(), measurement)) {
+            measurement.crashed = true;
+        }
+        std::filesystem::remove(source);
+        return measurement;
+    }
+
+    void PrintUsage() {
+        printf("\n%s\n", "Usage: `corth_bench <options>`");
+        printf("    %s\n", "Options:");
+        printf("        %s\n", "-t, --tokens <count>  | Size of the largest generated program in tokens. (default: 1000000)");
+        printf("        %s\n", "-s, --steps <count>   | How many sizes to measure; each is half of the next. (default: 4)");
+        printf("        %s\n", "--huge                | Same as `-t 10000000`.");
+        printf("        %s\n", "--shape <name>        | Only run the given program shape (arithmetic, nested_if, nested_while, strings).");
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace CorthBench;
+
+    uint64_t max_tokens = 1000000;
+    unsigned steps = 4;
+    std::string only_shape;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "--tokens") && i + 1 < argc) {
+            max_tokens = strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((arg == "-s" || arg == "--steps") && i + 1 < argc) {
+            steps = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--huge") {
+            max_tokens = 10000000;
+        }
+        else if (arg == "--shape" && i + 1 < argc) {
+            only_shape = argv[++i];
+        }
+        else {
+            PrintUsage();
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    if (steps == 0 || max_tokens >> (steps - 1) < 64) {
+        printf("[ERR]: Too many steps for a program of %llu tokens\n", (unsigned long long)max_tokens);
+        return 1;
+    }
+
+    std::vector<Shape> shapes = {
+        { "arithmetic",   "straight-line arithmetic",         GenerateArithmetic },
+        { "nested_if",    "deeply nested `if` blocks",        GenerateNestedIf },
+        { "nested_while", "deeply nested `while` loops",      GenerateNestedWhile },
+        { "strings",      "huge table of string literals",    GenerateStrings },
+    };
+    const std::vector<std::string> phases = {
+        "Lex", "ValidateTokens_Stack", "ValidateTokens_Blocks", "Codegen"
+    };
+
+    std::filesystem::path work_dir = std::filesystem::temp_directory_path() / "corth_bench";
+    std::filesystem::create_directories(work_dir);
+    printf("[LOG]: Benchmarking %s\n", CORTH_EXECUTABLE);
+
+    bool problems = false;
+    for (auto& shape : shapes) {
+        if (!only_shape.empty() && shape.name != only_shape) { continue; }
+        printf("\n[BENCH]: %s (%s)\n", shape.name.c_str(), shape.description.c_str());
+        printf("    %10s", "Tokens");
+        for (auto& phase : phases) { printf(" %22s", phase.c_str()); }
+        printf("   (tokens/sec)\n");
+
+        Measurement previous;
+        for (unsigned step = 0; step < steps; step++) {
+            uint64_t tokens = max_tokens >> (steps - 1 - step);
+            Measurement measurement = Measure(shape, tokens, work_dir);
+            if (measurement.crashed) {
+                printf("    %10llu   [FAIL] Corth exited abnormally\n", (unsigned long long)tokens);
+                problems = true;
+                break;
+            }
+
+            printf("    %10llu", (unsigned long long)measurement.tokens);
+            std::vector<std::string> superlinear;
+            for (auto& phase : phases) {
+                double seconds = measurement.phase_seconds[phase];
+                printf(" %22.0f", seconds > 0 ? measurement.tokens / seconds : 0.0);
+
+                double previous_seconds = previous.phase_seconds[phase];
+                if (previous.tokens && previous_seconds > MIN_MEASURABLE_SECONDS) {
+                    double size_ratio = (double)measurement.tokens / previous.tokens;
+                    if (seconds / previous_seconds > SUPERLINEAR_RATIO * size_ratio / 2) {
+                        superlinear.push_back(phase);
+                    }
+                }
+            }
+            printf("\n");
+            for (auto& phase : superlinear) {
+                printf("    [WRN]: %s scales superlinearly: %.3f ms -> %.3f ms\n", phase.c_str(),
+                       previous.phase_seconds[phase] * 1000, measurement.phase_seconds[phase] * 1000);
+                problems = true;
+            }
+            previous = measurement;
+        }
+    }
+
+    std::filesystem::remove_all(work_dir);
+    return problems ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+// Runtime benchmark of generated code
+// Compiles the example programs and the kernels in `bench/kernels` through
+//   every Linux backend (NASM and GAS), runs each executable repeatedly with
+//   its output discarded, and reports the median wall time, cycles,
+//   instructions, IPC and branch misses as counted by `perf_event_open`.
+// Counters are user-space only, so that they work without elevated privileges.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+
+#ifndef CORTH_EXECUTABLE
+#define CORTH_EXECUTABLE "Corth"
+#endif
+
+#ifndef CORTH_SOURCE_DIR
+#define CORTH_SOURCE_DIR "."
+#endif
+
+namespace CorthRuntimeBench {
+    enum class Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        COUNT
+    };
+
+    struct Sample {
+        double seconds = 0;
+        uint64_t counters[static_cast<int>(Counter::COUNT)] = {};
+    };
+
+    struct Backend {
+        std::string name;
+        // Tool that has to be installed for this backend to be benchmarked.
+        std::string tool;
+        // Corth arguments that produce an executable at `exe_path`.
+        std::string (*arguments)(const std::string& exe_path);
+    };
+
+    std::string NasmArguments(const std::string& exe_path) {
+        return "-linux -NASM -o \"" + exe_path + "\" -add-lo \"-o " + exe_path + "\"";
+    }
+
+    std::string GasArguments(const std::string& exe_path) {
+        return "-linux -GAS -o \"" + exe_path + "\" -add-ao \"-o " + exe_path + "\"";
+    }
+
+    bool ToolExists(const std::string& name) {
+        const char* path = getenv("PATH");
+        if (!path) { return false; }
+        std::string directories = path;
+        size_t start = 0;
+        while (start <= directories.size()) {
+            size_t end = directories.find(':', start);
+            if (end == std::string::npos) { end = directories.size(); }
+            std::string candidate = directories.substr(start, end - start) + "/" + name;
+            if (access(candidate.c_str(), X_OK) == 0) { return true; }
+            start = end + 1;
+        }
+        return false;
+    }
+
+    int OpenCounter(pid_t pid, uint64_t config, int group_fd) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // The group leader starts counting once the child calls exec, and every member with it.
+        attr.disabled = group_fd == -1;
+        attr.enable_on_exec = group_fd == -1;
+        return (int)syscall(SYS_perf_event_open, &attr, pid, -1, group_fd, 0);
+    }
+
+    // Run an executable once from `work_dir` with its output discarded.
+    // `counted` is cleared if hardware counters are unavailable; the wall time is always measured.
+    bool RunOnce(const std::string& exe_path, const std::string& work_dir, Sample& sample, bool& counted) {
+        int go[2];
+        if (pipe(go) != 0) { return false; }
+        pid_t pid = fork();
+        if (pid < 0) { return false; }
+        if (pid == 0) {
+            // Wait until the parent has attached the counters.
+            close(go[1]);
+            char c;
+            while (read(go[0], &c, 1) < 0 && errno == EINTR) {}
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            if (chdir(work_dir.c_str()) != 0) { _exit(127); }
+            execl(exe_path.c_str(), exe_path.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        close(go[0]);
+
+        const uint64_t configs[] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        static_assert(sizeof(configs) / sizeof(configs[0]) == static_cast<int>(Counter::COUNT),
+                      "Exhaustive handling of counters in RunOnce");
+        std::vector<int> fds;
+        if (counted) {
+            for (uint64_t config : configs) {
+                int fd = OpenCounter(pid, config, fds.empty() ? -1 : fds[0]);
+                if (fd < 0) {
+                    printf("[WRN]: perf_event_open failed (%s); only wall time will be reported.\n", strerror(errno));
+                    counted = false;
+                    break;
+                }
+                fds.push_back(fd);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (write(go[1], "x", 1) != 1) {}
+        close(go[1]);
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        sample.seconds = elapsed.count();
+
+        if (counted && fds.size() == static_cast<size_t>(Counter::COUNT)) {
+            // PERF_FORMAT_GROUP: { nr, values[nr] }
+            uint64_t values[1 + static_cast<int>(Counter::COUNT)] = {};
+            if (read(fds[0], values, sizeof(values)) == (ssize_t)sizeof(values)) {
+                for (int i = 0; i < static_cast<int>(Counter::COUNT); i++) {
+                    sample.counters[i] = values[1 + i];
+                }
+            }
+        }
+        for (int fd : fds) { close(fd); }
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    template <typename T>
+    T Median(std::vector<T> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    void PrintUsage() {
+        printf("\n%s\n", "Usage: `corth_runtime_bench <options> [program names...]`");
+        printf("    %s\n", "Options:");
+        printf("        %s\n", "-r, --runs <count>  | How many times to run each executable. (default: 11)");
+        printf("    %s\n", "Program names select which programs to run (i.e. `rule110 memfill`); by default, all of them.");
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace CorthRuntimeBench;
+
+    unsigned runs = 11;
+    std::vector<std::string> filter;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-r" || arg == "--runs") && i + 1 < argc) {
+            runs = std::max(1ul, strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "-h" || arg == "--help") {
+            PrintUsage();
+            return 0;
+        }
+        else if (arg[0] == '-') {
+            PrintUsage();
+            return 1;
+        }
+        else {
+            filter.push_back(arg);
+        }
+    }
+
+    std::filesystem::path source_dir = CORTH_SOURCE_DIR;
+    std::vector<std::filesystem::path> programs = {
+        source_dir / "examples" / "rule110.corth",
+        source_dir / "examples" / "fizzbuzz.corth",
+    };
+    std::vector<std::filesystem::path> kernels;
+    for (auto& file : std::filesystem::directory_iterator(source_dir / "bench" / "kernels")) {
+        if (file.path().extension() == ".corth") { kernels.push_back(file.path()); }
+    }
+    std::sort(kernels.begin(), kernels.end());
+    programs.insert(programs.end(), kernels.begin(), kernels.end());
+
+    std::vector<Backend> backends = {
+        { "NASM", "nasm", NasmArguments },
+        { "GAS",  "gcc",  GasArguments },
+    };
+
+    std::filesystem::path work_dir = std::filesystem::temp_directory_path() / "corth_runtime_bench";
+    std::filesystem::create_directories(work_dir);
+
+    printf("[LOG]: Benchmarking code generated by %s, median of %u runs\n", CORTH_EXECUTABLE, runs);
+    printf("%-14s %-5s %12s %16s %16s %7s %14s\n",
+           "Program", "Asm", "Wall time", "Cycles", "Instructions", "IPC", "Branch misses");
+
+    bool counted = true;
+    bool failed = false;
+    for (auto& backend : backends) {
+        if (!ToolExists(backend.tool)) {
+            printf("[WRN]: `%s` not found; skipping the %s backend.\n", backend.tool.c_str(), backend.name.c_str());
+            continue;
+        }
+        for (auto& program : programs) {
+            std::string name = program.stem().string();
+            if (!filter.empty() && std::find(filter.begin(), filter.end(), name) == filter.end()) { continue; }
+
+            std::string exe_path = (work_dir / (name + "_" + backend.name)).string();
+            std::string cmd = std::string("\"") + CORTH_EXECUTABLE + "\" " + backend.arguments(exe_path)
+                + " \"" + program.string() + "\" >/dev/null 2>&1";
+            if (system(cmd.c_str()) != 0) {
+                printf("%-14s %-5s [FAIL] Could not compile\n", name.c_str(), backend.name.c_str());
+                failed = true;
+                continue;
+            }
+
+            std::vector<double> seconds;
+            std::vector<uint64_t> counters[static_cast<int>(Counter::COUNT)];
+            bool ran = true;
+            for (unsigned run = 0; run < runs && ran; run++) {
+                Sample sample;
+                ran = RunOnce(exe_path, work_dir.string(), sample, counted);
+                seconds.push_back(sample.seconds);
+                for (int i = 0; i < static_cast<int>(Counter::COUNT); i++) {
+                    counters[i].push_back(sample.counters[i]);
+                }
+            }
+            if (!ran) {
+                printf("%-14s %-5s [FAIL] Program exited abnormally\n", name.c_str(), backend.name.c_str());
+                failed = true;
+                continue;
+            }
+
+            printf("%-14s %-5s %9.3f ms", name.c_str(), backend.name.c_str(), Median(seconds) * 1000);
+            if (counted) {
+                uint64_t cycles = Median(counters[static_cast<int>(Counter::CYCLES)]);
+                uint64_t instructions = Median(counters[static_cast<int>(Counter::INSTRUCTIONS)]);
+                printf(" %16llu %16llu %7.2f %14llu\n",
+                       (unsigned long long)cycles,
+                       (unsigned long long)instructions,
+                       cycles ? (double)instructions / cycles : 0.0,
+                       (unsigned long long)Median(counters[static_cast<int>(Counter::BRANCH_MISSES)]));
+            }
+            else {
+                printf(" %16s %16s %7s %14s\n", "-", "-", "-", "-");
+            }
+        }
+    }
+
+    std::filesystem::remove_all(work_dir);
+    return failed ? 1 : 0;
+}
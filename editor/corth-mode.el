@@ -42,12 +42,16 @@
 
 (eval-and-compile
   (defconst corth-keywords '("if" "else" "endif" "do" "while" "endwhile"
-							 "dup" "twodup"  "drop" "swap" "over" "mem"
+							 "dup" "twodup"  "drop" "swap" "over" "mem" "mem_grow"
 							 "loadb" "loadw" "loadd" "loadq"
 							 "storeb" "storew" "stored" "storeq"
 							 "dump" "dump_c" "dump_s"
 							 "shl" "shr" "or" "and" "mod"
-							 "write" "append" "open_file" "write_to_file" "close_file"
+							 "popcnt" "lzcnt" "tzcnt" "bswap" "rol" "ror" "pext" "pdep"
+							 "write" "append" "read" "open_file" "write_to_file" "close_file"
+							 "read_file" "read_block" "map_file" "unmap_file" "map_advise"
+							 "async_read" "async_write" "async_wait"
+							 "mem_fill" "mem_copy" "mem_compare" "mem_find_byte" "mem_find_any"
 							 "length_s")))
 
 (defconst corth-highlights
@@ -2,7 +2,10 @@
 #include <stdio.h>     // fopen_s
 #include <fstream>     // ofstream, ifstream
 #include <algorithm>   // remove_if
+#include <sstream>     // stringstream
 #include <stdlib.h>    // system, exit
+#include <string.h>    // strlen, memcpy
+#include <stdint.h>    // uint8_t, uint64_t
 
 // Custom headers
 #include "Errors.h"
@@ -11,57 +14,322 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <chrono>
+#include <memory>
+#include <future>
 
 // Platform specific includes
-#ifdef _WIN64
-#include <sstream>
-#else
-#endif
-
 #ifdef __linux__
 #include <unistd.h>
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap
+// The `MAP_FILE` flag is ignored by mmap, and its macro would clash with Keyword::MAP_FILE.
+#undef MAP_FILE
+#include <sys/stat.h>  // fstat
+#include <sys/wait.h>  // wait4
+#include <spawn.h>     // posix_spawnp
+#include <errno.h>
+#include <signal.h>    // SIGPIPE
+#include <sys/resource.h> // getrusage, wait4
+#include <sys/file.h>  // flock
+
+extern char** environ;
 #else
 #endif
 
 // TODO:
-// Make MEM_CAPACITY accessible through a CCLI option
 // Allow Corth programs to access argc and argv
 //   I believe argc can be found at rbp + 8:
 //     GAS: 8(%rbp) or NASM: [rbp + 8 * <argument-number>]
 
+#ifndef CORTH_VERSION
+#define CORTH_VERSION "0.0.1"
+#endif
+
 namespace Corth {
+    // Default size of `mem` in bytes.
     const unsigned int MEM_CAPACITY = 720000;
-    std::string SOURCE_PATH = "main.corth";
-    std::string OUTPUT_NAME = "corth_program";
-    std::string ASMB_PATH = "";
-    std::string LINK_PATH = "";
-    std::string ASMB_OPTS = "";
-    std::string LINK_OPTS = "";
-    std::string ASMB_NAME = "";
-    std::string LINK_NAME = "";
+    // Code addresses symbols in .bss with 32-bit displacements, so a larger `mem` has to be mapped at start-up.
+    const uint64_t MEM_BSS_LIMIT = 1ull << 30;
+    // Default for the most bytes a single `read_block` reads.
+    // Requests this large skip the FILE buffer and go straight to `read`.
+    const uint64_t READ_BLOCK_CAPACITY = 1 << 20;
 
     enum class MODE {
         COMPILE,
         GENERATE,
+        INTERPRET,
+        BYTECODE,
         COUNT
     };
-    MODE RUN_MODE = MODE::COMPILE;
 
     enum class PLATFORM {
         WIN64,
         LINUX64,
         COUNT
     };
-    PLATFORM RUN_PLATFORM = PLATFORM::WIN64;
 
     enum class ASM_SYNTAX {
         NASM,
         GAS,
         COUNT
     };
-    ASM_SYNTAX ASSEMBLY_SYNTAX = ASM_SYNTAX::NASM;
-    
-    bool verbose_logging = false;
+
+    // Instruction set extensions that generated code may use, as set by `-march`.
+    enum class CPU_FEATURE {
+        // x86-64-v2
+        POPCNT,
+        // x86-64-v3
+        LZCNT,
+        BMI1,
+        BMI2,
+        AVX2,
+        // x86-64-v4; detected and part of the target, but no generator uses it yet.
+        AVX512,
+        COUNT
+    };
+
+    struct PhaseTiming {
+        std::string name;
+        double seconds;
+        // Peak resident set size in KiB. For Corth's own phases this is the high-water mark of the
+        //   whole process when the phase ended (including earlier phases and other `-j` jobs),
+        //   not what the phase itself used; for the assembler and linker, that of the tool itself.
+        long peak_rss_kb;
+        bool peak_rss_of_tool;
+    };
+
+    // Filled in while compiling when `-time` or `-time-json` is given.
+    struct CompileStats {
+        std::vector<PhaseTiming> phases;
+        uint64_t tokens = 0;
+        uint64_t string_literals = 0;
+        uint64_t asm_bytes = 0;
+        uint64_t asm_instructions = 0;
+    };
+
+    // Everything that configures a single compilation.
+    // When compiling a batch of files, each one gets its own copy.
+    struct Context {
+        std::string SOURCE_PATH = "main.corth";
+        std::string OUTPUT_NAME = "corth_program";
+        std::string ASMB_PATH = "";
+        std::string LINK_PATH = "";
+        std::string ASMB_OPTS = "";
+        std::string LINK_OPTS = "";
+        std::string ASMB_NAME = "";
+        std::string LINK_NAME = "";
+        MODE RUN_MODE = MODE::COMPILE;
+        PLATFORM RUN_PLATFORM = PLATFORM::WIN64;
+        ASM_SYNTAX ASSEMBLY_SYNTAX = ASM_SYNTAX::NASM;
+        bool verbose_logging = false;
+        // Stream generated assembly straight into the assembler's stdin instead of a file.
+        bool pipe_assembly = false;
+        // Directory of previously compiled executables; an empty path disables the build cache.
+        std::string CACHE_DIR = "";
+        // Maximum total size of the build cache in bytes (zero means unlimited).
+        uint64_t CACHE_SIZE_LIMIT = 0;
+        // Size of `mem` in bytes.
+        uint64_t MEM_SIZE = MEM_CAPACITY;
+        // Most bytes `read_block` asks `fread` for at a time, whatever the program asks for.
+        uint64_t READ_BLOCK_SIZE = READ_BLOCK_CAPACITY;
+        // Target of `-march`, and the CPU_FEATURE bits generated code may use on it.
+        std::string TARGET_ARCH = "x86-64";
+        uint32_t TARGET_FEATURES = 0;
+        // Allocate `mem` with `mmap` when the program starts instead of in .bss.
+        bool mem_mmap = false;
+        // Ask for transparent huge pages to back `mem`; implies `mem_mmap`.
+        bool mem_huge = false;
+        // Fault in every page of `mem` when the program starts; implies `mem_mmap`.
+        bool mem_populate = false;
+        // Only reserve `mem` at start-up, and commit its pages as they are first touched or grown into with `mem_grow`.
+        bool mem_grow = false;
+        // Sample the instruction pointer on a profiling timer, and write a histogram to `<OUTPUT_NAME>.samples` on exit.
+        bool sample = false;
+        // Count loads and stores per cache line of `mem` and per source location, and write them to `<OUTPUT_NAME>.memtrace` on exit.
+        bool memtrace = false;
+        // Count cycles, instructions, cache and branch misses with `perf_event_open`, and print them to stderr on exit.
+        bool perfstat = false;
+        // Emit DWARF line information mapping instructions back to the `.corth` source.
+        bool debug_info = false;
+        // Count how often every basic block runs, and write the counts to `<OUTPUT_NAME>.prof` on exit.
+        bool profile = false;
+        // Report wall time and peak memory of every compilation phase.
+        bool time_phases = false;
+        // Where to write the timing report as JSON; empty means text only.
+        std::string TIME_JSON_PATH = "";
+        CompileStats stats;
+    };
+
+    bool MemIsMapped(const Context& ctx) {
+        return ctx.mem_mmap || ctx.mem_huge || ctx.mem_populate || ctx.mem_grow || ctx.MEM_SIZE > MEM_BSS_LIMIT;
+    }
+
+    bool TargetHas(const Context& ctx, CPU_FEATURE feature) {
+        return ctx.TARGET_FEATURES & (1u << static_cast<int>(feature));
+    }
+
+    // Features of the CPU Corth itself runs on, for `-march=native`.
+    uint32_t DetectHostFeatures() {
+        static_assert(static_cast<int>(CPU_FEATURE::COUNT) == 6,
+                      "Exhaustive handling of CPU features in DetectHostFeatures");
+        uint32_t features = 0;
+        #if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+        auto cpuid = [](uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+            __asm__ volatile ("cpuid" : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3]) : "a"(leaf), "c"(subleaf));
+        };
+        auto set = [&features](CPU_FEATURE feature, bool present) {
+            if (present) { features |= 1u << static_cast<int>(feature); }
+        };
+        uint32_t regs[4];
+        cpuid(0, 0, regs);
+        uint32_t max_leaf = regs[0];
+        cpuid(0x80000000, 0, regs);
+        uint32_t max_extended_leaf = regs[0];
+
+        cpuid(1, 0, regs);
+        set(CPU_FEATURE::POPCNT, regs[2] & (1u << 23));
+        // Vector registers are only usable if the OS saves them (OSXSAVE, then XCR0).
+        uint64_t xcr0 = 0;
+        if (regs[2] & (1u << 27)) {
+            uint32_t low, high;
+            __asm__ volatile ("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+            xcr0 = (uint64_t)high << 32 | low;
+        }
+        bool ymm_state = (xcr0 & 0x06) == 0x06 && (regs[2] & (1u << 28));
+        bool zmm_state = (xcr0 & 0xe6) == 0xe6;
+        if (max_leaf >= 7) {
+            cpuid(7, 0, regs);
+            set(CPU_FEATURE::BMI1, regs[1] & (1u << 3));
+            set(CPU_FEATURE::BMI2, regs[1] & (1u << 8));
+            set(CPU_FEATURE::AVX2, ymm_state && (regs[1] & (1u << 5)));
+            // AVX-512 F, DQ, CD, BW and VL, as in x86-64-v4
+            const uint32_t avx512 = (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31);
+            set(CPU_FEATURE::AVX512, zmm_state && (regs[1] & avx512) == avx512);
+        }
+        if (max_extended_leaf >= 0x80000001) {
+            cpuid(0x80000001, 0, regs);
+            set(CPU_FEATURE::LZCNT, regs[2] & (1u << 5));
+        }
+        #endif
+        return features;
+    }
+
+    // Set `features` to those of the named `-march` target; false if there is no such target.
+    bool ParseTargetArch(const std::string& name, uint32_t& features) {
+        static_assert(static_cast<int>(CPU_FEATURE::COUNT) == 6,
+                      "Exhaustive handling of CPU features in ParseTargetArch");
+        auto bit = [](CPU_FEATURE feature) { return 1u << static_cast<int>(feature); };
+        const uint32_t v2 = bit(CPU_FEATURE::POPCNT);
+        const uint32_t v3 = v2 | bit(CPU_FEATURE::LZCNT) | bit(CPU_FEATURE::BMI1) | bit(CPU_FEATURE::BMI2) | bit(CPU_FEATURE::AVX2);
+        const uint32_t v4 = v3 | bit(CPU_FEATURE::AVX512);
+        if      (name == "x86-64")    { features = 0;  }
+        else if (name == "x86-64-v2") { features = v2; }
+        else if (name == "x86-64-v3") { features = v3; }
+        else if (name == "x86-64-v4") { features = v4; }
+        else if (name == "native")    { features = DetectHostFeatures(); }
+        else { return false; }
+        return true;
+    }
+
+    long PeakRSS() {
+        #ifdef __linux__
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0) { return usage.ru_maxrss; }
+        #endif
+        return 0;
+    }
+
+    // Records the wall time of one compilation phase when it goes out of scope.
+    class PhaseTimer {
+    public:
+        // Set this to report the peak memory of a child process instead of Corth's own.
+        long peak_rss_kb = -1;
+
+        PhaseTimer(Context& ctx, std::string name)
+            : ctx(ctx), name(std::move(name)), start(std::chrono::steady_clock::now()) {}
+
+        ~PhaseTimer() {
+            if (!ctx.time_phases) { return; }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            ctx.stats.phases.push_back({ name, elapsed.count(), peak_rss_kb < 0 ? PeakRSS() : peak_rss_kb, peak_rss_kb >= 0 });
+        }
+
+    private:
+        Context& ctx;
+        std::string name;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Forwards generated assembly to another stream buffer, counting bytes and instructions on the way.
+    // An instruction is any line in a text section that isn't blank, a comment, a label or a directive.
+    class AsmStatsBuffer : public std::streambuf {
+    public:
+        AsmStatsBuffer(std::streambuf* destination, CompileStats& stats)
+            : destination(destination), stats(stats)
+        {
+            setp(buffer, buffer + sizeof(buffer));
+        }
+
+        ~AsmStatsBuffer() { sync(); }
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (!Flush()) { return traits_type::eof(); }
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() override {
+            return Flush() && destination->pubsync() == 0 ? 0 : -1;
+        }
+
+    private:
+        char buffer[65536];
+        std::streambuf* destination;
+        CompileStats& stats;
+        std::string line;
+        bool in_text_section = false;
+
+        bool Flush() {
+            std::streamsize size = pptr() - pbase();
+            for (char* c = pbase(); c < pptr(); c++) {
+                if (*c == '\n') { CountLine(); line.clear(); }
+                else { line.push_back(*c); }
+            }
+            stats.asm_bytes += size;
+            setp(buffer, buffer + sizeof(buffer));
+            return destination->sputn(buffer, size) == size;
+        }
+
+        void CountLine() {
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos) { return; }
+            std::string word = line.substr(start, line.find_first_of(" \t", start) - start);
+            std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+            if (word == "section" || word == ".section") {
+                size_t name = line.find_first_not_of(" \t", start + word.size());
+                in_text_section = name != std::string::npos && line.compare(name, 5, ".text") == 0;
+            }
+            else if (word == ".text") { in_text_section = true; }
+            else if (word == ".data" || word == ".bss") { in_text_section = false; }
+            else if (in_text_section
+                     && word[0] != ';' && word[0] != '#' && word[0] != '.'
+                     && word.back() != ':'
+                     && word != "global" && word != "extern" && word != "default" && word != "bits")
+            {
+                stats.asm_instructions++;
+            }
+        }
+    };
 
     // This needs to be changed if operators are added or removed from Corth internally.
     const size_t OP_COUNT = 15;
@@ -110,17 +378,41 @@ namespace Corth {
         MOD,
         OPEN_FILE,
         WRITE_TO_FILE,
+        READ_FILE,
+        READ_BLOCK,
         CLOSE_FILE,
         LENGTH_S,
 		WRITE,
 		WRITE_PLUS,
 		APPEND,
 		APPEND_PLUS,
+        READ,
+        READ_PLUS,
+        MEM_GROW,
+        MAP_FILE,
+        UNMAP_FILE,
+        MAP_ADVISE,
+        ASYNC_READ,
+        ASYNC_WRITE,
+        ASYNC_WAIT,
+        MEM_FILL,
+        MEM_COPY,
+        MEM_COMPARE,
+        MEM_FIND_BYTE,
+        MEM_FIND_ANY,
+        POPCNT,
+        LZCNT,
+        TZCNT,
+        BSWAP,
+        ROL,
+        ROR,
+        PEXT,
+        PDEP,
         COUNT
     };
 
     bool iskeyword(std::string word) {
-        static_assert(static_cast<int>(Keyword::COUNT) == 36,
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
                       "Exhaustive handling of keywords in iskeyword");
         if (word == "if"
             || word == "else"
@@ -137,6 +429,7 @@ namespace Corth {
             || word == "dump_c"
             || word == "dump_s"
             || word == "mem"
+            || word == "mem_grow"
             || word == "loadb"
             || word == "storeb"
             || word == "loadw"
@@ -153,12 +446,34 @@ namespace Corth {
             || word == "open_file"
             || word == "write_to_file"
             || word == "read_file"
+            || word == "read_block"
+            || word == "map_file"
+            || word == "unmap_file"
+            || word == "map_advise"
+            || word == "async_read"
+            || word == "async_write"
+            || word == "async_wait"
+            || word == "mem_fill"
+            || word == "mem_copy"
+            || word == "mem_compare"
+            || word == "mem_find_byte"
+            || word == "mem_find_any"
+            || word == "popcnt"
+            || word == "lzcnt"
+            || word == "tzcnt"
+            || word == "bswap"
+            || word == "rol"
+            || word == "ror"
+            || word == "pext"
+            || word == "pdep"
             || word == "close_file"
             || word == "length_s"
             || word == "write"
             || word == "write_plus"
             || word == "append"
-            || word == "append_plus")
+            || word == "append_plus"
+            || word == "read"
+            || word == "read_plus")
         {
             return true;
         }
@@ -170,7 +485,7 @@ namespace Corth {
     // This function outlines the corth source input and the output it will generate.
     // case <output>: { return "<input>"; }
     std::string GetKeywordStr(Keyword word) {
-        static_assert(static_cast<int>(Keyword::COUNT) == 36,
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
                       "Exhaustive handling of keywords in GetKeywordStr");
         switch (word) {
         case Keyword::IF:               { return "if";            }
@@ -207,6 +522,8 @@ namespace Corth {
 
         case Keyword::OPEN_FILE:        { return "open_file";     }
         case Keyword::WRITE_TO_FILE:    { return "write_to_file"; }
+        case Keyword::READ_FILE:        { return "read_file";     }
+        case Keyword::READ_BLOCK:       { return "read_block";    }
         case Keyword::CLOSE_FILE:       { return "close_file";    }
         case Keyword::LENGTH_S:         { return "length_s";      }
 
@@ -214,6 +531,33 @@ namespace Corth {
         case Keyword::WRITE_PLUS:       { return "write_plus";    }
         case Keyword::APPEND:           { return "append";        }
         case Keyword::APPEND_PLUS:      { return "append_plus";   }
+        case Keyword::READ:             { return "read";          }
+        case Keyword::READ_PLUS:        { return "read_plus";     }
+
+        case Keyword::MEM_GROW:         { return "mem_grow";      }
+
+        case Keyword::MAP_FILE:         { return "map_file";      }
+        case Keyword::UNMAP_FILE:       { return "unmap_file";    }
+        case Keyword::MAP_ADVISE:       { return "map_advise";    }
+
+        case Keyword::ASYNC_READ:       { return "async_read";    }
+        case Keyword::ASYNC_WRITE:      { return "async_write";   }
+        case Keyword::ASYNC_WAIT:       { return "async_wait";    }
+
+        case Keyword::MEM_FILL:         { return "mem_fill";      }
+        case Keyword::MEM_COPY:         { return "mem_copy";      }
+        case Keyword::MEM_COMPARE:      { return "mem_compare";   }
+        case Keyword::MEM_FIND_BYTE:    { return "mem_find_byte"; }
+        case Keyword::MEM_FIND_ANY:     { return "mem_find_any";  }
+
+        case Keyword::POPCNT:           { return "popcnt";        }
+        case Keyword::LZCNT:            { return "lzcnt";         }
+        case Keyword::TZCNT:            { return "tzcnt";         }
+        case Keyword::BSWAP:            { return "bswap";         }
+        case Keyword::ROL:              { return "rol";           }
+        case Keyword::ROR:              { return "ror";           }
+        case Keyword::PEXT:             { return "pext";          }
+        case Keyword::PDEP:             { return "pdep";          }
         default:
             Error("UNREACHABLE in GetKeywordStr");
             exit(1);
@@ -262,18 +606,33 @@ namespace Corth {
     struct Program {
         std::string source;
         std::vector<Token> tokens;
+        // Every string literal, decoded and null-terminated (see STRING POOL).
+        std::string string_pool;
     };
 
     void PrintUsage() {
-        printf("\n%s\n", "Usage: `Corth.exe <flags> <options> Path/To/File.corth`");
+        printf("\n%s\n", "Usage: `Corth.exe <flags> <options> Path/To/File.corth [More/Files.corth...]`");
         printf("    %s\n", "Flags:");
         printf("        %s\n", "-win, -win64             | (default) Generate assembly for Windows 64-bit. If no platform is specified, this is the default.");
         printf("        %s\n", "-linux, -linux64         | Generate assembly for Linux 64-bit.");
         //printf("        %s\n", "-mac, -apple             | Generate assembly for MacOS 64-bit.");
         printf("        %s\n", "-com, --compile          | (default) Compile program from source into executable");
         printf("        %s\n", "-gen, --generate         | Generate assembly, but don't create an executable from it.");
+        printf("        %s\n", "-int, --interpret        | Run the program immediately with the built-in interpreter; no assembler or linker required. Platform and syntax flags are ignored. Precompiled `.corthc` files are always interpreted.");
+        printf("        %s\n", "-bc, --bytecode          | Write precompiled bytecode to `<output-name>.corthc`; running it skips lexing and validation entirely.");
         printf("        %s\n", "-NASM                    | (default) When generating assembly, use NASM syntax. Any OPTIONS set before NASM may or may be over-ridden; best practice is to put it first.");
         printf("        %s\n", "-GAS                     | When generating assembly, use GAS syntax. This is able to be assembled by gcc into an executable. (pass output file name to gcc with `-add-ao \"-o <output-file-name>\" and not the built-in `-o` option`). Any OPTIONS set before GAS may or may be over-ridden; best practice is to put it first.");
+        printf("        %s\n", "-pipe, --pipe            | Linux GAS only: stream generated assembly directly into the assembler's stdin while it is being generated; no assembly file is written.");
+        printf("        %s\n", "-g, --debug-info         | Linux only: emit DWARF line information, so that debuggers and profilers (i.e. gdb, `perf annotate`) can map instructions back to lines of Corth source.");
+        printf("        %s\n", "-profile, --profile      | Linux only: count how many times every basic block runs; the program writes the counts to `<output-name>.prof` when it exits. View them with `corthprof`.");
+        printf("        %s\n", "-mem-mmap, --mem-mmap    | Linux only: allocate `mem` with `mmap` when the program starts instead of in the executable's .bss section. Always the case when `mem` is over 1G.");
+        printf("        %s\n", "-mem-huge, --mem-huge    | Linux only: back `mem` with transparent huge pages to cut TLB misses (implies `-mem-mmap`).");
+        printf("        %s\n", "-mem-populate            | Linux only: fault in every page of `mem` when the program starts (implies `-mem-mmap`).");
+        printf("        %s\n", "-mem-grow, --mem-grow    | Linux only: only reserve `mem` (of `-mem-size`) when the program starts, and commit its pages as they are first touched or grown into with `mem_grow` (implies `-mem-mmap`).");
+        printf("        %s\n", "-memtrace, --memtrace    | Linux only: count reads and writes to every cache line of `mem`, and the accesses made by every load and store; the program writes them to `<output-name>.memtrace` when it exits. View them with `corthprof`.");
+        printf("        %s\n", "-perfstat, --perfstat    | Linux only: the program counts its own cycles, instructions, cache misses and branch misses with `perf_event_open`, and prints them to stderr when it exits.");
+        printf("        %s\n", "-sample, --sample        | Linux only: sample where the program spends its time on a SIGPROF timer; the program writes how often each source location was hit to `<output-name>.samples` when it exits. View it with `corthprof`.");
+        printf("        %s\n", "-time, --time            | Report wall time and peak memory of every compilation phase, and how many tokens, string literals, bytes of assembly and instructions were produced.");
         printf("        %s\n", "-v, --verbose            | Enable verbose logging within Corth");
         printf("    %s\n", "Options (latest over-rides):");
         printf("        %s\n", "Usage: <option> <input>");
@@ -285,939 +644,4446 @@ namespace Corth {
         printf("        %s\n", "-lo, --linker-options    | Command line arguments called with linker");
         printf("        %s\n", "-add-ao, --add-asm-opt   | Append a command line argument to assembler options");
         printf("        %s\n", "-add-lo, --add-link-opt  | Append a command line argument to linker options");
+        printf("        %s\n", "-cache, --cache-dir      | Re-use executables compiled from identical source and options, stored in the given directory. Skips every compilation step on a hit.");
+        printf("        %s\n", "-time-json               | Write the `-time` report as JSON to the given path.");
+        printf("        %s\n", "-j, --jobs               | Number of source files to compile in parallel when more than one is given. (default: number of hardware threads)");
+        printf("        %s\n", "-mem-size, --mem-size    | Size of `mem` in bytes; K, M and G suffixes are accepted, i.e. `-mem-size 4G`. (default: 720000)");
+        printf("        %s\n", "-read-block-size         | Most bytes a single `read_block` reads, whatever it asks for; K, M and G suffixes are accepted. (default: 1M)");
+        printf("        %s\n", "-march=<target>          | Linux only: CPU to generate code for; one of x86-64 (default), x86-64-v2, x86-64-v3, x86-64-v4 or native (the CPU Corth runs on, detected with `cpuid`). Newer targets use instructions like `shlx`, `popcnt` and AVX2 that older CPUs don't have; x86-64-v4 currently generates the same code as x86-64-v3.");
+        printf("        %s\n", "-cache-limit             | Maximum size of the build cache directory in MiB; least recently used executables are evicted first. (default: unlimited)");
     }
 
-    // NASM doesn't deal with strings well, so I construct hex by hand
-    //   to ensure behaviour is expected.
-    std::vector<std::string> string_to_hex(const std::string& input)
-    {
-        static const char hex_digits[] = "0123456789abcdef";
+    // STRING POOL
+    // The lexer decodes every string literal; they are then all stored, null-terminated,
+    //   in a single pool that the backends emit as one blob labeled `str_pool`.
+    // Identical literals are stored once, and a literal that ends another one (i.e. "bar" and
+    //   "foobar") is merged into its tail. The offset of a literal into the pool is the `data` of its token.
+    // Sharing bytes is only sound because literals are immutable: the pool lives in read-only data
+    //   (and read-only pages in the interpreter on Linux), so writing to a literal crashes instead of
+    //   changing every literal that shares those bytes.
+    void BuildStringPool(Program& prog) {
+        std::vector<std::string> literals;
+        for (auto& tok : prog.tokens) {
+            if (tok.type == TokenType::STRING) { literals.push_back(tok.text + '\0'); }
+        }
+        // Reversed, a literal that ends another one is a prefix of it. Sorted in descending
+        //   order, every literal then directly follows the longest literal it is the tail of.
+        for (auto& literal : literals) { std::reverse(literal.begin(), literal.end()); }
+        std::sort(literals.begin(), literals.end(), std::greater<std::string>());
+        literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
 
-        std::vector<std::string> output;
-        for (unsigned char c : input)
-        {
-            std::string hex;
-            hex.append("0x");
-            hex.push_back(hex_digits[c >> 4]);
-            hex.push_back(hex_digits[c & 15]);
-            output.push_back(hex);
-        }
-
-        // Fix output. "\n" gets converted to two hex characters;
-        //   detect those and replace with single newline character.
-        // Same goes for "\t"
-        // As for "\r", just ignore it and remove it from final output.
-        std::vector<std::string> new_output;
-        for (size_t i = 0; i < output.size(); i++) {
-            if (output[i] == "0x5c") {
-                // Backslash found
-                i++;
-                if (i < output.size()) {
-                    if (output[i] == "0x6e") {
-                        // Found "\n", write newline.
-                        new_output.push_back("0xa");
-                        continue;
-                    }
-                    else if (output[i] == "0x72") {
-                        // Found "\r", write nothing (suck it, Windows).
-                        continue;
-                    }
-                    else if (output[i] == "0x74") {
-                        // Found "\t", write horizontal tab.
-                        new_output.push_back("0x9");
-                        continue;
-                    }
-                }
-                // Special character pattern not found, undo look-ahead.
-                i--;
+        std::map<std::string, size_t> offsets;
+        prog.string_pool.clear();
+        const std::string* previous = nullptr;
+        size_t previous_end = 0;
+        for (auto& literal : literals) {
+            std::string bytes(literal.rbegin(), literal.rend());
+            // A tail of the previous literal ends where that one does.
+            if (!previous || previous->compare(0, literal.size(), literal) != 0) {
+                prog.string_pool.append(bytes);
+                previous_end = prog.string_pool.size();
             }
-            new_output.push_back(output[i]);
+            offsets[bytes] = previous_end - bytes.size();
+            previous = &literal;
+        }
+        for (auto& tok : prog.tokens) {
+            if (tok.type == TokenType::STRING) { tok.data = std::to_string(offsets[tok.text + '\0']); }
         }
-        
-        return new_output;
     }
-    
-    void GenerateAssembly_NASM_linux64(Program& prog) {
-        std::string asm_file_path = OUTPUT_NAME + ".asm";
-        std::fstream asm_file;
-        asm_file.open(asm_file_path.c_str(), std::ios::out);
-        if (asm_file) {
-            Log("Generating NASM elf64 assembly");
 
-            // Save list of defined strings in file to write at the end of the assembly in the `.data` section.
-            std::vector<std::string> string_literals;
+    std::string EscapeGASString(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') { escaped += '\\'; escaped += c; }
+            else if (c == '\n') { escaped += "\\n"; }
+            else { escaped += c; }
+        }
+        return escaped;
+    }
 
-            // WRITE HEADER TO ASM FILE
-            asm_file << "    ;; CORTH COMPILER GENERATED THIS ASSEMBLY -- (BY LENSOR RADII)\n"
-                     << "    ;; USING `SYSTEM V AMD64 ABI` CALLING CONVENTION (RDI, RSI, RDX, RCX, R8, R9, -> STACK)\n"
-                     << "    ;; LINUX SYSTEM CALLS USE R10 INSTEAD OF RCX\n"
-                     << "    SECTION .text\n"
-                     << "    ;; DEFINE EXTERNAL C RUNTIME SYMBOLS\n"
-                     << "    extern exit\n"
-                     << "    extern printf\n"
-                     << "    extern fopen\n"
-                     << "    extern fwrite\n"
-                     << "    extern fclose\n"
-                     << "    extern strlen\n"
-                     << "\n"
-                     << "    global _start\n"
-                     << "_start:\n";
+    // Pools larger than this are written next to the assembly and pulled in with `incbin`,
+    //   so the assembler doesn't have to parse them.
+    const size_t STRING_POOL_INCBIN_THRESHOLD = 64 * 1024;
 
-            // WRITE TOKENS TO ASM FILE MAIN LABEL
-            static_assert(static_cast<int>(TokenType::COUNT) == 5,
-                          "Exhaustive handling of token types in GenerateAssembly_NASM_linux64");
-            size_t instr_ptr = 0;
-            size_t instr_ptr_max = prog.tokens.size();
-            while (instr_ptr < instr_ptr_max) {
-                Token& tok = prog.tokens[instr_ptr];
-                // Write assembly to opened file based on token type and value
-                if (tok.type == TokenType::INT) {
-                    asm_file << "    ;; -- push INT --\n"
-                             << "    mov rax, " << tok.text << "\n"
-                             << "    push rax\n";
-                }
-                else if (tok.type == TokenType::STRING) {
-                    asm_file << "    ;; -- push STRING --\n"
-                             << "    mov rax, str_" << string_literals.size() << '\n'
-                             << "    push rax\n";
-                    // String value is stored in tok.text
-                    string_literals.push_back(tok.text);
+    std::string StringPoolPath(Context& ctx) {
+        return ctx.OUTPUT_NAME + ".strings";
+    }
+
+    // Write the pool to `StringPoolPath`; returns false if that fails, in which case it is emitted inline.
+    bool WriteStringPoolFile(Context& ctx, const Program& prog) {
+        std::ofstream pool_file(StringPoolPath(ctx), std::ios::binary);
+        pool_file.write(prog.string_pool.data(), prog.string_pool.size());
+        return static_cast<bool>(pool_file);
+    }
+
+    // Runs of printable characters are quoted; every other byte is written as a number.
+    // Lines end after the terminator of each literal, or every 64 bytes.
+    void WriteStringPool_NASM(Context& ctx, const Program& prog, std::ostream& asm_file) {
+        if (prog.string_pool.empty()) { return; }
+        asm_file << (ctx.RUN_PLATFORM == PLATFORM::WIN64 ? "    SECTION .rdata\n" : "    SECTION .rodata\n")
+                 << "str_pool:\n";
+        if (prog.string_pool.size() > STRING_POOL_INCBIN_THRESHOLD && WriteStringPoolFile(ctx, prog)) {
+            asm_file << "    incbin \"" << std::filesystem::absolute(StringPoolPath(ctx)).string() << "\"\n";
+            return;
+        }
+        size_t line_bytes = 0;
+        bool quoted = false;
+        for (size_t i = 0; i < prog.string_pool.size(); i++) {
+            unsigned char c = prog.string_pool[i];
+            if (line_bytes == 0) { asm_file << "    db "; }
+            if (c >= 0x20 && c < 0x7f && c != '"') {
+                if (!quoted) {
+                    if (line_bytes) { asm_file << ','; }
+                    asm_file << '"';
+                    quoted = true;
                 }
-                else if (tok.type == TokenType::OP) {
-                    static_assert(OP_COUNT == 15,
-                                  "Exhaustive handling of operators in GenerateAssembly_NASM_linux64");
-                    if (tok.text == "+") {
-                        asm_file << "    ;; -- add --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    add rax, rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == "-") {
-                        asm_file << "    ;; -- subtract --\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    sub rax, rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == "*") {
-                        asm_file << "    ;; -- multiply --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    mul rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == "/") {
-                        asm_file << "    ;; -- divide --\n"
-                                 << "    xor rdx, rdx\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    div rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == "%") {
-                        asm_file << "    ;; -- modulo --\n"
-                                 << "    xor rdx, rdx\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    div rbx\n"
-                                 << "    push rdx\n";
-                    }
-                    else if (tok.text == "=") {
-                        asm_file << "    ;; -- equality condition --\n"
-                                 << "    mov rcx, 0\n"
-                                 << "    mov rdx, 1\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    cmp rax, rbx\n"
-                                 << "    cmove rcx, rdx\n"
-                                 << "    push rcx\n";
-                    }
-                    else if (tok.text == "<") {
-                        asm_file << "    ;; -- less than condition --\n"
-                                 << "    mov rcx, 0\n"
-                                 << "    mov rdx, 1\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    cmp rax, rbx\n"
-                                 << "    cmovl rcx, rdx\n"
-                                 << "    push rcx\n";
-                    }
-                    else if (tok.text == ">") {
-                        asm_file << "    ;; -- greater than condition --\n"
-                                 << "    mov rcx, 0\n"
-                                 << "    mov rdx, 1\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    cmp rax, rbx\n"
-                                 << "    cmovg rcx, rdx\n"
-                                 << "    push rcx\n";
-                    }
-                    else if (tok.text == "<=") {
-                        asm_file << "    ;; -- less than or equal condition --\n"
-                                 << "    mov rcx, 0\n"
-                                 << "    mov rdx, 1\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    cmp rax, rbx\n"
-                                 << "    cmovle rcx, rdx\n"
-                                 << "    push rcx\n";
-                    }
-                    else if (tok.text == ">=") {
-                        asm_file << "    ;; -- greater than or equal condition --\n"
-                                 << "    mov rcx, 0\n"
-                                 << "    mov rdx, 1\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    cmp rax, rbx\n"
-                                 << "    cmovge rcx, rdx\n"
-                                 << "    push rcx\n";
-                    }
-                    else if (tok.text == "<<") {
-                        asm_file << "    ;; -- bitwise-shift left --\n"
-                                 << "    pop rcx\n"
-                                 << "    pop rbx\n"
-                                 << "    shl rbx, cl\n"
-                                 << "    push rbx";
-                    }
-                    else if (tok.text == ">>") {
-                        asm_file << "    ;; -- bitwise-shift right --\n"
-                                 << "    pop rcx\n"
-                                 << "    pop rbx\n"
-                                 << "    shr rbx, cl\n"
-                                 << "    push rbx";
-                    }
-                    else if (tok.text == "||") {
-                        asm_file << "    ;; -- bitwise or --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    or rax, rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == "&&") {
-                        asm_file << "    ;; -- bitwise and --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    and rax, rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == "#") {
-                        // Without clearing rax, seg faults can happen seemingly at random
-                        asm_file << "    ;; -- dump --\n"
-                                 << "    lea rdi, [rel fmt]\n"
-                                 << "    pop rsi\n"
-                                 << "    xor rax, rax\n"
-                                 << "    call printf\n";
-                    }
+                asm_file << c;
+            }
+            else {
+                if (quoted) {
+                    asm_file << '"';
+                    quoted = false;
                 }
-                else if (tok.type == TokenType::KEYWORD) {
-                    static_assert(static_cast<int>(Keyword::COUNT) == 36,
-                                  "Exhaustive handling of keywords in GenerateAssembly_NASM_linux64");
-                    if (tok.text == GetKeywordStr(Keyword::IF)) {
-                        asm_file << "    ;; -- if --\n"
-                                 << "    pop rax\n"
-                                 << "    cmp rax, 0\n"
-                                 << "    je addr_" << tok.data << "\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::ELSE)) {
-                        asm_file << "    ;; -- else --\n"
-                                 << "    jmp addr_" << tok.data << "\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::ENDIF)) {
-                        asm_file << "    ;; -- endif --\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::WHILE)) {
-                        asm_file << "    ;; -- while --\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DO)) {
-                        asm_file << "    ;; -- do --\n"
-                                 << "    pop rax\n"
-                                 << "    cmp rax, 0\n"
-                                 << "    je addr_" << tok.data << "\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::ENDWHILE)) {
-                        asm_file << "    ;; -- endwhile --\n"
-                                 << "    jmp addr_" << tok.data << "\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    
-                    else if (tok.text == GetKeywordStr(Keyword::DUP)) {
-                        asm_file << "    ;; -- dup --\n"
-                                 << "    pop rax\n"
-                                 << "    push rax\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::TWODUP)) {
-                        asm_file << "    ;; -- twodup --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    push rbx\n"
-                                 << "    push rax\n"
-                                 << "    push rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DROP)) {
-                        asm_file << "    ;; -- drop --\n"
-                                 << "    pop rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::SWAP)) {
-                        asm_file << "    ;; -- swap --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    push rax\n"
-                                 << "    push rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::OVER)) {
-                        asm_file << "    ;; -- over --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    push rbx\n"
-                                 << "    push rax\n"
-                                 << "    push rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DUMP)) {
-                        asm_file << "    ;; -- dump --\n"
-                                 << "    lea rdi, [rel fmt]\n"
-                                 << "    pop rsi\n"
-                                 << "    xor rax, rax\n"
-                                 << "    call printf\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DUMP_C)) {
-                        asm_file << "    ;; -- dump character --\n"
-                                 << "    lea rdi, [rel fmt_char]\n"
-                                 << "    pop rsi\n"
-                                 << "    xor rax, rax\n"
-                                 << "    call printf\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DUMP_S)) {
-                        asm_file << "    ;; -- dump string --\n"
-                                 << "    lea rdi, [rel fmt_str]\n"
-                                 << "    pop rsi\n"
-                                 << "    xor rax, rax\n"
-                                 << "    call printf\n";
-                    }
-
-                    else if (tok.text == GetKeywordStr(Keyword::MEM)) {
-                        asm_file << "    ;; -- mem --\n"
-                                 << "    push mem\n";
-                        // Pushes the relative address of allocated memory onto the stack
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADB)) {
-                        asm_file << "    ;; -- load byte --\n"
-                                 << "    pop rax\n"
-                                 << "    xor rbx, rbx\n"
-                                 << "    mov bl, [rax]\n"
-                                 << "    push rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STOREB)) {
-                        asm_file << "    ;; -- store byte --\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    mov [rax], bl\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADW)) {
-                        asm_file << "    ;; -- load word --\n"
-                                 << "    pop rax\n"
-                                 << "    xor rbx, rbx\n"
-                                 << "    mov bx, [rax]\n"
-                                 << "    push rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STOREW)) {
-                        asm_file << "    ;; -- store word --\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    mov [rax], bx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADD)) {
-                        asm_file << "    ;; -- load double word --\n"
-                                 << "    pop rax\n"
-                                 << "    xor rbx, rbx\n"
-                                 << "    mov ebx, [rax]\n"
-                                 << "    push rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STORED)) {
-                        asm_file << "    ;; -- store double word --\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    mov [rax], ebx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADQ)) {
-                        asm_file << "    ;; -- load quad word --\n"
-                                 << "    pop rax\n"
-                                 << "    xor rbx, rbx\n"
-                                 << "    mov rbx, [rax]\n"
-                                 << "    push rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STOREQ)) {
-                        asm_file << "    ;; -- store quad word --\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    mov [rax], rbx\n";
-                    }
-                    
-                    else if (tok.text == GetKeywordStr(Keyword::SHL)) {
-                        asm_file << "    ;; -- bitwise-shift left --\n"
-                                 << "    pop rcx\n"
-                                 << "    pop rbx\n"
-                                 << "    shl rbx, cl\n"
-                                 << "    push rbx";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::SHR)) {
-                        asm_file << "    ;; -- bitwise-shift right --\n"
-                                 << "    pop rcx\n"
-                                 << "    pop rbx\n"
-                                 << "    shr rbx, cl\n"
-                                 << "    push rbx";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::OR)) {
-                        asm_file << "    ;; -- bitwise or --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    or rax, rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::AND)) {
-                        asm_file << "    ;; -- bitwise and --\n"
-                                 << "    pop rax\n"
-                                 << "    pop rbx\n"
-                                 << "    and rax, rbx\n"
-                                 << "    push rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::MOD)) {
-                        asm_file << "    ;; -- modulo --\n"
-                                 << "    xor rdx, rdx\n"
-                                 << "    pop rbx\n"
-                                 << "    pop rax\n"
-                                 << "    div rbx\n"
-                                 << "    push rdx\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::OPEN_FILE)) {
-                        asm_file << "    ;; -- open file and push pointer --\n"
-                                 << "    pop rsi\n"
-                                 << "    pop rdi\n"
-                                 << "    call fopen\n"
-                                 << "    push rax\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::WRITE_TO_FILE)) {
-                        asm_file << "    ;; -- write to file --\n"
-                                 << "    pop rcx\n"
-                                 << "    pop rdx\n"
-                                 << "    pop rsi\n"
-                                 << "    pop rdi\n"
-                                 << "    call fwrite\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE)) {
-                        asm_file << "    ;; -- close file --\n"
-                                 << "    pop rdi\n"
-                                 << "    call fclose\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
-                        asm_file << "    ;; -- get length of string --\n"
-                                 << "    pop rdi\n"
-                                 << "    call strlen\n"
-                                 << "    push rax\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::WRITE)) {
-                        asm_file << "    ;; -- push pointer to write file mode constant --\n"
-                                 << "    push write\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::WRITE_PLUS)) {
-                        asm_file << "    ;; -- push pointer to write/read file mode constant --\n"
-                                 << "    push write_plus\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::APPEND)) {
-                        asm_file << "    ;; -- push pointer to append file mode constant --\n"
-                                 << "    push append\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::APPEND_PLUS)) {
-                        asm_file << "    ;; -- push pointer to append/read file mode constant --\n"
-                                 << "    push append_plus\n";
-                    }
-                }
-                instr_ptr++;
+                if (line_bytes) { asm_file << ','; }
+                asm_file << static_cast<int>(c);
             }
-            // WRITE ASM FOOTER (GRACEFUL PROGRAM EXIT, CONSTANTS)
-            asm_file << "    mov rdi, 0\n"
-                     << "    call exit\n"
-                     << '\n'
-                     << "    SECTION .data\n"
-                     << "    fmt db '%u', 0\n"
-                     << "    fmt_char db '%c', 0\n"
-                     << "    fmt_str db '%s', 0\n"
-					 << "    write db \"w\", 0\n"
-					 << "    append db \"a\", 0\n"
-					 << "    write_plus db \"w+\", 0\n"
-					 << "    append_plus db \"a+\", 0\n";
+            line_bytes++;
+            if (c == 0 || line_bytes == 64 || i + 1 == prog.string_pool.size()) {
+                if (quoted) { asm_file << '"'; }
+                asm_file << '\n';
+                quoted = false;
+                line_bytes = 0;
+            }
+        }
+    }
 
-            // WRITE USER DEFINED STRING CONSTANTS
-            size_t index = 0;
-            for (auto& string : string_literals) {
-                std::vector<std::string> hex_chars = string_to_hex(string);
-                asm_file << "str_" << index << " db ";
-                for (auto& c : hex_chars) {
-                    asm_file << c << ',';
-                }
-                // Null-terminator
-                asm_file << "0\n";
-                index++;
+    // Every byte that isn't printable is written as an octal escape.
+    // Lines end after the terminator of each literal, or every 64 bytes.
+    void WriteStringPool_GAS(Context& ctx, const Program& prog, std::ostream& asm_file) {
+        if (prog.string_pool.empty()) { return; }
+        asm_file << (ctx.RUN_PLATFORM == PLATFORM::WIN64 ? "    .section .rdata,\"dr\"\n" : "    .section .rodata\n")
+                 << "str_pool:\n";
+        if (prog.string_pool.size() > STRING_POOL_INCBIN_THRESHOLD && WriteStringPoolFile(ctx, prog)) {
+            asm_file << "    .incbin \"" << EscapeGASString(std::filesystem::absolute(StringPoolPath(ctx)).string()) << "\"\n";
+            return;
+        }
+        static const char octal_digits[] = "01234567";
+        size_t line_bytes = 0;
+        for (size_t i = 0; i < prog.string_pool.size(); i++) {
+            unsigned char c = prog.string_pool[i];
+            if (line_bytes == 0) { asm_file << "    .ascii \""; }
+            if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\') { asm_file << c; }
+            else {
+                asm_file << '\\' << octal_digits[c >> 6] << octal_digits[(c >> 3) & 7] << octal_digits[c & 7];
+            }
+            line_bytes++;
+            if (c == 0 || line_bytes == 64 || i + 1 == prog.string_pool.size()) {
+                asm_file << "\"\n";
+                line_bytes = 0;
             }
+        }
+    }
 
-            // ALLOCATE MEMORY
-            asm_file << '\n'
-                     << "    SECTION .bss\n"
-                     << "    mem resb " << MEM_CAPACITY << '\n';
-            
-            asm_file.close();
-                
-            Log("NASM elf64 assembly generated at " + asm_file_path);
+    // The string literal that is on top of the stack when the token at `instr_ptr` runs,
+    //   if it was pushed right before it (`"..." length_s` or `"..." dup length_s`).
+    // Jumps only land on or right after block keywords, so these tokens always run back to back.
+    // The length of such a literal is known at compile time: `length_s` folds to a constant,
+    //   and `dump_s` writes exactly that many bytes instead of scanning for the NUL terminator.
+    // That only holds because literals are immutable (see STRING POOL); a program that could store
+    //   into a literal could move its terminator, and the folded length would be stale.
+    const Token* KnownStringOperand(const Program& prog, size_t instr_ptr) {
+        if (instr_ptr >= 1 && prog.tokens[instr_ptr - 1].type == TokenType::STRING) {
+            return &prog.tokens[instr_ptr - 1];
         }
-        else {
-            Error("Could not open file for writing. Does directory exist?");
-            exit(1);
+        if (instr_ptr >= 2 && prog.tokens[instr_ptr - 2].type == TokenType::STRING
+            && prog.tokens[instr_ptr - 1].type == TokenType::KEYWORD
+            && prog.tokens[instr_ptr - 1].text == GetKeywordStr(Keyword::DUP))
+        {
+            return &prog.tokens[instr_ptr - 2];
         }
+        return nullptr;
     }
 
-    void GenerateAssembly_GAS_linux64(Program& prog) {
-        std::string asm_file_path = OUTPUT_NAME + ".s";
-        std::fstream asm_file;
-        asm_file.open(asm_file_path.c_str(), std::ios::out);
-        if (asm_file) {
-            Log("Generating Linux x64 GAS assembly");
+    // The length `length_s` (or `strlen`) gives a known literal: up to its first NUL byte, as "\0" can put one inside it.
+    size_t KnownStringLength(const Token& literal) {
+        return strlen(literal.text.c_str());
+    }
 
-            // Save list of defined strings in file to write at the end of the assembly in the `.data` section.
-            std::vector<std::string> string_literals;
+    // PROFILING
+    // With `-profile`, every basic block increments its own 64-bit counter.
+    // A basic block starts at the first token and right after every token that jumps or is jumped to.
+    // On exit, the program writes the count of every block, keyed by the source location of
+    //   its first token, to `<output-name>.prof`. `corthprof` turns that into an annotated listing.
+    bool EndsBasicBlock(const Token& tok) {
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                      "Exhaustive handling of keywords in EndsBasicBlock. Keep in mind not all keywords form blocks.");
+        return tok.type == TokenType::KEYWORD
+            && (tok.text == GetKeywordStr(Keyword::IF)
+                || tok.text == GetKeywordStr(Keyword::ELSE)
+                || tok.text == GetKeywordStr(Keyword::ENDIF)
+                || tok.text == GetKeywordStr(Keyword::WHILE)
+                || tok.text == GetKeywordStr(Keyword::DO)
+                || tok.text == GetKeywordStr(Keyword::ENDWHILE));
+    }
 
-            // WRITE HEADER TO ASM FILE
-            asm_file << "    # CORTH COMPILER GENERATED THIS ASSEMBLY -- (BY LENSOR RADII)\n"
-                     << "    # USING `GAS` SYNTAX\n"
-                     << "    # USING `SYSTEM V AMD64 ABI` CALLING CONVENTION (RDI, RSI, RDX, RCX, R8, R9, -> STACK)\n"
-                     << "    # LINUX SYSTEM CALLS USE R10 INSTEAD OF RCX\n"
-                     << "    .text\n"
-                     << "    .globl main\n"
-                     << "main:\n";
+    bool StartsBasicBlock(Program& prog, size_t instr_ptr) {
+        return instr_ptr == 0 || EndsBasicBlock(prog.tokens[instr_ptr - 1]);
+    }
 
-            // WRITE TOKENS TO ASM FILE MAIN LABEL
-            static_assert(static_cast<int>(TokenType::COUNT) == 5,
-                          "Exhaustive handling of token types in GenerateAssembly_GAS_linux64");
-            size_t instr_ptr = 0;
-            size_t instr_ptr_max = prog.tokens.size();
-            while (instr_ptr < instr_ptr_max) {
-                Token& tok = prog.tokens[instr_ptr];
-                // Write assembly to opened file based on token type and value
-                if (tok.type == TokenType::INT) {
-                    asm_file << "    # -- push INT --\n"
-                             << "    mov $"  << tok.text << ", %rax" << "\n"
-                             << "    push %rax\n";
-                }
-                else if (tok.type == TokenType::STRING) {
-                    asm_file << "    # -- push STRING --\n"
-                             << "    lea str_" << string_literals.size() << "(%rip), %rax\n"
-                             << "    push %rax\n";
-                    // String value is stored in tok.text
-                    string_literals.push_back(tok.text);
+    struct BasicBlockLocation {
+        size_t line;
+        size_t column;
+        // Whether the block's first token is also the first token on its line.
+        bool starts_line;
+    };
+
+    // Source location of the block starting at `instr_ptr`.
+    // A block that starts after the last token is attributed to that token.
+    BasicBlockLocation GetBasicBlockLocation(Program& prog, size_t instr_ptr) {
+        if (prog.tokens.empty()) { return { 1, 1, true }; }
+        if (instr_ptr >= prog.tokens.size()) {
+            Token& last = prog.tokens.back();
+            return { last.line_number, last.col_number, false };
+        }
+        Token& tok = prog.tokens[instr_ptr];
+        bool starts_line = instr_ptr == 0 || prog.tokens[instr_ptr - 1].line_number != tok.line_number;
+        return { tok.line_number, tok.col_number, starts_line };
+    }
+
+    std::string ProfilePath(Context& ctx) {
+        return ctx.OUTPUT_NAME + ".prof";
+    }
+
+    // Profile header, followed by one `<line> <column> <starts line> <count>` line per basic block.
+    const char* PROFILE_HEADER = "# corth profile\nsource %s\n";
+    const char* PROFILE_FORMAT = "%zu %zu %zu %zu\n";
+
+    std::string NASMBytes(const std::string& text) {
+        std::string bytes;
+        for (unsigned char c : text) { bytes += std::to_string(c) + ','; }
+        return bytes + '0';
+    }
+
+    // Write every counter to the profile; emitted just before the program exits.
+    void WriteProfileDump_NASM_linux64(size_t block_count, std::ostream& asm_file) {
+        asm_file << "    ;; -- profile: write basic block counters --\n"
+                 << "    and rsp, -16\n"
+                 << "    mov rdi, prof_path\n"
+                 << "    mov rsi, write\n"
+                 << "    call fopen\n"
+                 << "    test rax, rax\n"
+                 << "    je prof_done\n"
+                 << "    mov r12, rax\n"
+                 << "    mov rdi, r12\n"
+                 << "    mov rsi, prof_header\n"
+                 << "    mov rdx, prof_source\n"
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "    mov r13, prof_locs\n"
+                 << "    mov r14, prof_counts\n"
+                 << "    mov r15, " << block_count << "\n"
+                 << "prof_loop:\n"
+                 << "    mov rdi, r12\n"
+                 << "    mov rsi, prof_fmt\n"
+                 << "    mov rdx, [r13]\n"
+                 << "    mov rcx, [r13 + 8]\n"
+                 << "    mov r8, [r13 + 16]\n"
+                 << "    mov r9, [r14]\n"
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "    add r13, 24\n"
+                 << "    add r14, 8\n"
+                 << "    dec r15\n"
+                 << "    jnz prof_loop\n"
+                 << "    mov rdi, r12\n"
+                 << "    call fclose\n"
+                 << "prof_done:\n";
+    }
+
+    void WriteProfileData_NASM_linux64(Context& ctx, Program& prog, const std::vector<size_t>& blocks, std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    SECTION .data\n"
+                 << "prof_path db " << NASMBytes(ProfilePath(ctx)) << '\n'
+                 << "prof_header db " << NASMBytes(PROFILE_HEADER) << '\n'
+                 << "prof_source db " << NASMBytes(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << '\n'
+                 << "prof_fmt db " << NASMBytes(PROFILE_FORMAT) << '\n'
+                 << "    ;; SOURCE LOCATION (LINE, COLUMN, STARTS LINE) OF EVERY BASIC BLOCK\n"
+                 << "    align 8\n"
+                 << "prof_locs:\n";
+        for (size_t instr_ptr : blocks) {
+            BasicBlockLocation location = GetBasicBlockLocation(prog, instr_ptr);
+            asm_file << "    dq " << location.line << ", " << location.column << ", " << location.starts_line << '\n';
+        }
+        asm_file << "    SECTION .bss\n"
+                 << "    alignb 8\n"
+                 << "    prof_counts resq " << blocks.size() << '\n';
+    }
+
+    void WriteProfileDump_GAS_linux64(size_t block_count, std::ostream& asm_file) {
+        asm_file << "    # -- profile: write basic block counters --\n"
+                 << "    and $-16, %rsp\n"
+                 << "    lea prof_path(%rip), %rdi\n"
+                 << "    lea write(%rip), %rsi\n"
+                 << "    call fopen\n"
+                 << "    test %rax, %rax\n"
+                 << "    je prof_done\n"
+                 << "    mov %rax, %r12\n"
+                 << "    mov %r12, %rdi\n"
+                 << "    lea prof_header(%rip), %rsi\n"
+                 << "    lea prof_source(%rip), %rdx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "    lea prof_locs(%rip), %r13\n"
+                 << "    lea prof_counts(%rip), %r14\n"
+                 << "    mov $" << block_count << ", %r15\n"
+                 << "prof_loop:\n"
+                 << "    mov %r12, %rdi\n"
+                 << "    lea prof_fmt(%rip), %rsi\n"
+                 << "    mov (%r13), %rdx\n"
+                 << "    mov 8(%r13), %rcx\n"
+                 << "    mov 16(%r13), %r8\n"
+                 << "    mov (%r14), %r9\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "    add $24, %r13\n"
+                 << "    add $8, %r14\n"
+                 << "    dec %r15\n"
+                 << "    jnz prof_loop\n"
+                 << "    mov %r12, %rdi\n"
+                 << "    call fclose\n"
+                 << "prof_done:\n";
+    }
+
+    void WriteProfileData_GAS_linux64(Context& ctx, Program& prog, const std::vector<size_t>& blocks, std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    .data\n"
+                 << "prof_path: .string \"" << EscapeGASString(ProfilePath(ctx)) << "\"\n"
+                 << "prof_header: .string \"" << EscapeGASString(PROFILE_HEADER) << "\"\n"
+                 << "prof_source: .string \"" << EscapeGASString(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << "\"\n"
+                 << "prof_fmt: .string \"" << EscapeGASString(PROFILE_FORMAT) << "\"\n"
+                 << "    # SOURCE LOCATION (LINE, COLUMN, STARTS LINE) OF EVERY BASIC BLOCK\n"
+                 << "    .p2align 3\n"
+                 << "prof_locs:\n";
+        for (size_t instr_ptr : blocks) {
+            BasicBlockLocation location = GetBasicBlockLocation(prog, instr_ptr);
+            asm_file << "    .quad " << location.line << ", " << location.column << ", " << location.starts_line << '\n';
+        }
+        asm_file << "    .bss\n"
+                 << "    .comm prof_counts, " << 8 * blocks.size() << ", 8\n";
+    }
+
+    // MAPPED MEMORY
+    // `mem` larger than MEM_BSS_LIMIT, or with `-mem-mmap`, `-mem-huge` or `-mem-populate`, is
+    //   allocated with `mmap` when the program starts, and its address kept in `mem_ptr`.
+    const uint64_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    const int MAP_PRIVATE_ANONYMOUS = 0x22;
+    const int MAP_NORESERVE_FLAG = 0x4000;
+    const int MAP_POPULATE_FLAG = 0x8000;
+    const int MADV_HUGEPAGE_ADVICE = 14;
+    const int MADV_POPULATE_WRITE_ADVICE = 23;
+
+    // Huge pages only back whole 2 MiB ranges.
+    uint64_t MappedMemSize(const Context& ctx) {
+        if (!ctx.mem_huge) { return ctx.MEM_SIZE; }
+        return (ctx.MEM_SIZE + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+
+    // Pages are only committed once touched, so unless they are populated up front, no swap is
+    //   reserved for them either; that lets `mem` be larger than what the kernel would promise.
+    // With huge pages, `MAP_POPULATE` would fault in small pages before the advice is given,
+    //   so `MADV_POPULATE_WRITE` populates the range afterwards instead.
+    int MemMapFlags(const Context& ctx) {
+        if (!ctx.mem_populate) { return MAP_PRIVATE_ANONYMOUS | MAP_NORESERVE_FLAG; }
+        return MAP_PRIVATE_ANONYMOUS | (ctx.mem_huge ? 0 : MAP_POPULATE_FLAG);
+    }
+
+    std::string MemMapFlagNames(const Context& ctx) {
+        int flags = MemMapFlags(ctx);
+        return std::string("MAP_PRIVATE | MAP_ANONYMOUS")
+            + (flags & MAP_NORESERVE_FLAG ? " | MAP_NORESERVE" : "")
+            + (flags & MAP_POPULATE_FLAG ? " | MAP_POPULATE" : "");
+    }
+
+    void WriteMemMap_NASM_linux64(Context& ctx, std::ostream& asm_file) {
+        asm_file << "    ;; -- map mem --\n"
+                 << "    xor rdi, rdi\n"
+                 << "    mov rsi, " << MappedMemSize(ctx) << '\n'
+                 << (ctx.mem_grow ? "    mov rdx, 0 ;; PROT_NONE\n" : "    mov rdx, 3 ;; PROT_READ | PROT_WRITE\n")
+                 << "    mov rcx, " << MemMapFlags(ctx) << " ;; " << MemMapFlagNames(ctx) << '\n'
+                 << "    mov r8, -1\n"
+                 << "    xor r9, r9\n"
+                 << "    call mmap\n"
+                 << "    cmp rax, -1\n"
+                 << "    jne mem_mapped\n"
+                 << "    mov rdi, mem_map_error\n"
+                 << "    call perror\n"
+                 << "    mov rdi, 1\n"
+                 << "    call exit\n"
+                 << "mem_mapped:\n"
+                 << "    mov [mem_ptr], rax\n";
+        if (ctx.mem_huge) {
+            asm_file << "    mov rdi, rax\n"
+                     << "    mov rsi, " << MappedMemSize(ctx) << '\n'
+                     << "    mov rdx, " << MADV_HUGEPAGE_ADVICE << " ;; MADV_HUGEPAGE\n"
+                     << "    call madvise\n";
+            if (ctx.mem_populate) {
+                asm_file << "    mov rdi, [mem_ptr]\n"
+                         << "    mov rsi, " << MappedMemSize(ctx) << '\n'
+                         << "    mov rdx, " << MADV_POPULATE_WRITE_ADVICE << " ;; MADV_POPULATE_WRITE\n"
+                         << "    call madvise\n";
+            }
+        }
+    }
+
+    void WriteMemMap_GAS_linux64(Context& ctx, std::ostream& asm_file) {
+        asm_file << "    # -- map mem --\n"
+                 << "    xor %rdi, %rdi\n"
+                 << "    mov $" << MappedMemSize(ctx) << ", %rsi\n"
+                 << (ctx.mem_grow ? "    mov $0, %rdx # PROT_NONE\n" : "    mov $3, %rdx # PROT_READ | PROT_WRITE\n")
+                 << "    mov $" << MemMapFlags(ctx) << ", %rcx # " << MemMapFlagNames(ctx) << '\n'
+                 << "    mov $-1, %r8\n"
+                 << "    xor %r9, %r9\n"
+                 << "    call mmap\n"
+                 << "    cmp $-1, %rax\n"
+                 << "    jne mem_mapped\n"
+                 << "    lea mem_map_error(%rip), %rdi\n"
+                 << "    call perror\n"
+                 << "    mov $1, %rdi\n"
+                 << "    call exit\n"
+                 << "mem_mapped:\n"
+                 << "    mov %rax, mem_ptr(%rip)\n";
+        if (ctx.mem_huge) {
+            asm_file << "    mov %rax, %rdi\n"
+                     << "    mov $" << MappedMemSize(ctx) << ", %rsi\n"
+                     << "    mov $" << MADV_HUGEPAGE_ADVICE << ", %rdx # MADV_HUGEPAGE\n"
+                     << "    call madvise\n";
+            if (ctx.mem_populate) {
+                asm_file << "    mov mem_ptr(%rip), %rdi\n"
+                         << "    mov $" << MappedMemSize(ctx) << ", %rsi\n"
+                         << "    mov $" << MADV_POPULATE_WRITE_ADVICE << ", %rdx # MADV_POPULATE_WRITE\n"
+                         << "    call madvise\n";
+            }
+        }
+    }
+
+    // SAMPLING PROFILER
+    // With `-sample`, the program installs a SIGPROF handler and a profiling interval timer on start-up.
+    // Every tick, the handler stores the interrupted instruction pointer in a ring buffer.
+    // On exit, each sample is attributed to the token whose code contains it (a binary search over
+    //   the address of every token's code, emitted by the compiler), and the histogram is written
+    //   to `<output-name>.samples`. Samples outside of the program's own code (i.e. in the C library)
+    //   are only counted.
+    // Once the ring buffer is full, every new sample overwrites the oldest one; how many were lost
+    //   that way is written to the file as `dropped`.
+    const size_t SAMPLE_BUFFER_SIZE = 65536; // Must be a power of two.
+    const size_t SAMPLE_INTERVAL_USEC = 1000;
+    // Offsets within glibc's `struct sigaction` and `ucontext_t` on x86_64.
+    const size_t SIGACTION_SIZE = 152;
+    const size_t SIGACTION_FLAGS_OFFSET = 136;
+    const size_t UCONTEXT_RIP_OFFSET = 168;
+    const char* SAMPLE_HEADER = "# corth samples\nsource %s\noutside %zu\ndropped %zu\n";
+    const char* SAMPLE_FORMAT = "%zu %zu %zu\n";
+
+    std::string SamplePath(Context& ctx) {
+        return ctx.OUTPUT_NAME + ".samples";
+    }
+
+    void WriteSamplerSetup_NASM_linux64(std::ostream& asm_file) {
+        asm_file << "    ;; -- sampling profiler: install SIGPROF handler and start timer --\n"
+                 << "    mov qword [sample_sigaction], sample_handler\n"
+                 << "    mov qword [sample_sigaction + " << SIGACTION_FLAGS_OFFSET << "], 0x10000004 ;; SA_RESTART | SA_SIGINFO\n"
+                 << "    mov rdi, 27 ;; SIGPROF\n"
+                 << "    mov rsi, sample_sigaction\n"
+                 << "    xor rdx, rdx\n"
+                 << "    call sigaction\n"
+                 << "    mov rdi, 2 ;; ITIMER_PROF\n"
+                 << "    mov rsi, sample_timer\n"
+                 << "    xor rdx, rdx\n"
+                 << "    call setitimer\n"
+                 << "    jmp sample_start\n"
+                 << "sample_handler:\n"
+                 << "    mov rax, [rdx + " << UCONTEXT_RIP_OFFSET << "]\n"
+                 << "    mov rcx, [sample_count]\n"
+                 << "    and rcx, " << SAMPLE_BUFFER_SIZE - 1 << "\n"
+                 << "    mov [sample_buffer + rcx * 8], rax\n"
+                 << "    inc qword [sample_count]\n"
+                 << "    ret\n"
+                 << "sample_start:\n";
+    }
+
+    void WriteSamplerDump_NASM_linux64(size_t token_count, std::ostream& asm_file) {
+        asm_file << "    ;; -- sampling profiler: stop timer, attribute samples to tokens, write histogram --\n"
+                 << "    and rsp, -16\n"
+                 << "    mov rdi, 2 ;; ITIMER_PROF\n"
+                 << "    mov rsi, sample_timer_stop\n"
+                 << "    xor rdx, rdx\n"
+                 << "    call setitimer\n"
+                 << "    mov r12, [sample_count]\n"
+                 << "    mov rax, " << SAMPLE_BUFFER_SIZE << "\n"
+                 << "    cmp r12, rax\n"
+                 << "    cmova r12, rax\n"
+                 << "    xor r13, r13\n"
+                 << "sample_resolve:\n"
+                 << "    cmp r13, r12\n"
+                 << "    jae sample_write\n"
+                 << "    mov rax, [sample_buffer + r13 * 8]\n"
+                 << "    cmp rax, [sample_locs]\n"
+                 << "    jb sample_outside\n"
+                 << "    mov r9, sample_token_end\n"
+                 << "    cmp rax, r9\n"
+                 << "    jae sample_outside\n"
+                 << "    ;; Find the last token whose code starts at or before the sample\n"
+                 << "    xor rcx, rcx\n"
+                 << "    mov rdx, " << token_count << "\n"
+                 << "sample_search:\n"
+                 << "    mov rsi, rdx\n"
+                 << "    sub rsi, rcx\n"
+                 << "    cmp rsi, 1\n"
+                 << "    jbe sample_found\n"
+                 << "    lea rsi, [rcx + rdx]\n"
+                 << "    shr rsi, 1\n"
+                 << "    imul rdi, rsi, 24\n"
+                 << "    cmp rax, [sample_locs + rdi]\n"
+                 << "    jb sample_search_lower\n"
+                 << "    mov rcx, rsi\n"
+                 << "    jmp sample_search\n"
+                 << "sample_search_lower:\n"
+                 << "    mov rdx, rsi\n"
+                 << "    jmp sample_search\n"
+                 << "sample_found:\n"
+                 << "    inc qword [sample_hits + rcx * 8]\n"
+                 << "    jmp sample_next\n"
+                 << "sample_outside:\n"
+                 << "    inc qword [sample_outside_hits]\n"
+                 << "sample_next:\n"
+                 << "    inc r13\n"
+                 << "    jmp sample_resolve\n"
+                 << "sample_write:\n"
+                 << "    mov rdi, sample_path\n"
+                 << "    mov rsi, write\n"
+                 << "    call fopen\n"
+                 << "    test rax, rax\n"
+                 << "    je sample_done\n"
+                 << "    mov r14, rax\n"
+                 << "    mov rdi, r14\n"
+                 << "    mov rsi, sample_header\n"
+                 << "    mov rdx, sample_source\n"
+                 << "    mov rcx, [sample_outside_hits]\n"
+                 << "    mov r8, [sample_count]\n"
+                 << "    sub r8, r12 ;; samples overwritten before they were resolved\n"
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "    xor r13, r13\n"
+                 << "sample_write_token:\n"
+                 << "    cmp r13, " << token_count << "\n"
+                 << "    jae sample_close\n"
+                 << "    mov r9, [sample_hits + r13 * 8]\n"
+                 << "    test r9, r9\n"
+                 << "    je sample_write_next\n"
+                 << "    imul r15, r13, 24\n"
+                 << "    mov rdi, r14\n"
+                 << "    mov rsi, sample_format\n"
+                 << "    mov rdx, [sample_locs + r15 + 8]\n"
+                 << "    mov rcx, [sample_locs + r15 + 16]\n"
+                 << "    mov r8, r9\n"
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "sample_write_next:\n"
+                 << "    inc r13\n"
+                 << "    jmp sample_write_token\n"
+                 << "sample_close:\n"
+                 << "    mov rdi, r14\n"
+                 << "    call fclose\n"
+                 << "sample_done:\n";
+    }
+
+    void WriteSamplerData_NASM_linux64(Context& ctx, Program& prog, std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    SECTION .data\n"
+                 << "sample_path db " << NASMBytes(SamplePath(ctx)) << '\n'
+                 << "sample_header db " << NASMBytes(SAMPLE_HEADER) << '\n'
+                 << "sample_source db " << NASMBytes(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << '\n'
+                 << "sample_format db " << NASMBytes(SAMPLE_FORMAT) << '\n'
+                 << "    align 8\n"
+                 << "sample_timer dq 0, " << SAMPLE_INTERVAL_USEC << ", 0, " << SAMPLE_INTERVAL_USEC << '\n'
+                 << "sample_timer_stop dq 0, 0, 0, 0\n"
+                 << "    ;; ADDRESS, LINE AND COLUMN OF EVERY TOKEN'S CODE\n"
+                 << "sample_locs:\n";
+        for (size_t i = 0; i < prog.tokens.size(); i++) {
+            asm_file << "    dq sample_token_" << i << ", "
+                     << prog.tokens[i].line_number << ", " << prog.tokens[i].col_number << '\n';
+        }
+        asm_file << "    dq sample_token_end, 0, 0\n"
+                 << "    SECTION .bss\n"
+                 << "    alignb 8\n"
+                 << "    sample_sigaction resb " << SIGACTION_SIZE << '\n'
+                 << "    sample_buffer resq " << SAMPLE_BUFFER_SIZE << '\n'
+                 << "    sample_count resq 1\n"
+                 << "    sample_outside_hits resq 1\n"
+                 << "    sample_hits resq " << std::max<size_t>(prog.tokens.size(), 1) << '\n';
+    }
+
+    void WriteSamplerSetup_GAS_linux64(std::ostream& asm_file) {
+        asm_file << "    # -- sampling profiler: install SIGPROF handler and start timer --\n"
+                 << "    lea sample_handler(%rip), %rax\n"
+                 << "    mov %rax, sample_sigaction(%rip)\n"
+                 << "    movq $0x10000004, sample_sigaction+" << SIGACTION_FLAGS_OFFSET << "(%rip) # SA_RESTART | SA_SIGINFO\n"
+                 << "    mov $27, %rdi # SIGPROF\n"
+                 << "    lea sample_sigaction(%rip), %rsi\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    call sigaction\n"
+                 << "    mov $2, %rdi # ITIMER_PROF\n"
+                 << "    lea sample_timer(%rip), %rsi\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    call setitimer\n"
+                 << "    jmp sample_start\n"
+                 << "sample_handler:\n"
+                 << "    mov " << UCONTEXT_RIP_OFFSET << "(%rdx), %rax\n"
+                 << "    mov sample_count(%rip), %rcx\n"
+                 << "    and $" << SAMPLE_BUFFER_SIZE - 1 << ", %rcx\n"
+                 << "    lea sample_buffer(%rip), %r8\n"
+                 << "    mov %rax, (%r8,%rcx,8)\n"
+                 << "    incq sample_count(%rip)\n"
+                 << "    ret\n"
+                 << "sample_start:\n";
+    }
+
+    void WriteSamplerDump_GAS_linux64(size_t token_count, std::ostream& asm_file) {
+        asm_file << "    # -- sampling profiler: stop timer, attribute samples to tokens, write histogram --\n"
+                 << "    and $-16, %rsp\n"
+                 << "    mov $2, %rdi # ITIMER_PROF\n"
+                 << "    lea sample_timer_stop(%rip), %rsi\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    call setitimer\n"
+                 << "    mov sample_count(%rip), %r12\n"
+                 << "    mov $" << SAMPLE_BUFFER_SIZE << ", %rax\n"
+                 << "    cmp %rax, %r12\n"
+                 << "    cmova %rax, %r12\n"
+                 << "    lea sample_locs(%rip), %r15\n"
+                 << "    xor %r13, %r13\n"
+                 << "sample_resolve:\n"
+                 << "    cmp %r12, %r13\n"
+                 << "    jae sample_write\n"
+                 << "    lea sample_buffer(%rip), %rax\n"
+                 << "    mov (%rax,%r13,8), %rax\n"
+                 << "    cmp (%r15), %rax\n"
+                 << "    jb sample_outside\n"
+                 << "    lea sample_token_end(%rip), %r9\n"
+                 << "    cmp %r9, %rax\n"
+                 << "    jae sample_outside\n"
+                 << "    # Find the last token whose code starts at or before the sample\n"
+                 << "    xor %rcx, %rcx\n"
+                 << "    mov $" << token_count << ", %rdx\n"
+                 << "sample_search:\n"
+                 << "    mov %rdx, %rsi\n"
+                 << "    sub %rcx, %rsi\n"
+                 << "    cmp $1, %rsi\n"
+                 << "    jbe sample_found\n"
+                 << "    lea (%rcx,%rdx), %rsi\n"
+                 << "    shr $1, %rsi\n"
+                 << "    imul $24, %rsi, %rdi\n"
+                 << "    cmp (%r15,%rdi), %rax\n"
+                 << "    jb sample_search_lower\n"
+                 << "    mov %rsi, %rcx\n"
+                 << "    jmp sample_search\n"
+                 << "sample_search_lower:\n"
+                 << "    mov %rsi, %rdx\n"
+                 << "    jmp sample_search\n"
+                 << "sample_found:\n"
+                 << "    lea sample_hits(%rip), %rsi\n"
+                 << "    incq (%rsi,%rcx,8)\n"
+                 << "    jmp sample_next\n"
+                 << "sample_outside:\n"
+                 << "    incq sample_outside_hits(%rip)\n"
+                 << "sample_next:\n"
+                 << "    inc %r13\n"
+                 << "    jmp sample_resolve\n"
+                 << "sample_write:\n"
+                 << "    lea sample_path(%rip), %rdi\n"
+                 << "    lea write(%rip), %rsi\n"
+                 << "    call fopen\n"
+                 << "    test %rax, %rax\n"
+                 << "    je sample_done\n"
+                 << "    mov %rax, %r14\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    lea sample_header(%rip), %rsi\n"
+                 << "    lea sample_source(%rip), %rdx\n"
+                 << "    mov sample_outside_hits(%rip), %rcx\n"
+                 << "    mov sample_count(%rip), %r8\n"
+                 << "    sub %r12, %r8 # samples overwritten before they were resolved\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "    xor %r13, %r13\n"
+                 << "sample_write_token:\n"
+                 << "    cmp $" << token_count << ", %r13\n"
+                 << "    jae sample_close\n"
+                 << "    lea sample_hits(%rip), %rax\n"
+                 << "    mov (%rax,%r13,8), %r8\n"
+                 << "    test %r8, %r8\n"
+                 << "    je sample_write_next\n"
+                 << "    imul $24, %r13, %rax\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    lea sample_format(%rip), %rsi\n"
+                 << "    mov 8(%r15,%rax), %rdx\n"
+                 << "    mov 16(%r15,%rax), %rcx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "sample_write_next:\n"
+                 << "    inc %r13\n"
+                 << "    jmp sample_write_token\n"
+                 << "sample_close:\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    call fclose\n"
+                 << "sample_done:\n";
+    }
+
+    void WriteSamplerData_GAS_linux64(Context& ctx, Program& prog, std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    .data\n"
+                 << "sample_path: .string \"" << EscapeGASString(SamplePath(ctx)) << "\"\n"
+                 << "sample_header: .string \"" << EscapeGASString(SAMPLE_HEADER) << "\"\n"
+                 << "sample_source: .string \"" << EscapeGASString(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << "\"\n"
+                 << "sample_format: .string \"" << EscapeGASString(SAMPLE_FORMAT) << "\"\n"
+                 << "    .p2align 3\n"
+                 << "sample_timer: .quad 0, " << SAMPLE_INTERVAL_USEC << ", 0, " << SAMPLE_INTERVAL_USEC << '\n'
+                 << "sample_timer_stop: .quad 0, 0, 0, 0\n"
+                 << "    # ADDRESS, LINE AND COLUMN OF EVERY TOKEN'S CODE\n"
+                 << "sample_locs:\n";
+        for (size_t i = 0; i < prog.tokens.size(); i++) {
+            asm_file << "    .quad sample_token_" << i << ", "
+                     << prog.tokens[i].line_number << ", " << prog.tokens[i].col_number << '\n';
+        }
+        asm_file << "    .quad sample_token_end, 0, 0\n"
+                 << "    .bss\n"
+                 << "    .comm sample_sigaction, " << SIGACTION_SIZE << ", 8\n"
+                 << "    .comm sample_buffer, " << 8 * SAMPLE_BUFFER_SIZE << ", 8\n"
+                 << "    .comm sample_count, 8, 8\n"
+                 << "    .comm sample_outside_hits, 8, 8\n"
+                 << "    .comm sample_hits, " << 8 * std::max<size_t>(prog.tokens.size(), 1) << ", 8\n";
+    }
+
+    // GROWABLE MEMORY
+    // With `-mem-grow`, `mem` is only reserved when the program starts (mapped `PROT_NONE`), and
+    //   becomes usable from its start up to a high-water mark that only ever grows.
+    // `mem_commit` makes sure the first `rdi` bytes are usable, growing the mark to at least double
+    //   its size (in whole chunks) so that a program filling `mem` sequentially only faults a few times.
+    // Touching `mem` past the mark raises SIGSEGV; the handler grows the mark over the faulting
+    //   address and returns, so that the access is retried. Any other fault gets the default action.
+    // The C library and the kernel do not fault when they write to `mem` on the program's behalf (`fread`
+    //   fails, io_uring reports -EFAULT), so `mem_commit_range` commits a buffer up front: `rdi` is its
+    //   address and `rax` its length; parts outside of `mem` are left alone, and argument registers survive.
+    const uint64_t MEM_GROW_CHUNK = 2 * 1024 * 1024;
+
+    void WriteMemGrowSetup_NASM_linux64(Context& ctx, std::ostream& asm_file) {
+        asm_file << "    ;; -- growable mem: commit pages on demand from a SIGSEGV handler --\n"
+                 << "    mov qword [mem_fault_sigaction], mem_fault_handler\n"
+                 << "    mov qword [mem_fault_sigaction + " << SIGACTION_FLAGS_OFFSET << "], 0x10000004 ;; SA_RESTART | SA_SIGINFO\n"
+                 << "    mov rdi, 11 ;; SIGSEGV\n"
+                 << "    mov rsi, mem_fault_sigaction\n"
+                 << "    xor rdx, rdx\n"
+                 << "    call sigaction\n"
+                 << "    jmp mem_grow_start\n"
+                 << "mem_commit:\n"
+                 << "    mov rax, [mem_committed]\n"
+                 << "    cmp rdi, rax\n"
+                 << "    jbe mem_commit_done\n"
+                 << "    mov rdx, " << ctx.MEM_SIZE << '\n'
+                 << "    cmp rdi, rdx\n"
+                 << "    ja mem_commit_failed\n"
+                 << "    lea rsi, [rdi + " << MEM_GROW_CHUNK - 1 << "]\n"
+                 << "    and rsi, -" << MEM_GROW_CHUNK << '\n'
+                 << "    lea rcx, [rax + rax]\n"
+                 << "    cmp rsi, rcx\n"
+                 << "    cmovb rsi, rcx\n"
+                 << "    cmp rsi, rdx\n"
+                 << "    cmova rsi, rdx\n"
+                 << "    push rsi\n"
+                 << "    mov rdi, [mem_ptr]\n"
+                 << "    add rdi, rax\n"
+                 << "    sub rsi, rax\n"
+                 << "    mov rdx, 3 ;; PROT_READ | PROT_WRITE\n"
+                 << "    call mprotect\n"
+                 << "    pop rsi\n"
+                 << "    test rax, rax\n"
+                 << "    jne mem_commit_failed\n"
+                 << "    mov [mem_committed], rsi\n"
+                 << "mem_commit_done:\n"
+                 << "    mov rax, 1\n"
+                 << "    ret\n"
+                 << "mem_commit_failed:\n"
+                 << "    xor eax, eax\n"
+                 << "    ret\n"
+                 << "mem_commit_range:\n"
+                 << "    push rdi\n"
+                 << "    push rsi\n"
+                 << "    push rdx\n"
+                 << "    push rcx\n"
+                 << "    push r8\n"
+                 << "    mov rdx, " << ctx.MEM_SIZE << '\n'
+                 << "    sub rdi, [mem_ptr]\n"
+                 << "    cmp rdi, rdx\n"
+                 << "    jae mem_commit_range_done\n"
+                 << "    add rdi, rax\n"
+                 << "    cmovc rdi, rdx\n"
+                 << "    cmp rdi, rdx\n"
+                 << "    cmova rdi, rdx\n"
+                 << "    call mem_commit\n"
+                 << "mem_commit_range_done:\n"
+                 << "    pop r8\n"
+                 << "    pop rcx\n"
+                 << "    pop rdx\n"
+                 << "    pop rsi\n"
+                 << "    pop rdi\n"
+                 << "    ret\n"
+                 << "mem_fault_handler:\n"
+                 << "    mov rax, [rsi + 16] ;; siginfo_t::si_addr\n"
+                 << "    sub rax, [mem_ptr]\n"
+                 << "    mov rdx, " << ctx.MEM_SIZE << '\n'
+                 << "    cmp rax, rdx\n"
+                 << "    jae mem_fault_unhandled\n"
+                 << "    lea rdi, [rax + 1]\n"
+                 << "    sub rsp, 8\n"
+                 << "    call mem_commit\n"
+                 << "    add rsp, 8\n"
+                 << "    test rax, rax\n"
+                 << "    je mem_fault_unhandled\n"
+                 << "    ret\n"
+                 << "mem_fault_unhandled:\n"
+                 << "    ;; Restore the default action; the access faults again and the program dies as it would have.\n"
+                 << "    sub rsp, 8\n"
+                 << "    mov rdi, 11 ;; SIGSEGV\n"
+                 << "    mov rsi, mem_fault_default\n"
+                 << "    xor rdx, rdx\n"
+                 << "    call sigaction\n"
+                 << "    add rsp, 8\n"
+                 << "    ret\n"
+                 << "mem_grow_start:\n";
+    }
+
+    void WriteMemGrowSetup_GAS_linux64(Context& ctx, std::ostream& asm_file) {
+        asm_file << "    # -- growable mem: commit pages on demand from a SIGSEGV handler --\n"
+                 << "    lea mem_fault_handler(%rip), %rax\n"
+                 << "    mov %rax, mem_fault_sigaction(%rip)\n"
+                 << "    movq $0x10000004, mem_fault_sigaction+" << SIGACTION_FLAGS_OFFSET << "(%rip) # SA_RESTART | SA_SIGINFO\n"
+                 << "    mov $11, %rdi # SIGSEGV\n"
+                 << "    lea mem_fault_sigaction(%rip), %rsi\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    call sigaction\n"
+                 << "    jmp mem_grow_start\n"
+                 << "mem_commit:\n"
+                 << "    mov mem_committed(%rip), %rax\n"
+                 << "    cmp %rax, %rdi\n"
+                 << "    jbe mem_commit_done\n"
+                 << "    mov $" << ctx.MEM_SIZE << ", %rdx\n"
+                 << "    cmp %rdx, %rdi\n"
+                 << "    ja mem_commit_failed\n"
+                 << "    lea " << MEM_GROW_CHUNK - 1 << "(%rdi), %rsi\n"
+                 << "    and $-" << MEM_GROW_CHUNK << ", %rsi\n"
+                 << "    lea (%rax,%rax), %rcx\n"
+                 << "    cmp %rcx, %rsi\n"
+                 << "    cmovb %rcx, %rsi\n"
+                 << "    cmp %rdx, %rsi\n"
+                 << "    cmova %rdx, %rsi\n"
+                 << "    push %rsi\n"
+                 << "    mov mem_ptr(%rip), %rdi\n"
+                 << "    add %rax, %rdi\n"
+                 << "    sub %rax, %rsi\n"
+                 << "    mov $3, %rdx # PROT_READ | PROT_WRITE\n"
+                 << "    call mprotect\n"
+                 << "    pop %rsi\n"
+                 << "    test %rax, %rax\n"
+                 << "    jne mem_commit_failed\n"
+                 << "    mov %rsi, mem_committed(%rip)\n"
+                 << "mem_commit_done:\n"
+                 << "    mov $1, %rax\n"
+                 << "    ret\n"
+                 << "mem_commit_failed:\n"
+                 << "    xor %eax, %eax\n"
+                 << "    ret\n"
+                 << "mem_commit_range:\n"
+                 << "    push %rdi\n"
+                 << "    push %rsi\n"
+                 << "    push %rdx\n"
+                 << "    push %rcx\n"
+                 << "    push %r8\n"
+                 << "    mov $" << ctx.MEM_SIZE << ", %rdx\n"
+                 << "    sub mem_ptr(%rip), %rdi\n"
+                 << "    cmp %rdx, %rdi\n"
+                 << "    jae mem_commit_range_done\n"
+                 << "    add %rax, %rdi\n"
+                 << "    cmovc %rdx, %rdi\n"
+                 << "    cmp %rdx, %rdi\n"
+                 << "    cmova %rdx, %rdi\n"
+                 << "    call mem_commit\n"
+                 << "mem_commit_range_done:\n"
+                 << "    pop %r8\n"
+                 << "    pop %rcx\n"
+                 << "    pop %rdx\n"
+                 << "    pop %rsi\n"
+                 << "    pop %rdi\n"
+                 << "    ret\n"
+                 << "mem_fault_handler:\n"
+                 << "    mov 16(%rsi), %rax # siginfo_t::si_addr\n"
+                 << "    sub mem_ptr(%rip), %rax\n"
+                 << "    mov $" << ctx.MEM_SIZE << ", %rdx\n"
+                 << "    cmp %rdx, %rax\n"
+                 << "    jae mem_fault_unhandled\n"
+                 << "    lea 1(%rax), %rdi\n"
+                 << "    sub $8, %rsp\n"
+                 << "    call mem_commit\n"
+                 << "    add $8, %rsp\n"
+                 << "    test %rax, %rax\n"
+                 << "    je mem_fault_unhandled\n"
+                 << "    ret\n"
+                 << "mem_fault_unhandled:\n"
+                 << "    # Restore the default action; the access faults again and the program dies as it would have.\n"
+                 << "    sub $8, %rsp\n"
+                 << "    mov $11, %rdi # SIGSEGV\n"
+                 << "    lea mem_fault_default(%rip), %rsi\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    call sigaction\n"
+                 << "    add $8, %rsp\n"
+                 << "    ret\n"
+                 << "mem_grow_start:\n";
+    }
+
+    // HARDWARE COUNTERS
+    // With `-perfstat`, the program opens one `perf_event_open` counter per entry below when it starts,
+    //   and prints their values to stderr when it exits. Counters the machine or kernel can't provide are
+    //   reported as `n/a`. Only user-space events are counted, so no privileges are needed.
+    struct PerfCounter {
+        const char* name;
+        // PERF_COUNT_HW_* event of type PERF_TYPE_HARDWARE
+        uint64_t config;
+    };
+    // Instructions per cycle is derived from the first two.
+    const PerfCounter PERFSTAT_COUNTERS[] = {
+        { "cycles",        0 },
+        { "instructions",  1 },
+        { "cache-misses",  3 },
+        { "branch-misses", 5 },
+    };
+    const size_t PERFSTAT_COUNTER_COUNT = sizeof(PERFSTAT_COUNTERS) / sizeof(PERFSTAT_COUNTERS[0]);
+    const size_t SYS_PERF_EVENT_OPEN = 298;
+    const size_t PERF_EVENT_ATTR_SIZE = 128;
+    // `exclude_kernel | exclude_hv` in the flags of `struct perf_event_attr`
+    const size_t PERF_EVENT_ATTR_FLAGS = 0x60;
+
+    void WritePerfStatOpen_NASM_linux64(std::ostream& asm_file) {
+        asm_file << "    ;; -- perfstat: open hardware counters --\n"
+                 << "    xor r12, r12\n"
+                 << "perf_open:\n"
+                 << "    mov rdi, " << SYS_PERF_EVENT_OPEN << " ;; SYS_perf_event_open\n"
+                 << "    imul rsi, r12, " << PERF_EVENT_ATTR_SIZE << '\n'
+                 << "    add rsi, perf_attrs\n"
+                 << "    xor rdx, rdx ;; this process\n"
+                 << "    mov rcx, -1 ;; on any CPU\n"
+                 << "    mov r8, -1 ;; in no group\n"
+                 << "    xor r9, r9\n"
+                 << "    xor eax, eax\n"
+                 << "    call syscall\n"
+                 << "    mov [perf_fds + r12 * 8], rax\n"
+                 << "    inc r12\n"
+                 << "    cmp r12, " << PERFSTAT_COUNTER_COUNT << '\n'
+                 << "    jb perf_open\n";
+    }
+
+    void WritePerfStatReport_NASM_linux64(std::ostream& asm_file) {
+        asm_file << "    ;; -- perfstat: read hardware counters and report them on stderr --\n"
+                 << "    and rsp, -16\n"
+                 << "    mov rdi, 2\n"
+                 << "    mov rsi, perf_prefix\n"
+                 << "    xor eax, eax\n"
+                 << "    call dprintf\n"
+                 << "    xor r12, r12\n"
+                 << "perf_report:\n"
+                 << "    mov rsi, [perf_fds + r12 * 8]\n"
+                 << "    test rsi, rsi\n"
+                 << "    js perf_unavailable\n"
+                 << "    mov rdi, 0 ;; SYS_read\n"
+                 << "    lea rdx, [perf_values + r12 * 8]\n"
+                 << "    mov rcx, 8\n"
+                 << "    xor eax, eax\n"
+                 << "    call syscall\n"
+                 << "    cmp rax, 8\n"
+                 << "    je perf_available\n"
+                 << "    mov qword [perf_fds + r12 * 8], -1\n"
+                 << "perf_unavailable:\n"
+                 << "    mov rdi, 2\n"
+                 << "    mov rsi, perf_unavailable_fmt\n"
+                 << "    mov rdx, [perf_names + r12 * 8]\n"
+                 << "    xor eax, eax\n"
+                 << "    call dprintf\n"
+                 << "    jmp perf_next\n"
+                 << "perf_available:\n"
+                 << "    mov rdi, 2\n"
+                 << "    mov rsi, perf_fmt\n"
+                 << "    mov rdx, [perf_names + r12 * 8]\n"
+                 << "    mov rcx, [perf_values + r12 * 8]\n"
+                 << "    xor eax, eax\n"
+                 << "    call dprintf\n"
+                 << "perf_next:\n"
+                 << "    inc r12\n"
+                 << "    cmp r12, " << PERFSTAT_COUNTER_COUNT << '\n'
+                 << "    jb perf_report\n"
+                 << "    ;; Instructions per cycle, to two decimal places\n"
+                 << "    mov rax, [perf_fds]\n"
+                 << "    or rax, [perf_fds + 8]\n"
+                 << "    js perf_end\n"
+                 << "    mov rcx, [perf_values]\n"
+                 << "    test rcx, rcx\n"
+                 << "    je perf_end\n"
+                 << "    imul rax, [perf_values + 8], 100\n"
+                 << "    xor rdx, rdx\n"
+                 << "    div rcx\n"
+                 << "    mov rcx, 100\n"
+                 << "    xor rdx, rdx\n"
+                 << "    div rcx\n"
+                 << "    mov rcx, rdx\n"
+                 << "    mov rdx, rax\n"
+                 << "    mov rdi, 2\n"
+                 << "    mov rsi, perf_ipc_fmt\n"
+                 << "    xor eax, eax\n"
+                 << "    call dprintf\n"
+                 << "perf_end:\n"
+                 << "    mov rdi, 2\n"
+                 << "    mov rsi, perf_newline\n"
+                 << "    xor eax, eax\n"
+                 << "    call dprintf\n";
+    }
+
+    void WritePerfStatData_NASM_linux64(std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    SECTION .data\n"
+                 << "perf_prefix db " << NASMBytes("perfstat:") << '\n'
+                 << "perf_fmt db " << NASMBytes(" %s=%lu") << '\n'
+                 << "perf_unavailable_fmt db " << NASMBytes(" %s=n/a") << '\n'
+                 << "perf_ipc_fmt db " << NASMBytes(" ipc=%lu.%02lu") << '\n'
+                 << "perf_newline db " << NASMBytes("\n") << '\n';
+        for (size_t i = 0; i < PERFSTAT_COUNTER_COUNT; i++) {
+            asm_file << "perf_name_" << i << " db " << NASMBytes(PERFSTAT_COUNTERS[i].name) << '\n';
+        }
+        asm_file << "    align 8\n"
+                 << "perf_names:\n";
+        for (size_t i = 0; i < PERFSTAT_COUNTER_COUNT; i++) {
+            asm_file << "    dq perf_name_" << i << '\n';
+        }
+        asm_file << "    ;; struct perf_event_attr { type, size, config, sample_period, sample_type, read_format, flags, ... }\n"
+                 << "perf_attrs:\n";
+        for (auto& counter : PERFSTAT_COUNTERS) {
+            asm_file << "    dd 0, " << PERF_EVENT_ATTR_SIZE << '\n'
+                     << "    dq " << counter.config << ", 0, 0, 0, " << PERF_EVENT_ATTR_FLAGS << '\n'
+                     << "    times " << PERF_EVENT_ATTR_SIZE - 48 << " db 0\n";
+        }
+        asm_file << "    SECTION .bss\n"
+                 << "    alignb 8\n"
+                 << "    perf_fds resq " << PERFSTAT_COUNTER_COUNT << '\n'
+                 << "    perf_values resq " << PERFSTAT_COUNTER_COUNT << '\n';
+    }
+
+    void WritePerfStatOpen_GAS_linux64(std::ostream& asm_file) {
+        asm_file << "    # -- perfstat: open hardware counters --\n"
+                 << "    xor %r12, %r12\n"
+                 << "perf_open:\n"
+                 << "    mov $" << SYS_PERF_EVENT_OPEN << ", %rdi # SYS_perf_event_open\n"
+                 << "    imul $" << PERF_EVENT_ATTR_SIZE << ", %r12, %rsi\n"
+                 << "    lea perf_attrs(%rip), %rax\n"
+                 << "    add %rax, %rsi\n"
+                 << "    xor %rdx, %rdx # this process\n"
+                 << "    mov $-1, %rcx # on any CPU\n"
+                 << "    mov $-1, %r8 # in no group\n"
+                 << "    xor %r9, %r9\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call syscall\n"
+                 << "    lea perf_fds(%rip), %rcx\n"
+                 << "    mov %rax, (%rcx,%r12,8)\n"
+                 << "    inc %r12\n"
+                 << "    cmp $" << PERFSTAT_COUNTER_COUNT << ", %r12\n"
+                 << "    jb perf_open\n";
+    }
+
+    void WritePerfStatReport_GAS_linux64(std::ostream& asm_file) {
+        asm_file << "    # -- perfstat: read hardware counters and report them on stderr --\n"
+                 << "    and $-16, %rsp\n"
+                 << "    mov $2, %rdi\n"
+                 << "    lea perf_prefix(%rip), %rsi\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call dprintf\n"
+                 << "    xor %r12, %r12\n"
+                 << "perf_report:\n"
+                 << "    lea perf_fds(%rip), %rax\n"
+                 << "    mov (%rax,%r12,8), %rsi\n"
+                 << "    test %rsi, %rsi\n"
+                 << "    js perf_unavailable\n"
+                 << "    mov $0, %rdi # SYS_read\n"
+                 << "    lea perf_values(%rip), %rdx\n"
+                 << "    lea (%rdx,%r12,8), %rdx\n"
+                 << "    mov $8, %rcx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call syscall\n"
+                 << "    cmp $8, %rax\n"
+                 << "    je perf_available\n"
+                 << "    lea perf_fds(%rip), %rax\n"
+                 << "    movq $-1, (%rax,%r12,8)\n"
+                 << "perf_unavailable:\n"
+                 << "    mov $2, %rdi\n"
+                 << "    lea perf_unavailable_fmt(%rip), %rsi\n"
+                 << "    lea perf_names(%rip), %rax\n"
+                 << "    mov (%rax,%r12,8), %rdx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call dprintf\n"
+                 << "    jmp perf_next\n"
+                 << "perf_available:\n"
+                 << "    mov $2, %rdi\n"
+                 << "    lea perf_fmt(%rip), %rsi\n"
+                 << "    lea perf_names(%rip), %rax\n"
+                 << "    mov (%rax,%r12,8), %rdx\n"
+                 << "    lea perf_values(%rip), %rax\n"
+                 << "    mov (%rax,%r12,8), %rcx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call dprintf\n"
+                 << "perf_next:\n"
+                 << "    inc %r12\n"
+                 << "    cmp $" << PERFSTAT_COUNTER_COUNT << ", %r12\n"
+                 << "    jb perf_report\n"
+                 << "    # Instructions per cycle, to two decimal places\n"
+                 << "    mov perf_fds(%rip), %rax\n"
+                 << "    or perf_fds+8(%rip), %rax\n"
+                 << "    js perf_end\n"
+                 << "    mov perf_values(%rip), %rcx\n"
+                 << "    test %rcx, %rcx\n"
+                 << "    je perf_end\n"
+                 << "    imul $100, perf_values+8(%rip), %rax\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    div %rcx\n"
+                 << "    mov $100, %rcx\n"
+                 << "    xor %rdx, %rdx\n"
+                 << "    div %rcx\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    mov %rax, %rdx\n"
+                 << "    mov $2, %rdi\n"
+                 << "    lea perf_ipc_fmt(%rip), %rsi\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call dprintf\n"
+                 << "perf_end:\n"
+                 << "    mov $2, %rdi\n"
+                 << "    lea perf_newline(%rip), %rsi\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call dprintf\n";
+    }
+
+    void WritePerfStatData_GAS_linux64(std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    .data\n"
+                 << "perf_prefix: .string \"perfstat:\"\n"
+                 << "perf_fmt: .string \" %s=%lu\"\n"
+                 << "perf_unavailable_fmt: .string \" %s=n/a\"\n"
+                 << "perf_ipc_fmt: .string \" ipc=%lu.%02lu\"\n"
+                 << "perf_newline: .string \"\\n\"\n";
+        for (size_t i = 0; i < PERFSTAT_COUNTER_COUNT; i++) {
+            asm_file << "perf_name_" << i << ": .string \"" << PERFSTAT_COUNTERS[i].name << "\"\n";
+        }
+        asm_file << "    .p2align 3\n"
+                 << "perf_names:\n";
+        for (size_t i = 0; i < PERFSTAT_COUNTER_COUNT; i++) {
+            asm_file << "    .quad perf_name_" << i << '\n';
+        }
+        asm_file << "    # struct perf_event_attr { type, size, config, sample_period, sample_type, read_format, flags, ... }\n"
+                 << "perf_attrs:\n";
+        for (auto& counter : PERFSTAT_COUNTERS) {
+            asm_file << "    .long 0, " << PERF_EVENT_ATTR_SIZE << '\n'
+                     << "    .quad " << counter.config << ", 0, 0, 0, " << PERF_EVENT_ATTR_FLAGS << '\n'
+                     << "    .zero " << PERF_EVENT_ATTR_SIZE - 48 << '\n';
+        }
+        asm_file << "    .bss\n"
+                 << "    .comm perf_fds, " << 8 * PERFSTAT_COUNTER_COUNT << ", 8\n"
+                 << "    .comm perf_values, " << 8 * PERFSTAT_COUNTER_COUNT << ", 8\n";
+    }
+
+    // MEMORY ACCESS TRACING
+    // With `-memtrace`, every load from and store to `mem` counts towards the cache line it touches,
+    //   split into reads and writes. Every load/store keyword in the source (an access site) also
+    //   counts its accesses, how many of them were split across two cache lines, how many were to
+    //   memory outside of `mem` (i.e. string literals), and the first and last cache line it touched.
+    // Both tables are written to `<output-name>.memtrace` on exit.
+    // The per-line tables grow with `mem`, so they are mapped at start-up like a large `mem`;
+    //   pages of them that are never touched cost nothing.
+    const size_t MEMTRACE_LINE_SIZE = 64;
+    const char* MEMTRACE_HEADER = "# corth memtrace\nsource %s\nline_size %zu\n";
+    const char* MEMTRACE_LINE_FORMAT = "line %zu %zu %zu\n";
+    const char* MEMTRACE_SITE_FORMAT = "site %zu %zu %s %zu %zu %zu %zu %zu\n";
+
+    // Size in bytes of the memory a token loads or stores, or zero if it doesn't access memory.
+    size_t MemoryAccessSize(const Token& tok) {
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                      "Exhaustive handling of keywords in MemoryAccessSize. Keep in mind not all keywords access memory.");
+        if (tok.type != TokenType::KEYWORD) { return 0; }
+        if (tok.text == GetKeywordStr(Keyword::LOADB) || tok.text == GetKeywordStr(Keyword::STOREB)) { return 1; }
+        if (tok.text == GetKeywordStr(Keyword::LOADW) || tok.text == GetKeywordStr(Keyword::STOREW)) { return 2; }
+        if (tok.text == GetKeywordStr(Keyword::LOADD) || tok.text == GetKeywordStr(Keyword::STORED)) { return 4; }
+        if (tok.text == GetKeywordStr(Keyword::LOADQ) || tok.text == GetKeywordStr(Keyword::STOREQ)) { return 8; }
+        return 0;
+    }
+
+    // Stores take their address from beneath the value to store.
+    bool IsMemoryStore(const Token& tok) {
+        return MemoryAccessSize(tok) != 0 && tok.text.compare(0, 5, "store") == 0;
+    }
+
+    std::string MemTracePath(Context& ctx) {
+        return ctx.OUTPUT_NAME + ".memtrace";
+    }
+
+    // One extra line for accesses that run past the end of `mem`.
+    uint64_t MemTraceLineCount(const Context& ctx) {
+        return (ctx.MEM_SIZE + MEMTRACE_LINE_SIZE - 1) / MEMTRACE_LINE_SIZE + 1;
+    }
+
+    void WriteMemTraceSetup_NASM_linux64(Context& ctx, std::ostream& asm_file) {
+        asm_file << "    ;; -- memtrace: map cache line counters --\n";
+        for (const char* table : { "memtrace_reads", "memtrace_writes" }) {
+            asm_file << "    xor rdi, rdi\n"
+                     << "    mov rsi, " << 8 * MemTraceLineCount(ctx) << '\n'
+                     << "    mov rdx, 3 ;; PROT_READ | PROT_WRITE\n"
+                     << "    mov rcx, " << (MAP_PRIVATE_ANONYMOUS | MAP_NORESERVE_FLAG) << " ;; MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE\n"
+                     << "    mov r8, -1\n"
+                     << "    xor r9, r9\n"
+                     << "    call mmap\n"
+                     << "    cmp rax, -1\n"
+                     << "    je memtrace_alloc_failed\n"
+                     << "    mov [" << table << "], rax\n";
+        }
+        asm_file << "    jmp memtrace_allocated\n"
+                 << "memtrace_alloc_failed:\n"
+                 << "    mov rdi, memtrace_alloc_error\n"
+                 << "    call perror\n"
+                 << "    mov rdi, 1\n"
+                 << "    call exit\n"
+                 << "memtrace_allocated:\n";
+    }
+
+    void WriteMemTraceSetup_GAS_linux64(Context& ctx, std::ostream& asm_file) {
+        asm_file << "    # -- memtrace: map cache line counters --\n";
+        for (const char* table : { "memtrace_reads", "memtrace_writes" }) {
+            asm_file << "    xor %rdi, %rdi\n"
+                     << "    mov $" << 8 * MemTraceLineCount(ctx) << ", %rsi\n"
+                     << "    mov $3, %rdx # PROT_READ | PROT_WRITE\n"
+                     << "    mov $" << (MAP_PRIVATE_ANONYMOUS | MAP_NORESERVE_FLAG) << ", %rcx # MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE\n"
+                     << "    mov $-1, %r8\n"
+                     << "    xor %r9, %r9\n"
+                     << "    call mmap\n"
+                     << "    cmp $-1, %rax\n"
+                     << "    je memtrace_alloc_failed\n"
+                     << "    mov %rax, " << table << "(%rip)\n";
+        }
+        asm_file << "    jmp memtrace_allocated\n"
+                 << "memtrace_alloc_failed:\n"
+                 << "    lea memtrace_alloc_error(%rip), %rdi\n"
+                 << "    call perror\n"
+                 << "    mov $1, %rdi\n"
+                 << "    call exit\n"
+                 << "memtrace_allocated:\n";
+    }
+
+    // Count the access about to be made by the load/store at `tok`; emitted just before it.
+    void WriteMemTraceAccess_NASM_linux64(Context& ctx, const Token& tok, size_t site, std::ostream& asm_file) {
+        size_t size = MemoryAccessSize(tok);
+        std::string counters = IsMemoryStore(tok) ? "memtrace_writes" : "memtrace_reads";
+        asm_file << "    ;; -- memtrace: count access --\n"
+                 << "    mov rax, [rsp" << (IsMemoryStore(tok) ? " + 8" : "") << "]\n"
+                 << "    sub rax, " << (MemIsMapped(ctx) ? "[mem_ptr]" : "mem") << '\n'
+                 << "    mov rdx, " << ctx.MEM_SIZE << '\n'
+                 << "    cmp rax, rdx\n"
+                 << "    jb memtrace_in_" << site << '\n'
+                 << "    inc qword [memtrace_site_outside + " << 8 * site << "]\n"
+                 << "    jmp memtrace_done_" << site << '\n'
+                 << "memtrace_in_" << site << ":\n"
+                 << "    lea rcx, [rax + " << size - 1 << "]\n"
+                 << "    shr rax, 6\n"
+                 << "    shr rcx, 6\n"
+                 << "    mov rdx, [" << counters << "]\n"
+                 << "    inc qword [rdx + rax * 8]\n"
+                 << "    inc qword [memtrace_site_hits + " << 8 * site << "]\n"
+                 << "    cmp rcx, rax\n"
+                 << "    je memtrace_range_" << site << '\n'
+                 << "    inc qword [rdx + rcx * 8]\n"
+                 << "    inc qword [memtrace_site_split + " << 8 * site << "]\n"
+                 << "memtrace_range_" << site << ":\n"
+                 << "    mov rdx, [memtrace_site_first + " << 8 * site << "]\n"
+                 << "    cmp rax, rdx\n"
+                 << "    cmovb rdx, rax\n"
+                 << "    mov [memtrace_site_first + " << 8 * site << "], rdx\n"
+                 << "    mov rdx, [memtrace_site_last + " << 8 * site << "]\n"
+                 << "    cmp rcx, rdx\n"
+                 << "    cmova rdx, rcx\n"
+                 << "    mov [memtrace_site_last + " << 8 * site << "], rdx\n"
+                 << "memtrace_done_" << site << ":\n";
+    }
+
+    void WriteMemTraceDump_NASM_linux64(Context& ctx, size_t site_count, std::ostream& asm_file) {
+        asm_file << "    ;; -- memtrace: write cache line and access site counters --\n"
+                 << "    and rsp, -16\n"
+                 << "    mov rdi, memtrace_path\n"
+                 << "    mov rsi, write\n"
+                 << "    call fopen\n"
+                 << "    test rax, rax\n"
+                 << "    je memtrace_finished\n"
+                 << "    mov r14, rax\n"
+                 << "    mov rdi, r14\n"
+                 << "    mov rsi, memtrace_header\n"
+                 << "    mov rdx, memtrace_source\n"
+                 << "    mov rcx, " << MEMTRACE_LINE_SIZE << '\n'
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "    xor r13, r13\n"
+                 << "memtrace_line:\n"
+                 << "    mov rax, " << MemTraceLineCount(ctx) << '\n'
+                 << "    cmp r13, rax\n"
+                 << "    jae memtrace_sites\n"
+                 << "    mov rax, [memtrace_reads]\n"
+                 << "    mov rcx, [rax + r13 * 8]\n"
+                 << "    mov rax, [memtrace_writes]\n"
+                 << "    mov r8, [rax + r13 * 8]\n"
+                 << "    mov rax, rcx\n"
+                 << "    or rax, r8\n"
+                 << "    je memtrace_line_next\n"
+                 << "    mov rdi, r14\n"
+                 << "    mov rsi, memtrace_line_fmt\n"
+                 << "    mov rdx, r13\n"
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "memtrace_line_next:\n"
+                 << "    inc r13\n"
+                 << "    jmp memtrace_line\n"
+                 << "memtrace_sites:\n"
+                 << "    xor r13, r13\n"
+                 << "memtrace_site:\n"
+                 << "    cmp r13, " << site_count << '\n'
+                 << "    jae memtrace_close\n"
+                 << "    imul r15, r13, 24\n"
+                 << "    push qword [memtrace_site_last + r13 * 8]\n"
+                 << "    push qword [memtrace_site_first + r13 * 8]\n"
+                 << "    push qword [memtrace_site_outside + r13 * 8]\n"
+                 << "    push qword [memtrace_site_split + r13 * 8]\n"
+                 << "    mov rdi, r14\n"
+                 << "    mov rsi, memtrace_site_fmt\n"
+                 << "    mov rdx, [memtrace_site_locs + r15]\n"
+                 << "    mov rcx, [memtrace_site_locs + r15 + 8]\n"
+                 << "    mov r8, [memtrace_site_locs + r15 + 16]\n"
+                 << "    mov r9, [memtrace_site_hits + r13 * 8]\n"
+                 << "    xor eax, eax\n"
+                 << "    call fprintf\n"
+                 << "    add rsp, 32\n"
+                 << "    inc r13\n"
+                 << "    jmp memtrace_site\n"
+                 << "memtrace_close:\n"
+                 << "    mov rdi, r14\n"
+                 << "    call fclose\n"
+                 << "memtrace_finished:\n";
+    }
+
+    void WriteMemTraceData_NASM_linux64(Context& ctx, Program& prog, const std::vector<size_t>& sites, std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    SECTION .data\n"
+                 << "memtrace_path db " << NASMBytes(MemTracePath(ctx)) << '\n'
+                 << "memtrace_alloc_error db " << NASMBytes("Could not allocate memory trace counters") << '\n'
+                 << "memtrace_header db " << NASMBytes(MEMTRACE_HEADER) << '\n'
+                 << "memtrace_source db " << NASMBytes(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << '\n'
+                 << "memtrace_line_fmt db " << NASMBytes(MEMTRACE_LINE_FORMAT) << '\n'
+                 << "memtrace_site_fmt db " << NASMBytes(MEMTRACE_SITE_FORMAT) << '\n';
+        for (size_t i = 0; i < sites.size(); i++) {
+            asm_file << "memtrace_site_name_" << i << " db " << NASMBytes(prog.tokens[sites[i]].text) << '\n';
+        }
+        asm_file << "    align 8\n"
+                 << "    ;; LINE, COLUMN AND KEYWORD OF EVERY ACCESS SITE\n"
+                 << "memtrace_site_locs:\n";
+        for (size_t i = 0; i < sites.size(); i++) {
+            Token& tok = prog.tokens[sites[i]];
+            asm_file << "    dq " << tok.line_number << ", " << tok.col_number << ", memtrace_site_name_" << i << '\n';
+        }
+        // The first cache line touched starts out past every real one.
+        asm_file << "memtrace_site_first: times " << std::max<size_t>(sites.size(), 1) << " dq -1\n"
+                 << "    SECTION .bss\n"
+                 << "    alignb 8\n"
+                 << "    memtrace_reads resq 1\n"
+                 << "    memtrace_writes resq 1\n"
+                 << "    memtrace_site_hits resq " << std::max<size_t>(sites.size(), 1) << '\n'
+                 << "    memtrace_site_split resq " << std::max<size_t>(sites.size(), 1) << '\n'
+                 << "    memtrace_site_outside resq " << std::max<size_t>(sites.size(), 1) << '\n'
+                 << "    memtrace_site_last resq " << std::max<size_t>(sites.size(), 1) << '\n';
+    }
+
+    void WriteMemTraceAccess_GAS_linux64(Context& ctx, const Token& tok, size_t site, std::ostream& asm_file) {
+        size_t size = MemoryAccessSize(tok);
+        std::string counters = IsMemoryStore(tok) ? "memtrace_writes" : "memtrace_reads";
+        asm_file << "    # -- memtrace: count access --\n"
+                 << "    mov " << (IsMemoryStore(tok) ? "8" : "") << "(%rsp), %rax\n"
+                 << "    " << (MemIsMapped(ctx) ? "mov mem_ptr(%rip), %rcx" : "lea mem(%rip), %rcx") << '\n'
+                 << "    sub %rcx, %rax\n"
+                 << "    mov $" << ctx.MEM_SIZE << ", %rdx\n"
+                 << "    cmp %rdx, %rax\n"
+                 << "    jb memtrace_in_" << site << '\n'
+                 << "    incq memtrace_site_outside+" << 8 * site << "(%rip)\n"
+                 << "    jmp memtrace_done_" << site << '\n'
+                 << "memtrace_in_" << site << ":\n"
+                 << "    lea " << size - 1 << "(%rax), %rcx\n"
+                 << "    shr $6, %rax\n"
+                 << "    shr $6, %rcx\n"
+                 << "    mov " << counters << "(%rip), %rdx\n"
+                 << "    incq (%rdx,%rax,8)\n"
+                 << "    incq memtrace_site_hits+" << 8 * site << "(%rip)\n"
+                 << "    cmp %rax, %rcx\n"
+                 << "    je memtrace_range_" << site << '\n'
+                 << "    incq (%rdx,%rcx,8)\n"
+                 << "    incq memtrace_site_split+" << 8 * site << "(%rip)\n"
+                 << "memtrace_range_" << site << ":\n"
+                 << "    mov memtrace_site_first+" << 8 * site << "(%rip), %rdx\n"
+                 << "    cmp %rdx, %rax\n"
+                 << "    cmovb %rax, %rdx\n"
+                 << "    mov %rdx, memtrace_site_first+" << 8 * site << "(%rip)\n"
+                 << "    mov memtrace_site_last+" << 8 * site << "(%rip), %rdx\n"
+                 << "    cmp %rdx, %rcx\n"
+                 << "    cmova %rcx, %rdx\n"
+                 << "    mov %rdx, memtrace_site_last+" << 8 * site << "(%rip)\n"
+                 << "memtrace_done_" << site << ":\n";
+    }
+
+    void WriteMemTraceDump_GAS_linux64(Context& ctx, size_t site_count, std::ostream& asm_file) {
+        asm_file << "    # -- memtrace: write cache line and access site counters --\n"
+                 << "    and $-16, %rsp\n"
+                 << "    lea memtrace_path(%rip), %rdi\n"
+                 << "    lea write(%rip), %rsi\n"
+                 << "    call fopen\n"
+                 << "    test %rax, %rax\n"
+                 << "    je memtrace_finished\n"
+                 << "    mov %rax, %r14\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    lea memtrace_header(%rip), %rsi\n"
+                 << "    lea memtrace_source(%rip), %rdx\n"
+                 << "    mov $" << MEMTRACE_LINE_SIZE << ", %rcx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "    xor %r13, %r13\n"
+                 << "memtrace_line:\n"
+                 << "    mov $" << MemTraceLineCount(ctx) << ", %rax\n"
+                 << "    cmp %rax, %r13\n"
+                 << "    jae memtrace_sites\n"
+                 << "    mov memtrace_reads(%rip), %rax\n"
+                 << "    mov (%rax,%r13,8), %rcx\n"
+                 << "    mov memtrace_writes(%rip), %rax\n"
+                 << "    mov (%rax,%r13,8), %r8\n"
+                 << "    mov %rcx, %rax\n"
+                 << "    or %r8, %rax\n"
+                 << "    je memtrace_line_next\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    lea memtrace_line_fmt(%rip), %rsi\n"
+                 << "    mov %r13, %rdx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "memtrace_line_next:\n"
+                 << "    inc %r13\n"
+                 << "    jmp memtrace_line\n"
+                 << "memtrace_sites:\n"
+                 << "    lea memtrace_site_locs(%rip), %r15\n"
+                 << "    xor %r13, %r13\n"
+                 << "memtrace_site:\n"
+                 << "    cmp $" << site_count << ", %r13\n"
+                 << "    jae memtrace_close\n"
+                 << "    lea memtrace_site_last(%rip), %rax\n"
+                 << "    pushq (%rax,%r13,8)\n"
+                 << "    lea memtrace_site_first(%rip), %rax\n"
+                 << "    pushq (%rax,%r13,8)\n"
+                 << "    lea memtrace_site_outside(%rip), %rax\n"
+                 << "    pushq (%rax,%r13,8)\n"
+                 << "    lea memtrace_site_split(%rip), %rax\n"
+                 << "    pushq (%rax,%r13,8)\n"
+                 << "    imul $24, %r13, %rax\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    lea memtrace_site_fmt(%rip), %rsi\n"
+                 << "    mov (%r15,%rax), %rdx\n"
+                 << "    mov 8(%r15,%rax), %rcx\n"
+                 << "    mov 16(%r15,%rax), %r8\n"
+                 << "    lea memtrace_site_hits(%rip), %rax\n"
+                 << "    mov (%rax,%r13,8), %r9\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call fprintf\n"
+                 << "    add $32, %rsp\n"
+                 << "    inc %r13\n"
+                 << "    jmp memtrace_site\n"
+                 << "memtrace_close:\n"
+                 << "    mov %r14, %rdi\n"
+                 << "    call fclose\n"
+                 << "memtrace_finished:\n";
+    }
+
+    void WriteMemTraceData_GAS_linux64(Context& ctx, Program& prog, const std::vector<size_t>& sites, std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    .data\n"
+                 << "memtrace_path: .string \"" << EscapeGASString(MemTracePath(ctx)) << "\"\n"
+                 << "memtrace_alloc_error: .string \"Could not allocate memory trace counters\"\n"
+                 << "memtrace_header: .string \"" << EscapeGASString(MEMTRACE_HEADER) << "\"\n"
+                 << "memtrace_source: .string \"" << EscapeGASString(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << "\"\n"
+                 << "memtrace_line_fmt: .string \"" << EscapeGASString(MEMTRACE_LINE_FORMAT) << "\"\n"
+                 << "memtrace_site_fmt: .string \"" << EscapeGASString(MEMTRACE_SITE_FORMAT) << "\"\n";
+        for (size_t i = 0; i < sites.size(); i++) {
+            asm_file << "memtrace_site_name_" << i << ": .string \"" << prog.tokens[sites[i]].text << "\"\n";
+        }
+        asm_file << "    .p2align 3\n"
+                 << "    # LINE, COLUMN AND KEYWORD OF EVERY ACCESS SITE\n"
+                 << "memtrace_site_locs:\n";
+        for (size_t i = 0; i < sites.size(); i++) {
+            Token& tok = prog.tokens[sites[i]];
+            asm_file << "    .quad " << tok.line_number << ", " << tok.col_number << ", memtrace_site_name_" << i << '\n';
+        }
+        // The first cache line touched starts out past every real one.
+        asm_file << "memtrace_site_first:\n"
+                 << "    .rept " << std::max<size_t>(sites.size(), 1) << "\n"
+                 << "    .quad -1\n"
+                 << "    .endr\n"
+                 << "    .bss\n"
+                 << "    .comm memtrace_reads, 8, 8\n"
+                 << "    .comm memtrace_writes, 8, 8\n"
+                 << "    .comm memtrace_site_hits, " << 8 * std::max<size_t>(sites.size(), 1) << ", 8\n"
+                 << "    .comm memtrace_site_split, " << 8 * std::max<size_t>(sites.size(), 1) << ", 8\n"
+                 << "    .comm memtrace_site_outside, " << 8 * std::max<size_t>(sites.size(), 1) << ", 8\n"
+                 << "    .comm memtrace_site_last, " << 8 * std::max<size_t>(sites.size(), 1) << ", 8\n";
+    }
+
+    // MAPPED FILES
+    // `map_file` maps a whole file with `MAP_SHARED`, so stores through the mapping change the file itself.
+    // The `read` file mode maps it read-only; any other mode maps it read-write. Files are never created
+    //   or truncated, whatever the mode. The file descriptor is closed right away; the mapping keeps the file.
+    // Failure (including an empty file, which can't be mapped) pushes a null address and a length of zero.
+    // The code uses r12-r15 as scratch, as they are only otherwise used by code that runs at exit.
+    bool MapsFiles(const Program& prog) {
+        return std::any_of(prog.tokens.begin(), prog.tokens.end(), [](const Token& tok) {
+            return tok.type == TokenType::KEYWORD
+                && (tok.text == GetKeywordStr(Keyword::MAP_FILE)
+                    || tok.text == GetKeywordStr(Keyword::UNMAP_FILE)
+                    || tok.text == GetKeywordStr(Keyword::MAP_ADVISE));
+        });
+    }
+
+    void WriteMapFile_NASM_linux64(size_t instr_ptr, std::ostream& asm_file) {
+        asm_file << "    ;; -- map file --\n"
+                 << "    pop rsi\n"
+                 << "    pop rdi\n"
+                 << "    ;; r14 = 1 when the mode isn't plain `r`\n"
+                 << "    movzx eax, byte [rsi]\n"
+                 << "    movzx ecx, byte [rsi + 1]\n"
+                 << "    xor r14, r14\n"
+                 << "    cmp al, 'r'\n"
+                 << "    setne r14b\n"
+                 << "    cmp cl, '+'\n"
+                 << "    sete al\n"
+                 << "    or r14b, al\n"
+                 << "    mov rbx, rsp\n"
+                 << "    and rsp, -16\n"
+                 << "    lea rsi, [r14 + r14] ;; O_RDONLY or O_RDWR\n"
+                 << "    xor eax, eax\n"
+                 << "    call open\n"
+                 << "    xor r13, r13\n"
+                 << "    xor r15, r15\n"
+                 << "    mov r12d, eax\n"
+                 << "    test eax, eax\n"
+                 << "    js map_file_done_" << instr_ptr << '\n'
+                 << "    mov edi, r12d\n"
+                 << "    xor esi, esi\n"
+                 << "    mov edx, 2 ;; SEEK_END\n"
+                 << "    call lseek\n"
+                 << "    test rax, rax\n"
+                 << "    jle map_file_close_" << instr_ptr << '\n'
+                 << "    mov r13, rax\n"
+                 << "    xor edi, edi\n"
+                 << "    mov rsi, r13\n"
+                 << "    lea rdx, [r14 + r14 + 1] ;; PROT_READ, or PROT_READ | PROT_WRITE\n"
+                 << "    mov ecx, 1 ;; MAP_SHARED\n"
+                 << "    mov r8, r12\n"
+                 << "    xor r9, r9\n"
+                 << "    call mmap\n"
+                 << "    cmp rax, -1\n"
+                 << "    je map_file_failed_" << instr_ptr << '\n'
+                 << "    mov r15, rax\n"
+                 << "    jmp map_file_close_" << instr_ptr << '\n'
+                 << "map_file_failed_" << instr_ptr << ":\n"
+                 << "    xor r13, r13\n"
+                 << "map_file_close_" << instr_ptr << ":\n"
+                 << "    mov edi, r12d\n"
+                 << "    call close\n"
+                 << "map_file_done_" << instr_ptr << ":\n"
+                 << "    mov rsp, rbx\n"
+                 << "    push r15\n"
+                 << "    push r13\n";
+    }
+
+    void WriteMapFile_GAS_linux64(size_t instr_ptr, std::ostream& asm_file) {
+        asm_file << "    # -- map file --\n"
+                 << "    pop %rsi\n"
+                 << "    pop %rdi\n"
+                 << "    # r14 = 1 when the mode isn't plain `r`\n"
+                 << "    movzbl (%rsi), %eax\n"
+                 << "    movzbl 1(%rsi), %ecx\n"
+                 << "    xor %r14, %r14\n"
+                 << "    cmp $'r', %al\n"
+                 << "    setne %r14b\n"
+                 << "    cmp $'+', %cl\n"
+                 << "    sete %al\n"
+                 << "    or %al, %r14b\n"
+                 << "    mov %rsp, %rbx\n"
+                 << "    and $-16, %rsp\n"
+                 << "    lea (%r14,%r14), %rsi # O_RDONLY or O_RDWR\n"
+                 << "    xor %eax, %eax\n"
+                 << "    call open\n"
+                 << "    xor %r13, %r13\n"
+                 << "    xor %r15, %r15\n"
+                 << "    mov %eax, %r12d\n"
+                 << "    test %eax, %eax\n"
+                 << "    js map_file_done_" << instr_ptr << '\n'
+                 << "    mov %r12d, %edi\n"
+                 << "    xor %esi, %esi\n"
+                 << "    mov $2, %edx # SEEK_END\n"
+                 << "    call lseek\n"
+                 << "    test %rax, %rax\n"
+                 << "    jle map_file_close_" << instr_ptr << '\n'
+                 << "    mov %rax, %r13\n"
+                 << "    xor %edi, %edi\n"
+                 << "    mov %r13, %rsi\n"
+                 << "    lea 1(%r14,%r14), %rdx # PROT_READ, or PROT_READ | PROT_WRITE\n"
+                 << "    mov $1, %ecx # MAP_SHARED\n"
+                 << "    mov %r12, %r8\n"
+                 << "    xor %r9, %r9\n"
+                 << "    call mmap\n"
+                 << "    cmp $-1, %rax\n"
+                 << "    je map_file_failed_" << instr_ptr << '\n'
+                 << "    mov %rax, %r15\n"
+                 << "    jmp map_file_close_" << instr_ptr << '\n'
+                 << "map_file_failed_" << instr_ptr << ":\n"
+                 << "    xor %r13, %r13\n"
+                 << "map_file_close_" << instr_ptr << ":\n"
+                 << "    mov %r12d, %edi\n"
+                 << "    call close\n"
+                 << "map_file_done_" << instr_ptr << ":\n"
+                 << "    mov %rbx, %rsp\n"
+                 << "    push %r15\n"
+                 << "    push %r13\n";
+    }
+
+    // ASYNCHRONOUS FILE I/O
+    // `async_read` and `async_write` submit a read or write at an offset of a file, and push a request
+    //   number right away; `async_wait` blocks until that request completes, and pushes the amount of
+    //   bytes it transferred (zero on failure), so a program can keep computing while the disk works.
+    // Requests go through an io_uring when the kernel provides one. Otherwise (an old kernel, or io_uring
+    //   disabled by a sysctl or a seccomp filter), they fall back to glibc's POSIX AIO, which runs them
+    //   on a pool of threads.
+    // Up to ASYNC_QUEUE_DEPTH requests can be in flight; request `n` shares its slot with request `n + ASYNC_QUEUE_DEPTH`.
+    //   A slot remembers which request is in flight in it (plus one, so that zero means none), and waiting
+    //   for any other request (never submitted, already waited for, or since replaced) returns zero right away.
+    const uint64_t ASYNC_QUEUE_DEPTH = 64;
+    const int IORING_OP_READ = 22;
+    const int IORING_OP_WRITE = 23;
+    const int SYS_IO_URING_SETUP = 425;
+    const int SYS_IO_URING_ENTER = 426;
+    // struct io_uring_params (where the kernel reports the layout of the rings), and the offsets it holds.
+    const size_t IO_URING_PARAMS_SIZE = 120;
+    const size_t IO_URING_SQ_ENTRIES = 0;
+    const size_t IO_URING_CQ_ENTRIES = 4;
+    const size_t IO_URING_SQ_TAIL = 44;
+    const size_t IO_URING_SQ_RING_MASK = 48;
+    const size_t IO_URING_SQ_ARRAY = 64;
+    const size_t IO_URING_CQ_HEAD = 80;
+    const size_t IO_URING_CQ_TAIL = 84;
+    const size_t IO_URING_CQ_RING_MASK = 88;
+    const size_t IO_URING_CQ_CQES = 100;
+    // glibc's struct aiocb
+    const size_t AIOCB_SIZE = 168;
+    const size_t AIOCB_SIGEV_NOTIFY = 44;
+    const size_t AIOCB_OFFSET = 128;
+
+    bool UsesAsyncIO(const Program& prog) {
+        return std::any_of(prog.tokens.begin(), prog.tokens.end(), [](const Token& tok) {
+            return tok.type == TokenType::KEYWORD
+                && (tok.text == GetKeywordStr(Keyword::ASYNC_READ)
+                    || tok.text == GetKeywordStr(Keyword::ASYNC_WRITE)
+                    || tok.text == GetKeywordStr(Keyword::ASYNC_WAIT));
+        });
+    }
+
+    // Sets up the io_uring, and defines `async_submit` and `async_wait` for the keywords to call.
+    void WriteAsyncSetup_NASM_linux64(std::ostream& asm_file) {
+        asm_file << "    ;; -- async I/O: set up an io_uring, or fall back to POSIX AIO --\n"
+                 << "    jmp async_setup\n"
+                 << "async_map_ring:\n"
+                 << "    ;; rsi = size, r9 = offset of the ring; returns its address, or an error above -4096\n"
+                 << "    xor edi, edi\n"
+                 << "    mov edx, 3 ;; PROT_READ | PROT_WRITE\n"
+                 << "    mov r10d, 0x8001 ;; MAP_SHARED | MAP_POPULATE\n"
+                 << "    mov r8, [async_ring_fd]\n"
+                 << "    mov eax, 9 ;; mmap\n"
+                 << "    syscall\n"
+                 << "    ret\n"
+                 << "async_submit:\n"
+                 << "    ;; rdi = opcode, rsi = buffer, rdx = length, rcx = offset, r8 = FILE*; returns the request\n"
+                 << "    push rbx\n"
+                 << "    push r12\n"
+                 << "    push r13\n"
+                 << "    push r14\n"
+                 << "    push r15\n"
+                 << "    sub rsp, 16\n"
+                 << "    mov r12, rdi\n"
+                 << "    mov r13, rsi\n"
+                 << "    mov r14, rdx\n"
+                 << "    mov r15, rcx\n"
+                 << "    mov rdi, r8\n"
+                 << "    call fileno\n"
+                 << "    mov ebx, eax\n"
+                 << "    mov r8, [async_next_id]\n"
+                 << "    inc qword [async_next_id]\n"
+                 << "    mov r9, r8\n"
+                 << "    and r9, " << ASYNC_QUEUE_DEPTH - 1 << '\n'
+                 << "    mov [rsp], r8\n"
+                 << "    mov [rsp + 8], r9\n"
+                 << "    lea rax, [r8 + 1]\n"
+                 << "    mov [async_in_flight + r9 * 8], rax\n"
+                 << "    mov byte [async_done + r9], 0\n"
+                 << "    cmp qword [async_uring], 0\n"
+                 << "    je async_submit_aio\n"
+                 << "    mov rdx, [async_sq_tail]\n"
+                 << "    mov eax, [rdx]\n"
+                 << "    mov ecx, eax\n"
+                 << "    and rcx, [async_sq_mask]\n"
+                 << "    mov rdi, rcx\n"
+                 << "    shl rdi, 6\n"
+                 << "    add rdi, [async_sqes]\n"
+                 << "    xor r10d, r10d\n";
+        for (int offset = 0; offset < 64; offset += 8) {
+            asm_file << "    mov [rdi + " << offset << "], r10\n";
+        }
+        asm_file << "    mov [rdi], r12b ;; opcode\n"
+                 << "    mov [rdi + 4], ebx ;; fd\n"
+                 << "    mov [rdi + 8], r15 ;; offset\n"
+                 << "    mov [rdi + 16], r13 ;; buffer\n"
+                 << "    mov [rdi + 24], r14d ;; length\n"
+                 << "    mov [rdi + 32], r8 ;; user_data: the request\n"
+                 << "    mov r10, [async_sq_array]\n"
+                 << "    mov [r10 + rcx * 4], ecx\n"
+                 << "    inc eax\n"
+                 << "    mov [rdx], eax ;; publish the entry; x86 doesn't reorder stores\n"
+                 << "    mov eax, " << SYS_IO_URING_ENTER << '\n'
+                 << "    mov rdi, [async_ring_fd]\n"
+                 << "    mov esi, 1\n"
+                 << "    xor edx, edx\n"
+                 << "    xor r10d, r10d\n"
+                 << "    xor r8d, r8d\n"
+                 << "    xor r9d, r9d\n"
+                 << "    syscall\n"
+                 << "    cmp rax, 1\n"
+                 << "    jne async_submit_failed\n"
+                 << "async_submit_done:\n"
+                 << "    mov rax, [rsp]\n"
+                 << "    add rsp, 16\n"
+                 << "    pop r15\n"
+                 << "    pop r14\n"
+                 << "    pop r13\n"
+                 << "    pop r12\n"
+                 << "    pop rbx\n"
+                 << "    ret\n"
+                 << "async_submit_failed:\n"
+                 << "    mov r9, [rsp + 8]\n"
+                 << "    mov qword [async_results + r9 * 8], 0\n"
+                 << "    mov byte [async_done + r9], 1\n"
+                 << "    jmp async_submit_done\n"
+                 << "async_submit_aio:\n"
+                 << "    imul rdi, r9, " << AIOCB_SIZE << '\n'
+                 << "    lea rdi, [async_aiocbs + rdi]\n"
+                 << "    mov rdx, rdi\n"
+                 << "    xor eax, eax\n"
+                 << "    mov ecx, " << AIOCB_SIZE / 8 << '\n'
+                 << "    rep stosq\n"
+                 << "    mov rdi, rdx\n"
+                 << "    mov [rdi], ebx ;; aio_fildes\n"
+                 << "    mov [rdi + 16], r13 ;; aio_buf\n"
+                 << "    mov [rdi + 24], r14 ;; aio_nbytes\n"
+                 << "    mov dword [rdi + " << AIOCB_SIGEV_NOTIFY << "], 1 ;; SIGEV_NONE\n"
+                 << "    mov [rdi + " << AIOCB_OFFSET << "], r15 ;; aio_offset\n"
+                 << "    cmp r12, " << IORING_OP_READ << '\n'
+                 << "    jne async_submit_aio_write\n"
+                 << "    call aio_read\n"
+                 << "    jmp async_submit_aio_check\n"
+                 << "async_submit_aio_write:\n"
+                 << "    call aio_write\n"
+                 << "async_submit_aio_check:\n"
+                 << "    test eax, eax\n"
+                 << "    jne async_submit_failed\n"
+                 << "    jmp async_submit_done\n"
+                 << "async_wait:\n"
+                 << "    ;; rdi = request; returns the bytes it transferred, or zero if it failed\n"
+                 << "    push rbx\n"
+                 << "    push r12\n"
+                 << "    sub rsp, 8\n"
+                 << "    mov r12, rdi\n"
+                 << "    and r12, " << ASYNC_QUEUE_DEPTH - 1 << '\n'
+                 << "    lea rax, [rdi + 1]\n"
+                 << "    cmp [async_in_flight + r12 * 8], rax\n"
+                 << "    jne async_wait_unknown\n"
+                 << "async_wait_check:\n"
+                 << "    cmp byte [async_done + r12], 0\n"
+                 << "    jne async_wait_done\n"
+                 << "    cmp qword [async_uring], 0\n"
+                 << "    je async_wait_aio\n"
+                 << "    ;; Record the result of every completed request\n"
+                 << "    mov rsi, [async_cq_head]\n"
+                 << "    mov eax, [rsi]\n"
+                 << "async_wait_reap:\n"
+                 << "    mov rdx, [async_cq_tail]\n"
+                 << "    cmp eax, [rdx]\n"
+                 << "    je async_wait_reaped\n"
+                 << "    mov ecx, eax\n"
+                 << "    and rcx, [async_cq_mask]\n"
+                 << "    shl rcx, 4\n"
+                 << "    add rcx, [async_cqes]\n"
+                 << "    mov rdi, [rcx] ;; user_data\n"
+                 << "    and rdi, " << ASYNC_QUEUE_DEPTH - 1 << '\n'
+                 << "    movsxd r8, dword [rcx + 8] ;; res\n"
+                 << "    xor r9d, r9d\n"
+                 << "    test r8, r8\n"
+                 << "    cmovs r8, r9\n"
+                 << "    mov [async_results + rdi * 8], r8\n"
+                 << "    mov byte [async_done + rdi], 1\n"
+                 << "    inc eax\n"
+                 << "    jmp async_wait_reap\n"
+                 << "async_wait_reaped:\n"
+                 << "    mov [rsi], eax\n"
+                 << "    cmp byte [async_done + r12], 0\n"
+                 << "    jne async_wait_done\n"
+                 << "    mov eax, " << SYS_IO_URING_ENTER << '\n'
+                 << "    mov rdi, [async_ring_fd]\n"
+                 << "    xor esi, esi\n"
+                 << "    mov edx, 1 ;; min_complete\n"
+                 << "    mov r10d, 1 ;; IORING_ENTER_GETEVENTS\n"
+                 << "    xor r8d, r8d\n"
+                 << "    xor r9d, r9d\n"
+                 << "    syscall\n"
+                 << "    jmp async_wait_check\n"
+                 << "async_wait_aio:\n"
+                 << "    imul rbx, r12, " << AIOCB_SIZE << '\n'
+                 << "    lea rbx, [async_aiocbs + rbx]\n"
+                 << "    mov [async_aiocb_list], rbx\n"
+                 << "async_wait_aio_poll:\n"
+                 << "    mov rdi, rbx\n"
+                 << "    call aio_error\n"
+                 << "    cmp eax, 115 ;; EINPROGRESS\n"
+                 << "    jne async_wait_aio_finished\n"
+                 << "    mov rdi, async_aiocb_list\n"
+                 << "    mov esi, 1\n"
+                 << "    xor edx, edx\n"
+                 << "    call aio_suspend\n"
+                 << "    jmp async_wait_aio_poll\n"
+                 << "async_wait_aio_finished:\n"
+                 << "    mov rdi, rbx\n"
+                 << "    call aio_return\n"
+                 << "    xor ecx, ecx\n"
+                 << "    test rax, rax\n"
+                 << "    cmovs rax, rcx\n"
+                 << "    mov [async_results + r12 * 8], rax\n"
+                 << "    mov byte [async_done + r12], 1\n"
+                 << "async_wait_done:\n"
+                 << "    mov qword [async_in_flight + r12 * 8], 0\n"
+                 << "    mov rax, [async_results + r12 * 8]\n"
+                 << "async_wait_return:\n"
+                 << "    add rsp, 8\n"
+                 << "    pop r12\n"
+                 << "    pop rbx\n"
+                 << "    ret\n"
+                 << "async_wait_unknown:\n"
+                 << "    xor eax, eax\n"
+                 << "    jmp async_wait_return\n"
+                 << "async_setup:\n"
+                 << "    mov eax, " << SYS_IO_URING_SETUP << '\n'
+                 << "    mov edi, " << ASYNC_QUEUE_DEPTH << '\n'
+                 << "    mov rsi, async_params\n"
+                 << "    syscall\n"
+                 << "    test rax, rax\n"
+                 << "    js async_setup_done\n"
+                 << "    mov [async_ring_fd], rax\n"
+                 << "    ;; Submission queue ring\n"
+                 << "    mov esi, [async_params + " << IO_URING_SQ_ARRAY << "]\n"
+                 << "    mov ecx, [async_params + " << IO_URING_SQ_ENTRIES << "]\n"
+                 << "    lea rsi, [rsi + rcx * 4]\n"
+                 << "    xor r9d, r9d ;; IORING_OFF_SQ_RING\n"
+                 << "    call async_map_ring\n"
+                 << "    cmp rax, -4096\n"
+                 << "    ja async_setup_done\n"
+                 << "    mov ecx, [async_params + " << IO_URING_SQ_TAIL << "]\n"
+                 << "    add rcx, rax\n"
+                 << "    mov [async_sq_tail], rcx\n"
+                 << "    mov ecx, [async_params + " << IO_URING_SQ_RING_MASK << "]\n"
+                 << "    mov ecx, [rax + rcx]\n"
+                 << "    mov [async_sq_mask], rcx\n"
+                 << "    mov ecx, [async_params + " << IO_URING_SQ_ARRAY << "]\n"
+                 << "    add rcx, rax\n"
+                 << "    mov [async_sq_array], rcx\n"
+                 << "    ;; Completion queue ring\n"
+                 << "    mov esi, [async_params + " << IO_URING_CQ_CQES << "]\n"
+                 << "    mov ecx, [async_params + " << IO_URING_CQ_ENTRIES << "]\n"
+                 << "    shl rcx, 4\n"
+                 << "    add rsi, rcx\n"
+                 << "    mov r9d, 0x8000000 ;; IORING_OFF_CQ_RING\n"
+                 << "    call async_map_ring\n"
+                 << "    cmp rax, -4096\n"
+                 << "    ja async_setup_done\n"
+                 << "    mov ecx, [async_params + " << IO_URING_CQ_HEAD << "]\n"
+                 << "    add rcx, rax\n"
+                 << "    mov [async_cq_head], rcx\n"
+                 << "    mov ecx, [async_params + " << IO_URING_CQ_TAIL << "]\n"
+                 << "    add rcx, rax\n"
+                 << "    mov [async_cq_tail], rcx\n"
+                 << "    mov ecx, [async_params + " << IO_URING_CQ_RING_MASK << "]\n"
+                 << "    mov ecx, [rax + rcx]\n"
+                 << "    mov [async_cq_mask], rcx\n"
+                 << "    mov ecx, [async_params + " << IO_URING_CQ_CQES << "]\n"
+                 << "    add rcx, rax\n"
+                 << "    mov [async_cqes], rcx\n"
+                 << "    ;; Submission queue entries\n"
+                 << "    mov esi, [async_params + " << IO_URING_SQ_ENTRIES << "]\n"
+                 << "    shl rsi, 6\n"
+                 << "    mov r9d, 0x10000000 ;; IORING_OFF_SQES\n"
+                 << "    call async_map_ring\n"
+                 << "    cmp rax, -4096\n"
+                 << "    ja async_setup_done\n"
+                 << "    mov [async_sqes], rax\n"
+                 << "    mov qword [async_uring], 1\n"
+                 << "async_setup_done:\n";
+    }
+
+    void WriteAsyncData_NASM_linux64(std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    SECTION .bss\n"
+                 << "    alignb 8\n"
+                 << "    async_params resb " << IO_URING_PARAMS_SIZE << '\n'
+                 << "    async_ring_fd resq 1\n"
+                 << "    async_uring resq 1\n"
+                 << "    async_sq_tail resq 1\n"
+                 << "    async_sq_mask resq 1\n"
+                 << "    async_sq_array resq 1\n"
+                 << "    async_cq_head resq 1\n"
+                 << "    async_cq_tail resq 1\n"
+                 << "    async_cq_mask resq 1\n"
+                 << "    async_cqes resq 1\n"
+                 << "    async_sqes resq 1\n"
+                 << "    async_next_id resq 1\n"
+                 << "    async_aiocb_list resq 1\n"
+                 << "    async_results resq " << ASYNC_QUEUE_DEPTH << '\n'
+                 << "    async_in_flight resq " << ASYNC_QUEUE_DEPTH << '\n'
+                 << "    async_aiocbs resb " << ASYNC_QUEUE_DEPTH * AIOCB_SIZE << '\n'
+                 << "    async_done resb " << ASYNC_QUEUE_DEPTH << '\n';
+    }
+
+    void WriteAsyncSetup_GAS_linux64(std::ostream& asm_file) {
+        asm_file << "    # -- async I/O: set up an io_uring, or fall back to POSIX AIO --\n"
+                 << "    jmp async_setup\n"
+                 << "async_map_ring:\n"
+                 << "    # rsi = size, r9 = offset of the ring; returns its address, or an error above -4096\n"
+                 << "    xor %edi, %edi\n"
+                 << "    mov $3, %edx # PROT_READ | PROT_WRITE\n"
+                 << "    mov $0x8001, %r10d # MAP_SHARED | MAP_POPULATE\n"
+                 << "    mov async_ring_fd(%rip), %r8\n"
+                 << "    mov $9, %eax # mmap\n"
+                 << "    syscall\n"
+                 << "    ret\n"
+                 << "async_submit:\n"
+                 << "    # rdi = opcode, rsi = buffer, rdx = length, rcx = offset, r8 = FILE*; returns the request\n"
+                 << "    push %rbx\n"
+                 << "    push %r12\n"
+                 << "    push %r13\n"
+                 << "    push %r14\n"
+                 << "    push %r15\n"
+                 << "    sub $16, %rsp\n"
+                 << "    mov %rdi, %r12\n"
+                 << "    mov %rsi, %r13\n"
+                 << "    mov %rdx, %r14\n"
+                 << "    mov %rcx, %r15\n"
+                 << "    mov %r8, %rdi\n"
+                 << "    call fileno\n"
+                 << "    mov %eax, %ebx\n"
+                 << "    mov async_next_id(%rip), %r8\n"
+                 << "    incq async_next_id(%rip)\n"
+                 << "    mov %r8, %r9\n"
+                 << "    and $" << ASYNC_QUEUE_DEPTH - 1 << ", %r9\n"
+                 << "    mov %r8, (%rsp)\n"
+                 << "    mov %r9, 8(%rsp)\n"
+                 << "    lea 1(%r8), %rax\n"
+                 << "    lea async_in_flight(%rip), %rcx\n"
+                 << "    mov %rax, (%rcx,%r9,8)\n"
+                 << "    lea async_done(%rip), %rax\n"
+                 << "    movb $0, (%rax,%r9)\n"
+                 << "    cmpq $0, async_uring(%rip)\n"
+                 << "    je async_submit_aio\n"
+                 << "    mov async_sq_tail(%rip), %rdx\n"
+                 << "    mov (%rdx), %eax\n"
+                 << "    mov %eax, %ecx\n"
+                 << "    and async_sq_mask(%rip), %rcx\n"
+                 << "    mov %rcx, %rdi\n"
+                 << "    shl $6, %rdi\n"
+                 << "    add async_sqes(%rip), %rdi\n"
+                 << "    xor %r10d, %r10d\n";
+        for (int offset = 0; offset < 64; offset += 8) {
+            asm_file << "    mov %r10, " << offset << "(%rdi)\n";
+        }
+        asm_file << "    mov %r12b, (%rdi) # opcode\n"
+                 << "    mov %ebx, 4(%rdi) # fd\n"
+                 << "    mov %r15, 8(%rdi) # offset\n"
+                 << "    mov %r13, 16(%rdi) # buffer\n"
+                 << "    mov %r14d, 24(%rdi) # length\n"
+                 << "    mov %r8, 32(%rdi) # user_data: the request\n"
+                 << "    mov async_sq_array(%rip), %r10\n"
+                 << "    mov %ecx, (%r10,%rcx,4)\n"
+                 << "    inc %eax\n"
+                 << "    mov %eax, (%rdx) # publish the entry; x86 doesn't reorder stores\n"
+                 << "    mov $" << SYS_IO_URING_ENTER << ", %eax\n"
+                 << "    mov async_ring_fd(%rip), %rdi\n"
+                 << "    mov $1, %esi\n"
+                 << "    xor %edx, %edx\n"
+                 << "    xor %r10d, %r10d\n"
+                 << "    xor %r8d, %r8d\n"
+                 << "    xor %r9d, %r9d\n"
+                 << "    syscall\n"
+                 << "    cmp $1, %rax\n"
+                 << "    jne async_submit_failed\n"
+                 << "async_submit_done:\n"
+                 << "    mov (%rsp), %rax\n"
+                 << "    add $16, %rsp\n"
+                 << "    pop %r15\n"
+                 << "    pop %r14\n"
+                 << "    pop %r13\n"
+                 << "    pop %r12\n"
+                 << "    pop %rbx\n"
+                 << "    ret\n"
+                 << "async_submit_failed:\n"
+                 << "    mov 8(%rsp), %r9\n"
+                 << "    lea async_results(%rip), %rax\n"
+                 << "    movq $0, (%rax,%r9,8)\n"
+                 << "    lea async_done(%rip), %rax\n"
+                 << "    movb $1, (%rax,%r9)\n"
+                 << "    jmp async_submit_done\n"
+                 << "async_submit_aio:\n"
+                 << "    imul $" << AIOCB_SIZE << ", %r9, %rdi\n"
+                 << "    lea async_aiocbs(%rip), %rax\n"
+                 << "    add %rax, %rdi\n"
+                 << "    mov %rdi, %rdx\n"
+                 << "    xor %eax, %eax\n"
+                 << "    mov $" << AIOCB_SIZE / 8 << ", %ecx\n"
+                 << "    rep stosq\n"
+                 << "    mov %rdx, %rdi\n"
+                 << "    mov %ebx, (%rdi) # aio_fildes\n"
+                 << "    mov %r13, 16(%rdi) # aio_buf\n"
+                 << "    mov %r14, 24(%rdi) # aio_nbytes\n"
+                 << "    movl $1, " << AIOCB_SIGEV_NOTIFY << "(%rdi) # SIGEV_NONE\n"
+                 << "    mov %r15, " << AIOCB_OFFSET << "(%rdi) # aio_offset\n"
+                 << "    cmp $" << IORING_OP_READ << ", %r12\n"
+                 << "    jne async_submit_aio_write\n"
+                 << "    call aio_read\n"
+                 << "    jmp async_submit_aio_check\n"
+                 << "async_submit_aio_write:\n"
+                 << "    call aio_write\n"
+                 << "async_submit_aio_check:\n"
+                 << "    test %eax, %eax\n"
+                 << "    jne async_submit_failed\n"
+                 << "    jmp async_submit_done\n"
+                 << "async_wait:\n"
+                 << "    # rdi = request; returns the bytes it transferred, or zero if it failed\n"
+                 << "    push %rbx\n"
+                 << "    push %r12\n"
+                 << "    sub $8, %rsp\n"
+                 << "    mov %rdi, %r12\n"
+                 << "    and $" << ASYNC_QUEUE_DEPTH - 1 << ", %r12\n"
+                 << "    lea 1(%rdi), %rax\n"
+                 << "    lea async_in_flight(%rip), %rcx\n"
+                 << "    cmp %rax, (%rcx,%r12,8)\n"
+                 << "    jne async_wait_unknown\n"
+                 << "async_wait_check:\n"
+                 << "    lea async_done(%rip), %rax\n"
+                 << "    cmpb $0, (%rax,%r12)\n"
+                 << "    jne async_wait_done\n"
+                 << "    cmpq $0, async_uring(%rip)\n"
+                 << "    je async_wait_aio\n"
+                 << "    # Record the result of every completed request\n"
+                 << "    mov async_cq_head(%rip), %rsi\n"
+                 << "    mov (%rsi), %eax\n"
+                 << "async_wait_reap:\n"
+                 << "    mov async_cq_tail(%rip), %rdx\n"
+                 << "    cmp (%rdx), %eax\n"
+                 << "    je async_wait_reaped\n"
+                 << "    mov %eax, %ecx\n"
+                 << "    and async_cq_mask(%rip), %rcx\n"
+                 << "    shl $4, %rcx\n"
+                 << "    add async_cqes(%rip), %rcx\n"
+                 << "    mov (%rcx), %rdi # user_data\n"
+                 << "    and $" << ASYNC_QUEUE_DEPTH - 1 << ", %rdi\n"
+                 << "    movslq 8(%rcx), %r8 # res\n"
+                 << "    xor %r9d, %r9d\n"
+                 << "    test %r8, %r8\n"
+                 << "    cmovs %r9, %r8\n"
+                 << "    lea async_results(%rip), %r9\n"
+                 << "    mov %r8, (%r9,%rdi,8)\n"
+                 << "    lea async_done(%rip), %r9\n"
+                 << "    movb $1, (%r9,%rdi)\n"
+                 << "    inc %eax\n"
+                 << "    jmp async_wait_reap\n"
+                 << "async_wait_reaped:\n"
+                 << "    mov %eax, (%rsi)\n"
+                 << "    lea async_done(%rip), %rax\n"
+                 << "    cmpb $0, (%rax,%r12)\n"
+                 << "    jne async_wait_done\n"
+                 << "    mov $" << SYS_IO_URING_ENTER << ", %eax\n"
+                 << "    mov async_ring_fd(%rip), %rdi\n"
+                 << "    xor %esi, %esi\n"
+                 << "    mov $1, %edx # min_complete\n"
+                 << "    mov $1, %r10d # IORING_ENTER_GETEVENTS\n"
+                 << "    xor %r8d, %r8d\n"
+                 << "    xor %r9d, %r9d\n"
+                 << "    syscall\n"
+                 << "    jmp async_wait_check\n"
+                 << "async_wait_aio:\n"
+                 << "    imul $" << AIOCB_SIZE << ", %r12, %rbx\n"
+                 << "    lea async_aiocbs(%rip), %rax\n"
+                 << "    add %rax, %rbx\n"
+                 << "    mov %rbx, async_aiocb_list(%rip)\n"
+                 << "async_wait_aio_poll:\n"
+                 << "    mov %rbx, %rdi\n"
+                 << "    call aio_error\n"
+                 << "    cmp $115, %eax # EINPROGRESS\n"
+                 << "    jne async_wait_aio_finished\n"
+                 << "    lea async_aiocb_list(%rip), %rdi\n"
+                 << "    mov $1, %esi\n"
+                 << "    xor %edx, %edx\n"
+                 << "    call aio_suspend\n"
+                 << "    jmp async_wait_aio_poll\n"
+                 << "async_wait_aio_finished:\n"
+                 << "    mov %rbx, %rdi\n"
+                 << "    call aio_return\n"
+                 << "    xor %ecx, %ecx\n"
+                 << "    test %rax, %rax\n"
+                 << "    cmovs %rcx, %rax\n"
+                 << "    lea async_results(%rip), %rcx\n"
+                 << "    mov %rax, (%rcx,%r12,8)\n"
+                 << "    lea async_done(%rip), %rcx\n"
+                 << "    movb $1, (%rcx,%r12)\n"
+                 << "async_wait_done:\n"
+                 << "    lea async_in_flight(%rip), %rax\n"
+                 << "    movq $0, (%rax,%r12,8)\n"
+                 << "    lea async_results(%rip), %rax\n"
+                 << "    mov (%rax,%r12,8), %rax\n"
+                 << "async_wait_return:\n"
+                 << "    add $8, %rsp\n"
+                 << "    pop %r12\n"
+                 << "    pop %rbx\n"
+                 << "    ret\n"
+                 << "async_wait_unknown:\n"
+                 << "    xor %eax, %eax\n"
+                 << "    jmp async_wait_return\n"
+                 << "async_setup:\n"
+                 << "    mov $" << SYS_IO_URING_SETUP << ", %eax\n"
+                 << "    mov $" << ASYNC_QUEUE_DEPTH << ", %edi\n"
+                 << "    lea async_params(%rip), %rsi\n"
+                 << "    syscall\n"
+                 << "    test %rax, %rax\n"
+                 << "    js async_setup_done\n"
+                 << "    mov %rax, async_ring_fd(%rip)\n"
+                 << "    # Submission queue ring\n"
+                 << "    mov async_params+" << IO_URING_SQ_ARRAY << "(%rip), %esi\n"
+                 << "    mov async_params+" << IO_URING_SQ_ENTRIES << "(%rip), %ecx\n"
+                 << "    lea (%rsi,%rcx,4), %rsi\n"
+                 << "    xor %r9d, %r9d # IORING_OFF_SQ_RING\n"
+                 << "    call async_map_ring\n"
+                 << "    cmp $-4096, %rax\n"
+                 << "    ja async_setup_done\n"
+                 << "    mov async_params+" << IO_URING_SQ_TAIL << "(%rip), %ecx\n"
+                 << "    add %rax, %rcx\n"
+                 << "    mov %rcx, async_sq_tail(%rip)\n"
+                 << "    mov async_params+" << IO_URING_SQ_RING_MASK << "(%rip), %ecx\n"
+                 << "    mov (%rax,%rcx), %ecx\n"
+                 << "    mov %rcx, async_sq_mask(%rip)\n"
+                 << "    mov async_params+" << IO_URING_SQ_ARRAY << "(%rip), %ecx\n"
+                 << "    add %rax, %rcx\n"
+                 << "    mov %rcx, async_sq_array(%rip)\n"
+                 << "    # Completion queue ring\n"
+                 << "    mov async_params+" << IO_URING_CQ_CQES << "(%rip), %esi\n"
+                 << "    mov async_params+" << IO_URING_CQ_ENTRIES << "(%rip), %ecx\n"
+                 << "    shl $4, %rcx\n"
+                 << "    add %rcx, %rsi\n"
+                 << "    mov $0x8000000, %r9d # IORING_OFF_CQ_RING\n"
+                 << "    call async_map_ring\n"
+                 << "    cmp $-4096, %rax\n"
+                 << "    ja async_setup_done\n"
+                 << "    mov async_params+" << IO_URING_CQ_HEAD << "(%rip), %ecx\n"
+                 << "    add %rax, %rcx\n"
+                 << "    mov %rcx, async_cq_head(%rip)\n"
+                 << "    mov async_params+" << IO_URING_CQ_TAIL << "(%rip), %ecx\n"
+                 << "    add %rax, %rcx\n"
+                 << "    mov %rcx, async_cq_tail(%rip)\n"
+                 << "    mov async_params+" << IO_URING_CQ_RING_MASK << "(%rip), %ecx\n"
+                 << "    mov (%rax,%rcx), %ecx\n"
+                 << "    mov %rcx, async_cq_mask(%rip)\n"
+                 << "    mov async_params+" << IO_URING_CQ_CQES << "(%rip), %ecx\n"
+                 << "    add %rax, %rcx\n"
+                 << "    mov %rcx, async_cqes(%rip)\n"
+                 << "    # Submission queue entries\n"
+                 << "    mov async_params+" << IO_URING_SQ_ENTRIES << "(%rip), %esi\n"
+                 << "    shl $6, %rsi\n"
+                 << "    mov $0x10000000, %r9d # IORING_OFF_SQES\n"
+                 << "    call async_map_ring\n"
+                 << "    cmp $-4096, %rax\n"
+                 << "    ja async_setup_done\n"
+                 << "    mov %rax, async_sqes(%rip)\n"
+                 << "    movq $1, async_uring(%rip)\n"
+                 << "async_setup_done:\n";
+    }
+
+    void WriteAsyncData_GAS_linux64(std::ostream& asm_file) {
+        asm_file << '\n'
+                 << "    .bss\n"
+                 << "    .comm async_params, " << IO_URING_PARAMS_SIZE << ", 8\n"
+                 << "    .comm async_ring_fd, 8, 8\n"
+                 << "    .comm async_uring, 8, 8\n"
+                 << "    .comm async_sq_tail, 8, 8\n"
+                 << "    .comm async_sq_mask, 8, 8\n"
+                 << "    .comm async_sq_array, 8, 8\n"
+                 << "    .comm async_cq_head, 8, 8\n"
+                 << "    .comm async_cq_tail, 8, 8\n"
+                 << "    .comm async_cq_mask, 8, 8\n"
+                 << "    .comm async_cqes, 8, 8\n"
+                 << "    .comm async_sqes, 8, 8\n"
+                 << "    .comm async_next_id, 8, 8\n"
+                 << "    .comm async_aiocb_list, 8, 8\n"
+                 << "    .comm async_results, " << 8 * ASYNC_QUEUE_DEPTH << ", 8\n"
+                 << "    .comm async_in_flight, " << 8 * ASYNC_QUEUE_DEPTH << ", 8\n"
+                 << "    .comm async_aiocbs, " << ASYNC_QUEUE_DEPTH * AIOCB_SIZE << ", 8\n"
+                 << "    .comm async_done, " << ASYNC_QUEUE_DEPTH << ", 8\n";
+    }
+
+    // BULK MEMORY
+    // `mem_fill`, `mem_copy` and `mem_compare` call routines that are written once, after the exit of the program.
+    // They don't call into the C runtime, so the same routines serve every platform. Arguments are passed in
+    //   rdi, rsi and rdx, the result is returned in rax, and rcx, r8, xmm0 through xmm3 and the arguments are clobbered.
+    // Fills and copies go through `rep stosb` and `rep movsb`, which the CPU turns into wide stores on its own.
+    // Regions of at least NON_TEMPORAL_THRESHOLD bytes are filled (or copied to) with non-temporal stores
+    //   instead, which bypass the cache; a region that large would only evict everything else from it.
+    // `mem_compare` compares 16 bytes at a time with SSE2, which every x86_64 CPU has.
+    const uint64_t NON_TEMPORAL_THRESHOLD = 4 * 1024 * 1024;
+
+    bool UsesBulkMemory(const Program& prog) {
+        return std::any_of(prog.tokens.begin(), prog.tokens.end(), [](const Token& tok) {
+            return tok.type == TokenType::KEYWORD
+                && (tok.text == GetKeywordStr(Keyword::MEM_FILL)
+                    || tok.text == GetKeywordStr(Keyword::MEM_COPY)
+                    || tok.text == GetKeywordStr(Keyword::MEM_COMPARE));
+        });
+    }
+
+    void WriteBulkMemory_NASM(std::ostream& asm_file) {
+        asm_file << "\n"
+                 << "    ;; -- bulk memory routines --\n"
+                 << "    ;; mem_fill: rdi = destination, rsi = byte, rdx = length\n"
+                 << "mem_fill:\n"
+                 << "    movzx eax, sil\n"
+                 << "    mov rcx, rdx\n"
+                 << "    cmp rdx, " << NON_TEMPORAL_THRESHOLD << '\n'
+                 << "    jae mem_fill_stream\n"
+                 << "    rep stosb\n"
+                 << "    ret\n"
+                 << "mem_fill_stream:\n"
+                 << "    imul eax, eax, 0x01010101\n"
+                 << "    movd xmm0, eax\n"
+                 << "    pshufd xmm0, xmm0, 0\n"
+                 << "    ;; Up to a 16 byte boundary, then 64 bytes at a time, then the rest.\n"
+                 << "    mov rcx, rdi\n"
+                 << "    neg rcx\n"
+                 << "    and rcx, 15\n"
+                 << "    sub rdx, rcx\n"
+                 << "    rep stosb\n"
+                 << "    mov rcx, rdx\n"
+                 << "    shr rcx, 6\n"
+                 << "mem_fill_stream_loop:\n"
+                 << "    movntdq [rdi], xmm0\n"
+                 << "    movntdq [rdi + 16], xmm0\n"
+                 << "    movntdq [rdi + 32], xmm0\n"
+                 << "    movntdq [rdi + 48], xmm0\n"
+                 << "    add rdi, 64\n"
+                 << "    dec rcx\n"
+                 << "    jnz mem_fill_stream_loop\n"
+                 << "    sfence\n"
+                 << "    mov rcx, rdx\n"
+                 << "    and rcx, 63\n"
+                 << "    rep stosb\n"
+                 << "    ret\n"
+                 << "    ;; mem_copy: rdi = destination, rsi = source, rdx = length\n"
+                 << "mem_copy:\n"
+                 << "    mov rcx, rdx\n"
+                 << "    mov rax, rdi\n"
+                 << "    sub rax, rsi\n"
+                 << "    cmp rax, rdx\n"
+                 << "    jb mem_copy_backward\n"
+                 << "    cmp rdx, " << NON_TEMPORAL_THRESHOLD << '\n'
+                 << "    jae mem_copy_stream\n"
+                 << "    rep movsb\n"
+                 << "    ret\n"
+                 << "mem_copy_backward:\n"
+                 << "    ;; The destination starts inside the source; copy from the end so nothing is overwritten before it is read.\n"
+                 << "    lea rsi, [rsi + rdx - 1]\n"
+                 << "    lea rdi, [rdi + rdx - 1]\n"
+                 << "    std\n"
+                 << "    rep movsb\n"
+                 << "    cld\n"
+                 << "    ret\n"
+                 << "mem_copy_stream:\n"
+                 << "    mov rcx, rdi\n"
+                 << "    neg rcx\n"
+                 << "    and rcx, 15\n"
+                 << "    sub rdx, rcx\n"
+                 << "    rep movsb\n"
+                 << "    mov rcx, rdx\n"
+                 << "    shr rcx, 6\n"
+                 << "mem_copy_stream_loop:\n"
+                 << "    movdqu xmm0, [rsi]\n"
+                 << "    movdqu xmm1, [rsi + 16]\n"
+                 << "    movdqu xmm2, [rsi + 32]\n"
+                 << "    movdqu xmm3, [rsi + 48]\n"
+                 << "    movntdq [rdi], xmm0\n"
+                 << "    movntdq [rdi + 16], xmm1\n"
+                 << "    movntdq [rdi + 32], xmm2\n"
+                 << "    movntdq [rdi + 48], xmm3\n"
+                 << "    add rsi, 64\n"
+                 << "    add rdi, 64\n"
+                 << "    dec rcx\n"
+                 << "    jnz mem_copy_stream_loop\n"
+                 << "    sfence\n"
+                 << "    mov rcx, rdx\n"
+                 << "    and rcx, 63\n"
+                 << "    rep movsb\n"
+                 << "    ret\n"
+                 << "    ;; mem_compare: rdi = a, rsi = b, rdx = length -> rax = offset of the first difference, or length\n"
+                 << "mem_compare:\n"
+                 << "    xor eax, eax\n"
+                 << "    cmp rdx, 16\n"
+                 << "    jb mem_compare_bytes\n"
+                 << "mem_compare_loop:\n"
+                 << "    movdqu xmm0, [rdi + rax]\n"
+                 << "    movdqu xmm1, [rsi + rax]\n"
+                 << "    pcmpeqb xmm0, xmm1\n"
+                 << "    pmovmskb ecx, xmm0\n"
+                 << "    xor ecx, 0xffff\n"
+                 << "    jnz mem_compare_found\n"
+                 << "    add rax, 16\n"
+                 << "    lea r8, [rax + 16]\n"
+                 << "    cmp r8, rdx\n"
+                 << "    jbe mem_compare_loop\n"
+                 << "    cmp rax, rdx\n"
+                 << "    je mem_compare_done\n"
+                 << "    ;; The last 16 bytes overlap bytes already known to be equal.\n"
+                 << "    lea rax, [rdx - 16]\n"
+                 << "    movdqu xmm0, [rdi + rax]\n"
+                 << "    movdqu xmm1, [rsi + rax]\n"
+                 << "    pcmpeqb xmm0, xmm1\n"
+                 << "    pmovmskb ecx, xmm0\n"
+                 << "    xor ecx, 0xffff\n"
+                 << "    jnz mem_compare_found\n"
+                 << "    mov rax, rdx\n"
+                 << "    ret\n"
+                 << "mem_compare_bytes:\n"
+                 << "    cmp rax, rdx\n"
+                 << "    je mem_compare_done\n"
+                 << "    movzx ecx, byte [rdi + rax]\n"
+                 << "    cmp cl, [rsi + rax]\n"
+                 << "    jne mem_compare_done\n"
+                 << "    inc rax\n"
+                 << "    jmp mem_compare_bytes\n"
+                 << "mem_compare_found:\n"
+                 << "    bsf ecx, ecx\n"
+                 << "    add rax, rcx\n"
+                 << "mem_compare_done:\n"
+                 << "    ret\n";
+    }
+
+    void WriteBulkMemory_GAS(std::ostream& asm_file) {
+        asm_file << "\n"
+                 << "    # -- bulk memory routines --\n"
+                 << "    # mem_fill: rdi = destination, rsi = byte, rdx = length\n"
+                 << "mem_fill:\n"
+                 << "    movzbl %sil, %eax\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    cmp $" << NON_TEMPORAL_THRESHOLD << ", %rdx\n"
+                 << "    jae mem_fill_stream\n"
+                 << "    rep stosb\n"
+                 << "    ret\n"
+                 << "mem_fill_stream:\n"
+                 << "    imul $0x01010101, %eax, %eax\n"
+                 << "    movd %eax, %xmm0\n"
+                 << "    pshufd $0, %xmm0, %xmm0\n"
+                 << "    # Up to a 16 byte boundary, then 64 bytes at a time, then the rest.\n"
+                 << "    mov %rdi, %rcx\n"
+                 << "    neg %rcx\n"
+                 << "    and $15, %rcx\n"
+                 << "    sub %rcx, %rdx\n"
+                 << "    rep stosb\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    shr $6, %rcx\n"
+                 << "mem_fill_stream_loop:\n"
+                 << "    movntdq %xmm0, (%rdi)\n"
+                 << "    movntdq %xmm0, 16(%rdi)\n"
+                 << "    movntdq %xmm0, 32(%rdi)\n"
+                 << "    movntdq %xmm0, 48(%rdi)\n"
+                 << "    add $64, %rdi\n"
+                 << "    dec %rcx\n"
+                 << "    jnz mem_fill_stream_loop\n"
+                 << "    sfence\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    and $63, %rcx\n"
+                 << "    rep stosb\n"
+                 << "    ret\n"
+                 << "    # mem_copy: rdi = destination, rsi = source, rdx = length\n"
+                 << "mem_copy:\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    mov %rdi, %rax\n"
+                 << "    sub %rsi, %rax\n"
+                 << "    cmp %rdx, %rax\n"
+                 << "    jb mem_copy_backward\n"
+                 << "    cmp $" << NON_TEMPORAL_THRESHOLD << ", %rdx\n"
+                 << "    jae mem_copy_stream\n"
+                 << "    rep movsb\n"
+                 << "    ret\n"
+                 << "mem_copy_backward:\n"
+                 << "    # The destination starts inside the source; copy from the end so nothing is overwritten before it is read.\n"
+                 << "    lea -1(%rsi,%rdx), %rsi\n"
+                 << "    lea -1(%rdi,%rdx), %rdi\n"
+                 << "    std\n"
+                 << "    rep movsb\n"
+                 << "    cld\n"
+                 << "    ret\n"
+                 << "mem_copy_stream:\n"
+                 << "    mov %rdi, %rcx\n"
+                 << "    neg %rcx\n"
+                 << "    and $15, %rcx\n"
+                 << "    sub %rcx, %rdx\n"
+                 << "    rep movsb\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    shr $6, %rcx\n"
+                 << "mem_copy_stream_loop:\n"
+                 << "    movdqu (%rsi), %xmm0\n"
+                 << "    movdqu 16(%rsi), %xmm1\n"
+                 << "    movdqu 32(%rsi), %xmm2\n"
+                 << "    movdqu 48(%rsi), %xmm3\n"
+                 << "    movntdq %xmm0, (%rdi)\n"
+                 << "    movntdq %xmm1, 16(%rdi)\n"
+                 << "    movntdq %xmm2, 32(%rdi)\n"
+                 << "    movntdq %xmm3, 48(%rdi)\n"
+                 << "    add $64, %rsi\n"
+                 << "    add $64, %rdi\n"
+                 << "    dec %rcx\n"
+                 << "    jnz mem_copy_stream_loop\n"
+                 << "    sfence\n"
+                 << "    mov %rdx, %rcx\n"
+                 << "    and $63, %rcx\n"
+                 << "    rep movsb\n"
+                 << "    ret\n"
+                 << "    # mem_compare: rdi = a, rsi = b, rdx = length -> rax = offset of the first difference, or length\n"
+                 << "mem_compare:\n"
+                 << "    xor %eax, %eax\n"
+                 << "    cmp $16, %rdx\n"
+                 << "    jb mem_compare_bytes\n"
+                 << "mem_compare_loop:\n"
+                 << "    movdqu (%rdi,%rax), %xmm0\n"
+                 << "    movdqu (%rsi,%rax), %xmm1\n"
+                 << "    pcmpeqb %xmm1, %xmm0\n"
+                 << "    pmovmskb %xmm0, %ecx\n"
+                 << "    xor $0xffff, %ecx\n"
+                 << "    jnz mem_compare_found\n"
+                 << "    add $16, %rax\n"
+                 << "    lea 16(%rax), %r8\n"
+                 << "    cmp %rdx, %r8\n"
+                 << "    jbe mem_compare_loop\n"
+                 << "    cmp %rdx, %rax\n"
+                 << "    je mem_compare_done\n"
+                 << "    # The last 16 bytes overlap bytes already known to be equal.\n"
+                 << "    lea -16(%rdx), %rax\n"
+                 << "    movdqu (%rdi,%rax), %xmm0\n"
+                 << "    movdqu (%rsi,%rax), %xmm1\n"
+                 << "    pcmpeqb %xmm1, %xmm0\n"
+                 << "    pmovmskb %xmm0, %ecx\n"
+                 << "    xor $0xffff, %ecx\n"
+                 << "    jnz mem_compare_found\n"
+                 << "    mov %rdx, %rax\n"
+                 << "    ret\n"
+                 << "mem_compare_bytes:\n"
+                 << "    cmp %rdx, %rax\n"
+                 << "    je mem_compare_done\n"
+                 << "    movzbl (%rdi,%rax), %ecx\n"
+                 << "    cmp (%rsi,%rax), %cl\n"
+                 << "    jne mem_compare_done\n"
+                 << "    inc %rax\n"
+                 << "    jmp mem_compare_bytes\n"
+                 << "mem_compare_found:\n"
+                 << "    bsf %ecx, %ecx\n"
+                 << "    add %rcx, %rax\n"
+                 << "mem_compare_done:\n"
+                 << "    ret\n";
+    }
+
+    // BYTE SEARCH
+    // `mem_find_byte` and `mem_find_any` call routines that are written once, after the exit of the program,
+    //   with the same conventions as the bulk memory routines (xmm4 through xmm7 are clobbered as well).
+    // They compare 16 bytes at a time with SSE2, or 32 at a time with AVX2 when both the CPU and the OS
+    //   support it; `cpu_detect` finds out with `cpuid` the first time either is called, unless the
+    //   `-march` target is known to have AVX2.
+    // A search never reads outside of the range it was given: the last block overlaps the one before it instead.
+    // `mem_find_any` keeps up to four bytes of the set in vector registers; larger sets (and ranges shorter than
+    //   a block) are looked up one byte at a time in a 256-bit table of the set, built on the stack.
+    bool UsesByteSearch(const Program& prog) {
+        return std::any_of(prog.tokens.begin(), prog.tokens.end(), [](const Token& tok) {
+            return tok.type == TokenType::KEYWORD
+                && (tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)
+                    || tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY));
+        });
+    }
+
+    // Search `rsi` bytes at `rdi` one block of `width` bytes at a time; `compare` leaves a mask of the matches
+    //   in the block at `rdi + rax` in ecx.
+    void WriteSearchLoop_NASM(const std::string& name, size_t width, const std::string& compare, std::ostream& asm_file) {
+        std::string leave = width == 32 ? "    vzeroupper\n" : "";
+        asm_file << name << ":\n"
+                 << compare
+                 << "    test ecx, ecx\n"
+                 << "    jnz " << name << "_found\n"
+                 << "    add rax, " << width << '\n'
+                 << "    lea r8, [rax + " << width << "]\n"
+                 << "    cmp r8, rsi\n"
+                 << "    jbe " << name << '\n'
+                 << "    cmp rax, rsi\n"
+                 << "    je " << name << "_none\n"
+                 << "    ;; The last block overlaps bytes already known not to match.\n"
+                 << "    lea rax, [rsi - " << width << "]\n"
+                 << compare
+                 << "    test ecx, ecx\n"
+                 << "    jnz " << name << "_found\n"
+                 << name << "_none:\n"
+                 << leave
+                 << "    mov rax, rsi\n"
+                 << "    ret\n"
+                 << name << "_found:\n"
+                 << leave
+                 << "    bsf ecx, ecx\n"
+                 << "    add rax, rcx\n"
+                 << "    ret\n";
+    }
+
+    void WriteSearchLoop_GAS(const std::string& name, size_t width, const std::string& compare, std::ostream& asm_file) {
+        std::string leave = width == 32 ? "    vzeroupper\n" : "";
+        asm_file << name << ":\n"
+                 << compare
+                 << "    test %ecx, %ecx\n"
+                 << "    jnz " << name << "_found\n"
+                 << "    add $" << width << ", %rax\n"
+                 << "    lea " << width << "(%rax), %r8\n"
+                 << "    cmp %rsi, %r8\n"
+                 << "    jbe " << name << '\n'
+                 << "    cmp %rsi, %rax\n"
+                 << "    je " << name << "_none\n"
+                 << "    # The last block overlaps bytes already known not to match.\n"
+                 << "    lea -" << width << "(%rsi), %rax\n"
+                 << compare
+                 << "    test %ecx, %ecx\n"
+                 << "    jnz " << name << "_found\n"
+                 << name << "_none:\n"
+                 << leave
+                 << "    mov %rsi, %rax\n"
+                 << "    ret\n"
+                 << name << "_found:\n"
+                 << leave
+                 << "    bsf %ecx, %ecx\n"
+                 << "    add %rcx, %rax\n"
+                 << "    ret\n";
+    }
+
+    // With `avx2`, the target is known to support AVX2 and the routines never run `cpu_detect`.
+    void WriteByteSearch_NASM(bool avx2, std::ostream& asm_file) {
+        // Broadcast the byte in ecx to every byte of `xmm`.
+        auto broadcast = [](const std::string& xmm) {
+            return "    imul ecx, ecx, 0x01010101\n"
+                   "    movd " + xmm + ", ecx\n"
+                   "    pshufd " + xmm + ", " + xmm + ", 0\n";
+        };
+        asm_file << "\n"
+                 << "    ;; -- byte search routines --\n"
+                 << "    ;; cpu_detect: cpu_features = 2 if both the CPU and the OS support AVX2, else 1 (SSE2)\n"
+                 << "cpu_detect:\n"
+                 << "    push rbx\n"
+                 << "    push rdx\n"
+                 << "    mov r8d, 1\n"
+                 << "    xor eax, eax\n"
+                 << "    cpuid\n"
+                 << "    cmp eax, 7\n"
+                 << "    jb cpu_detect_done\n"
+                 << "    mov eax, 1\n"
+                 << "    cpuid\n"
+                 << "    ;; OSXSAVE and AVX\n"
+                 << "    and ecx, 0x18000000\n"
+                 << "    cmp ecx, 0x18000000\n"
+                 << "    jne cpu_detect_done\n"
+                 << "    ;; The OS saves the XMM and YMM registers.\n"
+                 << "    xor ecx, ecx\n"
+                 << "    xgetbv\n"
+                 << "    and eax, 6\n"
+                 << "    cmp eax, 6\n"
+                 << "    jne cpu_detect_done\n"
+                 << "    mov eax, 7\n"
+                 << "    xor ecx, ecx\n"
+                 << "    cpuid\n"
+                 << "    test ebx, 0x20\n"
+                 << "    jz cpu_detect_done\n"
+                 << "    mov r8d, 2\n"
+                 << "cpu_detect_done:\n"
+                 << "    mov [rel cpu_features], r8b\n"
+                 << "    pop rdx\n"
+                 << "    pop rbx\n"
+                 << "    ret\n"
+                 << "    ;; mem_find_byte: rdi = address, rsi = length, rdx = byte -> rax = offset of the first match, or length\n"
+                 << "mem_find_byte:\n"
+                 << "    cmp byte [rel cpu_features], 0\n"
+                 << "    jne mem_find_byte_ready\n"
+                 << "    call cpu_detect\n"
+                 << "mem_find_byte_ready:\n"
+                 << "    movzx ecx, dl\n"
+                 << broadcast("xmm0")
+                 << "    xor eax, eax\n"
+                 << "    cmp rsi, 16\n"
+                 << "    jb mem_find_byte_bytes\n"
+                 << "    cmp rsi, 32\n"
+                 << "    jb mem_find_byte_sse2\n"
+                 << "    cmp byte [rel cpu_features], 2\n"
+                 << "    jne mem_find_byte_sse2\n"
+                 << "    vpbroadcastb ymm0, xmm0\n";
+        WriteSearchLoop_NASM("mem_find_byte_avx2", 32,
+                             "    vpcmpeqb ymm1, ymm0, [rdi + rax]\n"
+                             "    vpmovmskb ecx, ymm1\n", asm_file);
+        WriteSearchLoop_NASM("mem_find_byte_sse2", 16,
+                             "    movdqu xmm1, [rdi + rax]\n"
+                             "    pcmpeqb xmm1, xmm0\n"
+                             "    pmovmskb ecx, xmm1\n", asm_file);
+        asm_file << "mem_find_byte_bytes:\n"
+                 << "    cmp rax, rsi\n"
+                 << "    je mem_find_byte_done\n"
+                 << "    cmp [rdi + rax], dl\n"
+                 << "    je mem_find_byte_done\n"
+                 << "    inc rax\n"
+                 << "    jmp mem_find_byte_bytes\n"
+                 << "mem_find_byte_done:\n"
+                 << "    ret\n"
+                 << "    ;; mem_find_any: rdi = address, rsi = length, rdx = null-terminated set of bytes -> rax = offset of the first match, or length\n"
+                 << "mem_find_any:\n"
+                 << "    cmp byte [rel cpu_features], 0\n"
+                 << "    jne mem_find_any_ready\n"
+                 << "    call cpu_detect\n"
+                 << "mem_find_any_ready:\n"
+                 << "    cmp rsi, 16\n"
+                 << "    jb mem_find_any_table\n"
+                 << "    cmp byte [rdx], 0\n"
+                 << "    je mem_find_any_table\n"
+                 << "    ;; Up to four bytes of the set go into xmm4 through xmm7; missing ones repeat the first.\n"
+                 << "    movzx ecx, byte [rdx]\n"
+                 << broadcast("xmm4")
+                 << "    movdqa xmm5, xmm4\n"
+                 << "    movdqa xmm6, xmm4\n"
+                 << "    movdqa xmm7, xmm4\n";
+        for (int i = 1; i < 4; i++) {
+            asm_file << "    movzx ecx, byte [rdx + " << i << "]\n"
+                     << "    test ecx, ecx\n"
+                     << "    jz mem_find_any_vector\n"
+                     << broadcast("xmm" + std::to_string(4 + i));
+        }
+        asm_file << "    cmp byte [rdx + 4], 0\n"
+                 << "    jne mem_find_any_table\n"
+                 << "mem_find_any_vector:\n"
+                 << "    xor eax, eax\n"
+                 << "    cmp rsi, 32\n"
+                 << "    jb mem_find_any_sse2\n"
+                 << "    cmp byte [rel cpu_features], 2\n"
+                 << "    jne mem_find_any_sse2\n"
+                 << "    vpbroadcastb ymm4, xmm4\n"
+                 << "    vpbroadcastb ymm5, xmm5\n"
+                 << "    vpbroadcastb ymm6, xmm6\n"
+                 << "    vpbroadcastb ymm7, xmm7\n";
+        WriteSearchLoop_NASM("mem_find_any_avx2", 32,
+                             "    vmovdqu ymm0, [rdi + rax]\n"
+                             "    vpcmpeqb ymm1, ymm0, ymm4\n"
+                             "    vpcmpeqb ymm2, ymm0, ymm5\n"
+                             "    vpor ymm1, ymm1, ymm2\n"
+                             "    vpcmpeqb ymm2, ymm0, ymm6\n"
+                             "    vpor ymm1, ymm1, ymm2\n"
+                             "    vpcmpeqb ymm2, ymm0, ymm7\n"
+                             "    vpor ymm1, ymm1, ymm2\n"
+                             "    vpmovmskb ecx, ymm1\n", asm_file);
+        WriteSearchLoop_NASM("mem_find_any_sse2", 16,
+                             "    movdqu xmm0, [rdi + rax]\n"
+                             "    movdqa xmm1, xmm0\n"
+                             "    pcmpeqb xmm1, xmm4\n"
+                             "    movdqa xmm2, xmm0\n"
+                             "    pcmpeqb xmm2, xmm5\n"
+                             "    por xmm1, xmm2\n"
+                             "    movdqa xmm2, xmm0\n"
+                             "    pcmpeqb xmm2, xmm6\n"
+                             "    por xmm1, xmm2\n"
+                             "    pcmpeqb xmm0, xmm7\n"
+                             "    por xmm1, xmm0\n"
+                             "    pmovmskb ecx, xmm1\n", asm_file);
+        asm_file << "mem_find_any_table:\n"
+                 << "    sub rsp, 32\n"
+                 << "    xor eax, eax\n"
+                 << "    mov [rsp], rax\n"
+                 << "    mov [rsp + 8], rax\n"
+                 << "    mov [rsp + 16], rax\n"
+                 << "    mov [rsp + 24], rax\n"
+                 << "mem_find_any_table_set:\n"
+                 << "    movzx ecx, byte [rdx]\n"
+                 << "    test ecx, ecx\n"
+                 << "    jz mem_find_any_table_scan\n"
+                 << "    bts [rsp], rcx\n"
+                 << "    inc rdx\n"
+                 << "    jmp mem_find_any_table_set\n"
+                 << "mem_find_any_table_scan:\n"
+                 << "    cmp rax, rsi\n"
+                 << "    je mem_find_any_table_done\n"
+                 << "    movzx ecx, byte [rdi + rax]\n"
+                 << "    mov r8d, ecx\n"
+                 << "    shr r8d, 6\n"
+                 << "    mov r8, [rsp + r8 * 8]\n"
+                 << "    bt r8, rcx\n"
+                 << "    jc mem_find_any_table_done\n"
+                 << "    inc rax\n"
+                 << "    jmp mem_find_any_table_scan\n"
+                 << "mem_find_any_table_done:\n"
+                 << "    add rsp, 32\n"
+                 << "    ret\n"
+                 << "    SECTION .data\n"
+                 << "cpu_features db " << (avx2 ? 2 : 0) << '\n'
+                 << "    SECTION .text\n";
+    }
+
+    // With `avx2`, the target is known to support AVX2 and the routines never run `cpu_detect`.
+    void WriteByteSearch_GAS(bool avx2, std::ostream& asm_file) {
+        // Broadcast the byte in ecx to every byte of `xmm`.
+        auto broadcast = [](const std::string& xmm) {
+            return "    imul $0x01010101, %ecx, %ecx\n"
+                   "    movd %ecx, %" + xmm + "\n"
+                   "    pshufd $0, %" + xmm + ", %" + xmm + "\n";
+        };
+        asm_file << "\n"
+                 << "    # -- byte search routines --\n"
+                 << "    # cpu_detect: cpu_features = 2 if both the CPU and the OS support AVX2, else 1 (SSE2)\n"
+                 << "cpu_detect:\n"
+                 << "    push %rbx\n"
+                 << "    push %rdx\n"
+                 << "    mov $1, %r8d\n"
+                 << "    xor %eax, %eax\n"
+                 << "    cpuid\n"
+                 << "    cmp $7, %eax\n"
+                 << "    jb cpu_detect_done\n"
+                 << "    mov $1, %eax\n"
+                 << "    cpuid\n"
+                 << "    # OSXSAVE and AVX\n"
+                 << "    and $0x18000000, %ecx\n"
+                 << "    cmp $0x18000000, %ecx\n"
+                 << "    jne cpu_detect_done\n"
+                 << "    # The OS saves the XMM and YMM registers.\n"
+                 << "    xor %ecx, %ecx\n"
+                 << "    xgetbv\n"
+                 << "    and $6, %eax\n"
+                 << "    cmp $6, %eax\n"
+                 << "    jne cpu_detect_done\n"
+                 << "    mov $7, %eax\n"
+                 << "    xor %ecx, %ecx\n"
+                 << "    cpuid\n"
+                 << "    test $0x20, %ebx\n"
+                 << "    jz cpu_detect_done\n"
+                 << "    mov $2, %r8d\n"
+                 << "cpu_detect_done:\n"
+                 << "    mov %r8b, cpu_features(%rip)\n"
+                 << "    pop %rdx\n"
+                 << "    pop %rbx\n"
+                 << "    ret\n"
+                 << "    # mem_find_byte: rdi = address, rsi = length, rdx = byte -> rax = offset of the first match, or length\n"
+                 << "mem_find_byte:\n"
+                 << "    cmpb $0, cpu_features(%rip)\n"
+                 << "    jne mem_find_byte_ready\n"
+                 << "    call cpu_detect\n"
+                 << "mem_find_byte_ready:\n"
+                 << "    movzbl %dl, %ecx\n"
+                 << broadcast("xmm0")
+                 << "    xor %eax, %eax\n"
+                 << "    cmp $16, %rsi\n"
+                 << "    jb mem_find_byte_bytes\n"
+                 << "    cmp $32, %rsi\n"
+                 << "    jb mem_find_byte_sse2\n"
+                 << "    cmpb $2, cpu_features(%rip)\n"
+                 << "    jne mem_find_byte_sse2\n"
+                 << "    vpbroadcastb %xmm0, %ymm0\n";
+        WriteSearchLoop_GAS("mem_find_byte_avx2", 32,
+                            "    vpcmpeqb (%rdi,%rax), %ymm0, %ymm1\n"
+                            "    vpmovmskb %ymm1, %ecx\n", asm_file);
+        WriteSearchLoop_GAS("mem_find_byte_sse2", 16,
+                            "    movdqu (%rdi,%rax), %xmm1\n"
+                            "    pcmpeqb %xmm0, %xmm1\n"
+                            "    pmovmskb %xmm1, %ecx\n", asm_file);
+        asm_file << "mem_find_byte_bytes:\n"
+                 << "    cmp %rsi, %rax\n"
+                 << "    je mem_find_byte_done\n"
+                 << "    cmp %dl, (%rdi,%rax)\n"
+                 << "    je mem_find_byte_done\n"
+                 << "    inc %rax\n"
+                 << "    jmp mem_find_byte_bytes\n"
+                 << "mem_find_byte_done:\n"
+                 << "    ret\n"
+                 << "    # mem_find_any: rdi = address, rsi = length, rdx = null-terminated set of bytes -> rax = offset of the first match, or length\n"
+                 << "mem_find_any:\n"
+                 << "    cmpb $0, cpu_features(%rip)\n"
+                 << "    jne mem_find_any_ready\n"
+                 << "    call cpu_detect\n"
+                 << "mem_find_any_ready:\n"
+                 << "    cmp $16, %rsi\n"
+                 << "    jb mem_find_any_table\n"
+                 << "    cmpb $0, (%rdx)\n"
+                 << "    je mem_find_any_table\n"
+                 << "    # Up to four bytes of the set go into xmm4 through xmm7; missing ones repeat the first.\n"
+                 << "    movzbl (%rdx), %ecx\n"
+                 << broadcast("xmm4")
+                 << "    movdqa %xmm4, %xmm5\n"
+                 << "    movdqa %xmm4, %xmm6\n"
+                 << "    movdqa %xmm4, %xmm7\n";
+        for (int i = 1; i < 4; i++) {
+            asm_file << "    movzbl " << i << "(%rdx), %ecx\n"
+                     << "    test %ecx, %ecx\n"
+                     << "    jz mem_find_any_vector\n"
+                     << broadcast("xmm" + std::to_string(4 + i));
+        }
+        asm_file << "    cmpb $0, 4(%rdx)\n"
+                 << "    jne mem_find_any_table\n"
+                 << "mem_find_any_vector:\n"
+                 << "    xor %eax, %eax\n"
+                 << "    cmp $32, %rsi\n"
+                 << "    jb mem_find_any_sse2\n"
+                 << "    cmpb $2, cpu_features(%rip)\n"
+                 << "    jne mem_find_any_sse2\n"
+                 << "    vpbroadcastb %xmm4, %ymm4\n"
+                 << "    vpbroadcastb %xmm5, %ymm5\n"
+                 << "    vpbroadcastb %xmm6, %ymm6\n"
+                 << "    vpbroadcastb %xmm7, %ymm7\n";
+        WriteSearchLoop_GAS("mem_find_any_avx2", 32,
+                            "    vmovdqu (%rdi,%rax), %ymm0\n"
+                            "    vpcmpeqb %ymm4, %ymm0, %ymm1\n"
+                            "    vpcmpeqb %ymm5, %ymm0, %ymm2\n"
+                            "    vpor %ymm2, %ymm1, %ymm1\n"
+                            "    vpcmpeqb %ymm6, %ymm0, %ymm2\n"
+                            "    vpor %ymm2, %ymm1, %ymm1\n"
+                            "    vpcmpeqb %ymm7, %ymm0, %ymm2\n"
+                            "    vpor %ymm2, %ymm1, %ymm1\n"
+                            "    vpmovmskb %ymm1, %ecx\n", asm_file);
+        WriteSearchLoop_GAS("mem_find_any_sse2", 16,
+                            "    movdqu (%rdi,%rax), %xmm0\n"
+                            "    movdqa %xmm0, %xmm1\n"
+                            "    pcmpeqb %xmm4, %xmm1\n"
+                            "    movdqa %xmm0, %xmm2\n"
+                            "    pcmpeqb %xmm5, %xmm2\n"
+                            "    por %xmm2, %xmm1\n"
+                            "    movdqa %xmm0, %xmm2\n"
+                            "    pcmpeqb %xmm6, %xmm2\n"
+                            "    por %xmm2, %xmm1\n"
+                            "    pcmpeqb %xmm7, %xmm0\n"
+                            "    por %xmm0, %xmm1\n"
+                            "    pmovmskb %xmm1, %ecx\n", asm_file);
+        asm_file << "mem_find_any_table:\n"
+                 << "    sub $32, %rsp\n"
+                 << "    xor %eax, %eax\n"
+                 << "    mov %rax, (%rsp)\n"
+                 << "    mov %rax, 8(%rsp)\n"
+                 << "    mov %rax, 16(%rsp)\n"
+                 << "    mov %rax, 24(%rsp)\n"
+                 << "mem_find_any_table_set:\n"
+                 << "    movzbl (%rdx), %ecx\n"
+                 << "    test %ecx, %ecx\n"
+                 << "    jz mem_find_any_table_scan\n"
+                 << "    bts %rcx, (%rsp)\n"
+                 << "    inc %rdx\n"
+                 << "    jmp mem_find_any_table_set\n"
+                 << "mem_find_any_table_scan:\n"
+                 << "    cmp %rsi, %rax\n"
+                 << "    je mem_find_any_table_done\n"
+                 << "    movzbl (%rdi,%rax), %ecx\n"
+                 << "    mov %ecx, %r8d\n"
+                 << "    shr $6, %r8d\n"
+                 << "    mov (%rsp,%r8,8), %r8\n"
+                 << "    bt %rcx, %r8\n"
+                 << "    jc mem_find_any_table_done\n"
+                 << "    inc %rax\n"
+                 << "    jmp mem_find_any_table_scan\n"
+                 << "mem_find_any_table_done:\n"
+                 << "    add $32, %rsp\n"
+                 << "    ret\n"
+                 << "    .data\n"
+                 << "cpu_features: .byte " << (avx2 ? 2 : 0) << '\n'
+                 << "    .text\n";
+    }
+
+    // Pop the arguments of a bulk memory or byte search keyword and call its routine;
+    //   all but `mem_fill` and `mem_copy` push their result.
+    void WriteBulkMemoryCall_NASM(const Token& tok, std::ostream& asm_file) {
+        bool compare = tok.text != GetKeywordStr(Keyword::MEM_FILL) && tok.text != GetKeywordStr(Keyword::MEM_COPY);
+        asm_file << "    ;; -- " << tok.text << " --\n"
+                 << "    pop rdx\n"
+                 << "    pop rsi\n"
+                 << "    pop rdi\n"
+                 << "    call " << tok.text << '\n';
+        if (compare) { asm_file << "    push rax\n"; }
+    }
+
+    void WriteBulkMemoryCall_GAS(const Token& tok, std::ostream& asm_file) {
+        bool compare = tok.text != GetKeywordStr(Keyword::MEM_FILL) && tok.text != GetKeywordStr(Keyword::MEM_COPY);
+        asm_file << "    # -- " << tok.text << " --\n"
+                 << "    pop %rdx\n"
+                 << "    pop %rsi\n"
+                 << "    pop %rdi\n"
+                 << "    call " << tok.text << '\n';
+        if (compare) { asm_file << "    push %rax\n"; }
+    }
+
+    // Shift the item below the top of the stack by the top.
+    // BMI2's `shlx` and `shrx` take the count in any register (not just cl) and don't write the flags.
+    void WriteShift_NASM(const Context& ctx, bool left, std::ostream& asm_file) {
+        std::string shift = left ? "shl" : "shr";
+        asm_file << "    ;; -- bitwise-shift " << (left ? "left" : "right") << " --\n";
+        if (TargetHas(ctx, CPU_FEATURE::BMI2)) {
+            asm_file << "    pop rax\n"
+                     << "    " << shift << "x rax, [rsp], rax\n"
+                     << "    mov [rsp], rax\n";
+        }
+        else {
+            asm_file << "    pop rcx\n"
+                     << "    pop rbx\n"
+                     << "    " << shift << " rbx, cl\n"
+                     << "    push rbx\n";
+        }
+    }
+
+    void WriteShift_GAS(const Context& ctx, bool left, std::ostream& asm_file) {
+        std::string shift = left ? "shl" : "shr";
+        asm_file << "    # -- bitwise-shift " << (left ? "left" : "right") << " --\n";
+        if (TargetHas(ctx, CPU_FEATURE::BMI2)) {
+            asm_file << "    pop %rax\n"
+                     << "    " << shift << "x %rax, (%rsp), %rax\n"
+                     << "    mov %rax, (%rsp)\n";
+        }
+        else {
+            asm_file << "    pop %rcx\n"
+                     << "    pop %rbx\n"
+                     << "    " << shift << " %cl, %rbx\n"
+                     << "    push %rbx\n";
+        }
+    }
+
+    // BIT MANIPULATION
+    // `popcnt`, `lzcnt`, `tzcnt`, `bswap`, `rol`, `ror`, `pext` and `pdep` work on the top of the stack in place.
+    // Each is a single instruction when the `-march` target has it; otherwise, a short sequence of
+    //   baseline x86_64 instructions computes the same result (`lzcnt` and `tzcnt` of zero are 64).
+    bool IsBitManipulation(const Token& tok) {
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                      "Exhaustive handling of keywords in IsBitManipulation");
+        return tok.type == TokenType::KEYWORD
+            && (tok.text == GetKeywordStr(Keyword::POPCNT)
+                || tok.text == GetKeywordStr(Keyword::LZCNT)
+                || tok.text == GetKeywordStr(Keyword::TZCNT)
+                || tok.text == GetKeywordStr(Keyword::BSWAP)
+                || tok.text == GetKeywordStr(Keyword::ROL)
+                || tok.text == GetKeywordStr(Keyword::ROR)
+                || tok.text == GetKeywordStr(Keyword::PEXT)
+                || tok.text == GetKeywordStr(Keyword::PDEP));
+    }
+
+    void WriteBitManipulation_NASM(const Context& ctx, const Token& tok, size_t instr_ptr, std::ostream& asm_file) {
+        asm_file << "    ;; -- " << tok.text << " --\n";
+        if (tok.text == GetKeywordStr(Keyword::POPCNT)) {
+            if (TargetHas(ctx, CPU_FEATURE::POPCNT)) {
+                asm_file << "    popcnt rax, [rsp]\n";
+            }
+            else {
+                // Count bits in pairs, then nibbles, then bytes, then add up the bytes with a multiply.
+                asm_file << "    mov rax, [rsp]\n"
+                         << "    mov rbx, rax\n"
+                         << "    shr rbx, 1\n"
+                         << "    mov rcx, 0x5555555555555555\n"
+                         << "    and rbx, rcx\n"
+                         << "    sub rax, rbx\n"
+                         << "    mov rbx, rax\n"
+                         << "    shr rax, 2\n"
+                         << "    mov rcx, 0x3333333333333333\n"
+                         << "    and rax, rcx\n"
+                         << "    and rbx, rcx\n"
+                         << "    add rax, rbx\n"
+                         << "    mov rbx, rax\n"
+                         << "    shr rbx, 4\n"
+                         << "    add rax, rbx\n"
+                         << "    mov rcx, 0x0f0f0f0f0f0f0f0f\n"
+                         << "    and rax, rcx\n"
+                         << "    mov rcx, 0x0101010101010101\n"
+                         << "    imul rax, rcx\n"
+                         << "    shr rax, 56\n";
+            }
+            asm_file << "    mov [rsp], rax\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::LZCNT)) {
+            if (TargetHas(ctx, CPU_FEATURE::LZCNT)) {
+                asm_file << "    lzcnt rax, [rsp]\n";
+            }
+            else {
+                // 63 - index of the highest set bit; 127 ^ 63 = 64 when there is none.
+                asm_file << "    bsr rax, [rsp]\n"
+                         << "    mov ecx, 127\n"
+                         << "    cmovz rax, rcx\n"
+                         << "    xor rax, 63\n";
+            }
+            asm_file << "    mov [rsp], rax\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::TZCNT)) {
+            if (TargetHas(ctx, CPU_FEATURE::BMI1)) {
+                asm_file << "    tzcnt rax, [rsp]\n";
+            }
+            else {
+                asm_file << "    bsf rax, [rsp]\n"
+                         << "    mov ecx, 64\n"
+                         << "    cmovz rax, rcx\n";
+            }
+            asm_file << "    mov [rsp], rax\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::BSWAP)) {
+            asm_file << "    mov rax, [rsp]\n"
+                     << "    bswap rax\n"
+                     << "    mov [rsp], rax\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::ROL)
+                 || tok.text == GetKeywordStr(Keyword::ROR)) {
+            asm_file << "    pop rcx\n"
+                     << "    " << tok.text << " qword [rsp], cl\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::PEXT)
+                 || tok.text == GetKeywordStr(Keyword::PDEP)) {
+            bool extract = tok.text == GetKeywordStr(Keyword::PEXT);
+            if (TargetHas(ctx, CPU_FEATURE::BMI2)) {
+                asm_file << "    pop rbx\n"
+                         << "    mov rax, [rsp]\n"
+                         << "    " << tok.text << " rax, rax, rbx\n"
+                         << "    mov [rsp], rax\n";
+                return;
+            }
+            // Walk the set bits of the mask (rbx) from the lowest up; rsi is the current one,
+            //   and rdi the bit of the packed value that goes with it.
+            std::string label = tok.text + '_' + std::to_string(instr_ptr);
+            asm_file << "    pop rbx\n"
+                     << "    mov rdx, [rsp]\n"
+                     << "    xor eax, eax\n"
+                     << "    mov edi, 1\n"
+                     << label << "_loop:\n"
+                     << "    test rbx, rbx\n"
+                     << "    jz " << label << "_done\n"
+                     << "    mov rsi, rbx\n"
+                     << "    neg rsi\n"
+                     << "    and rsi, rbx\n"
+                     << "    test rdx, " << (extract ? "rsi" : "rdi") << '\n'
+                     << "    jz " << label << "_skip\n"
+                     << "    or rax, " << (extract ? "rdi" : "rsi") << '\n'
+                     << label << "_skip:\n"
+                     << "    add rdi, rdi\n"
+                     << "    xor rbx, rsi\n"
+                     << "    jmp " << label << "_loop\n"
+                     << label << "_done:\n"
+                     << "    mov [rsp], rax\n";
+        }
+    }
+
+    void WriteBitManipulation_GAS(const Context& ctx, const Token& tok, size_t instr_ptr, std::ostream& asm_file) {
+        asm_file << "    # -- " << tok.text << " --\n";
+        if (tok.text == GetKeywordStr(Keyword::POPCNT)) {
+            if (TargetHas(ctx, CPU_FEATURE::POPCNT)) {
+                asm_file << "    popcnt (%rsp), %rax\n";
+            }
+            else {
+                // Count bits in pairs, then nibbles, then bytes, then add up the bytes with a multiply.
+                asm_file << "    mov (%rsp), %rax\n"
+                         << "    mov %rax, %rbx\n"
+                         << "    shr $1, %rbx\n"
+                         << "    movabs $0x5555555555555555, %rcx\n"
+                         << "    and %rcx, %rbx\n"
+                         << "    sub %rbx, %rax\n"
+                         << "    mov %rax, %rbx\n"
+                         << "    shr $2, %rax\n"
+                         << "    movabs $0x3333333333333333, %rcx\n"
+                         << "    and %rcx, %rax\n"
+                         << "    and %rcx, %rbx\n"
+                         << "    add %rbx, %rax\n"
+                         << "    mov %rax, %rbx\n"
+                         << "    shr $4, %rbx\n"
+                         << "    add %rbx, %rax\n"
+                         << "    movabs $0x0f0f0f0f0f0f0f0f, %rcx\n"
+                         << "    and %rcx, %rax\n"
+                         << "    movabs $0x0101010101010101, %rcx\n"
+                         << "    imul %rcx, %rax\n"
+                         << "    shr $56, %rax\n";
+            }
+            asm_file << "    mov %rax, (%rsp)\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::LZCNT)) {
+            if (TargetHas(ctx, CPU_FEATURE::LZCNT)) {
+                asm_file << "    lzcnt (%rsp), %rax\n";
+            }
+            else {
+                // 63 - index of the highest set bit; 127 ^ 63 = 64 when there is none.
+                asm_file << "    bsr (%rsp), %rax\n"
+                         << "    mov $127, %ecx\n"
+                         << "    cmovz %rcx, %rax\n"
+                         << "    xor $63, %rax\n";
+            }
+            asm_file << "    mov %rax, (%rsp)\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::TZCNT)) {
+            if (TargetHas(ctx, CPU_FEATURE::BMI1)) {
+                asm_file << "    tzcnt (%rsp), %rax\n";
+            }
+            else {
+                asm_file << "    bsf (%rsp), %rax\n"
+                         << "    mov $64, %ecx\n"
+                         << "    cmovz %rcx, %rax\n";
+            }
+            asm_file << "    mov %rax, (%rsp)\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::BSWAP)) {
+            asm_file << "    mov (%rsp), %rax\n"
+                     << "    bswap %rax\n"
+                     << "    mov %rax, (%rsp)\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::ROL)
+                 || tok.text == GetKeywordStr(Keyword::ROR)) {
+            asm_file << "    pop %rcx\n"
+                     << "    " << tok.text << "q %cl, (%rsp)\n";
+        }
+        else if (tok.text == GetKeywordStr(Keyword::PEXT)
+                 || tok.text == GetKeywordStr(Keyword::PDEP)) {
+            bool extract = tok.text == GetKeywordStr(Keyword::PEXT);
+            if (TargetHas(ctx, CPU_FEATURE::BMI2)) {
+                asm_file << "    pop %rbx\n"
+                         << "    mov (%rsp), %rax\n"
+                         << "    " << tok.text << " %rbx, %rax, %rax\n"
+                         << "    mov %rax, (%rsp)\n";
+                return;
+            }
+            // Walk the set bits of the mask (rbx) from the lowest up; rsi is the current one,
+            //   and rdi the bit of the packed value that goes with it.
+            std::string label = tok.text + '_' + std::to_string(instr_ptr);
+            asm_file << "    pop %rbx\n"
+                     << "    mov (%rsp), %rdx\n"
+                     << "    xor %eax, %eax\n"
+                     << "    mov $1, %edi\n"
+                     << label << "_loop:\n"
+                     << "    test %rbx, %rbx\n"
+                     << "    jz " << label << "_done\n"
+                     << "    mov %rbx, %rsi\n"
+                     << "    neg %rsi\n"
+                     << "    and %rbx, %rsi\n"
+                     << "    test " << (extract ? "%rsi" : "%rdi") << ", %rdx\n"
+                     << "    jz " << label << "_skip\n"
+                     << "    or " << (extract ? "%rdi" : "%rsi") << ", %rax\n"
+                     << label << "_skip:\n"
+                     << "    add %rdi, %rdi\n"
+                     << "    xor %rsi, %rbx\n"
+                     << "    jmp " << label << "_loop\n"
+                     << label << "_done:\n"
+                     << "    mov %rax, (%rsp)\n";
+        }
+    }
+
+    void WriteAssembly_NASM_linux64(Context& ctx, Program& prog, std::ostream& asm_file) {
+        // WRITE HEADER TO ASM FILE
+        asm_file << "    ;; CORTH COMPILER GENERATED THIS ASSEMBLY -- (BY LENSOR RADII)\n"
+                 << "    ;; USING `SYSTEM V AMD64 ABI` CALLING CONVENTION (RDI, RSI, RDX, RCX, R8, R9, -> STACK)\n"
+                 << "    ;; LINUX SYSTEM CALLS USE R10 INSTEAD OF RCX\n"
+                 << "    SECTION .text\n"
+                 << "    ;; DEFINE EXTERNAL C RUNTIME SYMBOLS\n"
+                 << "    extern exit\n"
+                 << "    extern printf\n"
+                 << "    extern fopen\n"
+                 << "    extern fwrite\n"
+                 << "    extern fread\n"
+                 << "    extern fclose\n"
+                 << "    extern strlen\n"
+                 << "    extern stdout\n";
+        if (ctx.profile || ctx.sample || ctx.memtrace) { asm_file << "    extern fprintf\n"; }
+        if (MemIsMapped(ctx) || ctx.memtrace || MapsFiles(prog)) {
+            asm_file << "    extern mmap\n"
+                     << "    extern madvise\n";
+        }
+        if (UsesAsyncIO(prog)) {
+            asm_file << "    extern fileno\n"
+                     << "    extern aio_read\n"
+                     << "    extern aio_write\n"
+                     << "    extern aio_error\n"
+                     << "    extern aio_return\n"
+                     << "    extern aio_suspend\n";
+        }
+        if (MapsFiles(prog)) {
+            asm_file << "    extern open\n"
+                     << "    extern lseek\n"
+                     << "    extern close\n"
+                     << "    extern munmap\n";
+        }
+        if (ctx.mem_grow) { asm_file << "    extern mprotect\n"; }
+        if (ctx.sample || ctx.mem_grow) { asm_file << "    extern sigaction\n"; }
+        if (MemIsMapped(ctx) || ctx.memtrace) { asm_file << "    extern perror\n"; }
+        if (ctx.sample) { asm_file << "    extern setitimer\n"; }
+        if (ctx.perfstat) {
+            asm_file << "    extern syscall\n"
+                     << "    extern dprintf\n";
+        }
+        asm_file << "\n"
+                 << "    global _start\n"
+                 << "_start:\n";
+        if (MemIsMapped(ctx)) { WriteMemMap_NASM_linux64(ctx, asm_file); }
+        if (ctx.mem_grow) { WriteMemGrowSetup_NASM_linux64(ctx, asm_file); }
+        if (UsesAsyncIO(prog)) { WriteAsyncSetup_NASM_linux64(asm_file); }
+        if (ctx.memtrace) { WriteMemTraceSetup_NASM_linux64(ctx, asm_file); }
+        if (ctx.sample) { WriteSamplerSetup_NASM_linux64(asm_file); }
+        if (ctx.perfstat) { WritePerfStatOpen_NASM_linux64(asm_file); }
+
+        // Token index at which every profiled basic block starts
+        std::vector<size_t> profile_blocks;
+        // Token index of every load and store traced with `-memtrace`
+        std::vector<size_t> memtrace_sites;
+        std::string debug_source = std::filesystem::absolute(ctx.SOURCE_PATH).string();
+        if (debug_source.find(' ') != std::string::npos) { debug_source = '"' + debug_source + '"'; }
+
+        // WRITE TOKENS TO ASM FILE MAIN LABEL
+        static_assert(static_cast<int>(TokenType::COUNT) == 5,
+                      "Exhaustive handling of token types in WriteAssembly_NASM_linux64");
+        size_t instr_ptr = 0;
+        size_t instr_ptr_max = prog.tokens.size();
+        while (instr_ptr < instr_ptr_max) {
+            Token& tok = prog.tokens[instr_ptr];
+            if (ctx.sample) { asm_file << "sample_token_" << instr_ptr << ":\n"; }
+            if (ctx.debug_info) {
+                // NASM only tracks lines; the file name carries over to every following `%line`.
+                asm_file << "%line " << tok.line_number << "+0";
+                if (instr_ptr == 0) { asm_file << ' ' << debug_source; }
+                asm_file << '\n';
+            }
+            if (ctx.profile && StartsBasicBlock(prog, instr_ptr)) {
+                asm_file << "    inc qword [prof_counts + " << 8 * profile_blocks.size() << "]\n";
+                profile_blocks.push_back(instr_ptr);
+            }
+            if (ctx.memtrace && MemoryAccessSize(tok) != 0) {
+                WriteMemTraceAccess_NASM_linux64(ctx, tok, memtrace_sites.size(), asm_file);
+                memtrace_sites.push_back(instr_ptr);
+            }
+            // Write assembly to opened file based on token type and value
+            if (tok.type == TokenType::INT) {
+                asm_file << "    ;; -- push INT --\n"
+                         << "    mov rax, " << tok.text << "\n"
+                         << "    push rax\n";
+            }
+            else if (tok.type == TokenType::STRING) {
+                asm_file << "    ;; -- push STRING --\n"
+                         << "    mov rax, str_pool + " << tok.data << '\n'
+                         << "    push rax\n";
+            }
+            else if (tok.type == TokenType::OP) {
+                static_assert(OP_COUNT == 15,
+                              "Exhaustive handling of operators in WriteAssembly_NASM_linux64");
+                if (tok.text == "+") {
+                    asm_file << "    ;; -- add --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    add rax, rbx\n"
+                             << "    push rax\n";
                 }
-                else if (tok.type == TokenType::OP) {
-                    static_assert(OP_COUNT == 15,
-                                  "Exhaustive handling of operators in GenerateAssembly_GAS_linux64");
-                    if (tok.text == "+") {
-                        asm_file << "    # -- add --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    add %rbx, %rax\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == "-") {
-                        asm_file << "    # -- subtract --\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    sub %rbx, %rax\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == "*") {
-                        asm_file << "    # -- multiply --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    mul %rbx\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == "/") {
-                        asm_file << "    # -- divide --\n"
-                                 << "    xor %rdx, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    div %rbx\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == "%") {
-                        asm_file << "    # -- modulo --\n"
-                                 << "    xor %rdx, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    div %rbx\n"
-                                 << "    push %rdx\n";
-                    }
-                    else if (tok.text == "=") {
-                        asm_file << "    # -- equality condition --\n"
-                                 << "    mov $0, %rcx\n"
-                                 << "    mov $1, %rdx\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    cmp %rbx, %rax\n"
-                                 << "    cmove %rdx, %rcx\n"
-                                 << "    push %rcx\n";
-                    }
-                    else if (tok.text == "<") {
-                        asm_file << "    # -- less than condition --\n"
-                                 << "    mov $0, %rcx\n"
-                                 << "    mov $1, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    cmp %rbx, %rax\n"
-                                 << "    cmovl %rdx, %rcx\n"
-                                 << "    push %rcx\n";
-                    }
-                    else if (tok.text == ">") {
-                        asm_file << "    # -- greater than condition --\n"
-                                 << "    mov $0, %rcx\n"
-                                 << "    mov $1, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    cmp %rbx, %rax\n"
-                                 << "    cmovg %rdx, %rcx\n"
-                                 << "    push %rcx\n";
-                    }
-                    else if (tok.text == "<=") {
-                        asm_file << "    # -- less than or equal condition --\n"
-                                 << "    mov $0, %rcx\n"
-                                 << "    mov $1, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    cmp %rbx, %rax\n"
-                                 << "    cmovle %rdx, %rcx\n"
-                                 << "    push %rcx\n";
-                    }
-                    else if (tok.text == ">=") {
-                        asm_file << "    # -- greater than or equal condition --\n"
-                                 << "    mov $0, %rcx\n"
-                                 << "    mov $1, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    cmp %rbx, %rax\n"
-                                 << "    cmovge %rdx, %rcx\n"
-                                 << "    push %rcx\n";
-                    }
-                    else if (tok.text == "<<") {
-                        asm_file << "    # -- bitwise-shift left --\n"
-                                 << "    pop %rcx\n"
-                                 << "    pop %rbx\n"
-                                 << "    shl %cl, %rbx\n"
-                                 << "    push %rbx";
-                    }
-                    else if (tok.text == ">>") {
-                        asm_file << "    # -- bitwise-shift right --\n"
-                                 << "    pop %rcx\n"
-                                 << "    pop %rbx\n"
-                                 << "    shr %cl, %rbx\n"
-                                 << "    push %rbx";
-                    }
-                    else if (tok.text == "||") {
-                        asm_file << "    # -- bitwise or --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    or %rbx, %rax\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == "&&") {
-                        asm_file << "    # -- bitwise and --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    and %rbx, %rax\n"
-                                 << "    push %rax\n";
+                else if (tok.text == "-") {
+                    asm_file << "    ;; -- subtract --\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    sub rax, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == "*") {
+                    asm_file << "    ;; -- multiply --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    mul rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == "/") {
+                    asm_file << "    ;; -- divide --\n"
+                             << "    xor rdx, rdx\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    div rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == "%") {
+                    asm_file << "    ;; -- modulo --\n"
+                             << "    xor rdx, rdx\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    div rbx\n"
+                             << "    push rdx\n";
+                }
+                else if (tok.text == "=") {
+                    asm_file << "    ;; -- equality condition --\n"
+                             << "    mov rcx, 0\n"
+                             << "    mov rdx, 1\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    cmp rax, rbx\n"
+                             << "    cmove rcx, rdx\n"
+                             << "    push rcx\n";
+                }
+                else if (tok.text == "<") {
+                    asm_file << "    ;; -- less than condition --\n"
+                             << "    mov rcx, 0\n"
+                             << "    mov rdx, 1\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    cmp rax, rbx\n"
+                             << "    cmovl rcx, rdx\n"
+                             << "    push rcx\n";
+                }
+                else if (tok.text == ">") {
+                    asm_file << "    ;; -- greater than condition --\n"
+                             << "    mov rcx, 0\n"
+                             << "    mov rdx, 1\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    cmp rax, rbx\n"
+                             << "    cmovg rcx, rdx\n"
+                             << "    push rcx\n";
+                }
+                else if (tok.text == "<=") {
+                    asm_file << "    ;; -- less than or equal condition --\n"
+                             << "    mov rcx, 0\n"
+                             << "    mov rdx, 1\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    cmp rax, rbx\n"
+                             << "    cmovle rcx, rdx\n"
+                             << "    push rcx\n";
+                }
+                else if (tok.text == ">=") {
+                    asm_file << "    ;; -- greater than or equal condition --\n"
+                             << "    mov rcx, 0\n"
+                             << "    mov rdx, 1\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    cmp rax, rbx\n"
+                             << "    cmovge rcx, rdx\n"
+                             << "    push rcx\n";
+                }
+                else if (tok.text == "<<") {
+                    WriteShift_NASM(ctx, true, asm_file);
+                }
+                else if (tok.text == ">>") {
+                    WriteShift_NASM(ctx, false, asm_file);
+                }
+                else if (tok.text == "||") {
+                    asm_file << "    ;; -- bitwise or --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    or rax, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == "&&") {
+                    asm_file << "    ;; -- bitwise and --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    and rax, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == "#") {
+                    // Without clearing rax, seg faults can happen seemingly at random
+                    asm_file << "    ;; -- dump --\n"
+                             << "    lea rdi, [rel fmt]\n"
+                             << "    pop rsi\n"
+                             << "    xor rax, rax\n"
+                             << "    call printf\n";
+                }
+            }
+            else if (tok.type == TokenType::KEYWORD) {
+                static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                              "Exhaustive handling of keywords in WriteAssembly_NASM_linux64");
+                if (tok.text == GetKeywordStr(Keyword::IF)) {
+                    asm_file << "    ;; -- if --\n"
+                             << "    pop rax\n"
+                             << "    cmp rax, 0\n"
+                             << "    je addr_" << tok.data << "\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ELSE)) {
+                    asm_file << "    ;; -- else --\n"
+                             << "    jmp addr_" << tok.data << "\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ENDIF)) {
+                    asm_file << "    ;; -- endif --\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::WHILE)) {
+                    asm_file << "    ;; -- while --\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DO)) {
+                    asm_file << "    ;; -- do --\n"
+                             << "    pop rax\n"
+                             << "    cmp rax, 0\n"
+                             << "    je addr_" << tok.data << "\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ENDWHILE)) {
+                    asm_file << "    ;; -- endwhile --\n"
+                             << "    jmp addr_" << tok.data << "\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                
+                else if (tok.text == GetKeywordStr(Keyword::DUP)) {
+                    asm_file << "    ;; -- dup --\n"
+                             << "    pop rax\n"
+                             << "    push rax\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::TWODUP)) {
+                    asm_file << "    ;; -- twodup --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    push rbx\n"
+                             << "    push rax\n"
+                             << "    push rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DROP)) {
+                    asm_file << "    ;; -- drop --\n"
+                             << "    pop rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::SWAP)) {
+                    asm_file << "    ;; -- swap --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    push rax\n"
+                             << "    push rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::OVER)) {
+                    asm_file << "    ;; -- over --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    push rbx\n"
+                             << "    push rax\n"
+                             << "    push rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP)) {
+                    asm_file << "    ;; -- dump --\n"
+                             << "    lea rdi, [rel fmt]\n"
+                             << "    pop rsi\n"
+                             << "    xor rax, rax\n"
+                             << "    call printf\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP_C)) {
+                    asm_file << "    ;; -- dump character --\n"
+                             << "    lea rdi, [rel fmt_char]\n"
+                             << "    pop rsi\n"
+                             << "    xor rax, rax\n"
+                             << "    call printf\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP_S)) {
+                    if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                        // fwrite(literal, 1, length, stdout)
+                        asm_file << "    ;; -- dump string literal --\n"
+                                 << "    pop rdi\n"
+                                 << "    mov rsi, 1\n"
+                                 << "    mov rdx, " << KnownStringLength(*literal) << '\n'
+                                 << "    mov rcx, [rel stdout]\n"
+                                 << "    mov rbx, rsp\n"
+                                 << "    and rsp, -16\n"
+                                 << "    call fwrite\n"
+                                 << "    mov rsp, rbx\n";
                     }
-                    else if (tok.text == "#") {
-                        asm_file << "    # -- dump --\n"
-                                 << "    lea fmt(%rip), %rdi\n"
-                                 << "    pop %rsi\n"
-                                 << "    xor %rax, %rax\n"
+                    else {
+                        asm_file << "    ;; -- dump string --\n"
+                                 << "    lea rdi, [rel fmt_str]\n"
+                                 << "    pop rsi\n"
+                                 << "    xor rax, rax\n"
                                  << "    call printf\n";
                     }
                 }
-                else if (tok.type == TokenType::KEYWORD) {
-                    static_assert(static_cast<int>(Keyword::COUNT) == 36,
-                                  "Exhaustive handling of keywords in GenerateAssembly_GAS_linux64");
-                    if (tok.text == GetKeywordStr(Keyword::IF)) {
-                        asm_file << "    # -- if --\n"
-                                 << "    pop %rax\n"
-                                 << "    cmp $0, %rax\n"
-                                 << "    je addr_" << tok.data << "\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::ELSE)) {
-                        asm_file << "    # -- else --\n"
-                                 << "    jmp addr_" << tok.data << "\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::ENDIF)) {
-                        asm_file << "    # -- endif --\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::WHILE)) {
-                        asm_file << "    # -- while --\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DO)) {
-                        asm_file << "    # -- do --\n"
-                                 << "    pop %rax\n"
-                                 << "    cmp $0, %rax\n"
-                                 << "    je addr_" << tok.data << "\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::ENDWHILE)) {
-                        asm_file << "    # -- endwhile --\n"
-                                 << "    jmp addr_" << tok.data << "\n"
-                                 << "addr_" << instr_ptr << ":\n";
-                    }
-                    
-                    else if (tok.text == GetKeywordStr(Keyword::DUP)) {
-                        asm_file << "    # -- dup --\n"
-                                 << "    pop %rax\n"
-                                 << "    push %rax\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::TWODUP)) {
-                        asm_file << "    # -- twodup --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    push %rbx\n"
-                                 << "    push %rax\n"
-                                 << "    push %rbx\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::DROP)) {
-                        asm_file << "    # -- drop --\n"
-                                 << "    pop %rax\n";
+
+                else if (tok.text == GetKeywordStr(Keyword::MEM)) {
+                    asm_file << "    ;; -- mem --\n"
+                             << (MemIsMapped(ctx) ? "    push qword [mem_ptr]\n" : "    push mem\n");
+                    // Pushes the relative address of allocated memory onto the stack
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADB)) {
+                    asm_file << "    ;; -- load byte --\n"
+                             << "    pop rax\n"
+                             << "    xor rbx, rbx\n"
+                             << "    mov bl, [rax]\n"
+                             << "    push rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STOREB)) {
+                    asm_file << "    ;; -- store byte --\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    mov [rax], bl\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADW)) {
+                    asm_file << "    ;; -- load word --\n"
+                             << "    pop rax\n"
+                             << "    xor rbx, rbx\n"
+                             << "    mov bx, [rax]\n"
+                             << "    push rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STOREW)) {
+                    asm_file << "    ;; -- store word --\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    mov [rax], bx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADD)) {
+                    asm_file << "    ;; -- load double word --\n"
+                             << "    pop rax\n"
+                             << "    xor rbx, rbx\n"
+                             << "    mov ebx, [rax]\n"
+                             << "    push rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STORED)) {
+                    asm_file << "    ;; -- store double word --\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    mov [rax], ebx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADQ)) {
+                    asm_file << "    ;; -- load quad word --\n"
+                             << "    pop rax\n"
+                             << "    xor rbx, rbx\n"
+                             << "    mov rbx, [rax]\n"
+                             << "    push rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STOREQ)) {
+                    asm_file << "    ;; -- store quad word --\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    mov [rax], rbx\n";
+                }
+                
+                else if (tok.text == GetKeywordStr(Keyword::SHL)) {
+                    WriteShift_NASM(ctx, true, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::SHR)) {
+                    WriteShift_NASM(ctx, false, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::OR)) {
+                    asm_file << "    ;; -- bitwise or --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    or rax, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::AND)) {
+                    asm_file << "    ;; -- bitwise and --\n"
+                             << "    pop rax\n"
+                             << "    pop rbx\n"
+                             << "    and rax, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MOD)) {
+                    asm_file << "    ;; -- modulo --\n"
+                             << "    xor rdx, rdx\n"
+                             << "    pop rbx\n"
+                             << "    pop rax\n"
+                             << "    div rbx\n"
+                             << "    push rdx\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::OPEN_FILE)) {
+                    asm_file << "    ;; -- open file and push pointer --\n"
+                             << "    pop rsi\n"
+                             << "    pop rdi\n"
+                             << "    call fopen\n"
+                             << "    push rax\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::WRITE_TO_FILE)) {
+                    asm_file << "    ;; -- write to file --\n"
+                             << "    pop rcx\n"
+                             << "    pop rdx\n"
+                             << "    pop rsi\n"
+                             << "    pop rdi\n"
+                             << "    call fwrite\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_FILE)) {
+                    asm_file << "    ;; -- read from file --\n"
+                             << "    pop rcx\n"
+                             << "    pop rdx\n"
+                             << "    pop rsi\n"
+                             << "    pop rdi\n"
+                             << "    mov rbx, rsp\n"
+                             << "    and rsp, -16\n";
+                    if (ctx.mem_grow) {
+                        asm_file << "    mov rax, rsi\n"
+                                 << "    imul rax, rdx\n"
+                                 << "    call mem_commit_range\n";
+                    }
+                    asm_file << "    call fread\n"
+                             << "    mov rsp, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_BLOCK)) {
+                    asm_file << "    ;; -- read block from file --\n"
+                             << "    pop rcx\n"
+                             << "    pop rdx\n"
+                             << "    pop rdi\n"
+                             << "    mov rsi, 1\n"
+                             << "    mov rax, " << ctx.READ_BLOCK_SIZE << '\n'
+                             << "    cmp rdx, rax\n"
+                             << "    cmova rdx, rax\n"
+                             << "    mov rbx, rsp\n"
+                             << "    and rsp, -16\n";
+                    if (ctx.mem_grow) {
+                        asm_file << "    mov rax, rdx\n"
+                                 << "    call mem_commit_range\n";
+                    }
+                    asm_file << "    call fread\n"
+                             << "    mov rsp, rbx\n"
+                             << "    push rax\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE)) {
+                    asm_file << "    ;; -- close file --\n"
+                             << "    pop rdi\n"
+                             << "    call fclose\n";
+                }
+                else if (IsBitManipulation(tok)) {
+                    WriteBitManipulation_NASM(ctx, tok, instr_ptr, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_FILL)
+                         || tok.text == GetKeywordStr(Keyword::MEM_COPY)
+                         || tok.text == GetKeywordStr(Keyword::MEM_COMPARE)
+                         || tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)
+                         || tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY)) {
+                    WriteBulkMemoryCall_NASM(tok, asm_file);
+                }
+				else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
+                    if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                        asm_file << "    ;; -- get length of string literal --\n"
+                                 << "    mov qword [rsp], " << KnownStringLength(*literal) << '\n';
                     }
-                    else if (tok.text == GetKeywordStr(Keyword::SWAP)) {
-                        asm_file << "    # -- swap --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    push %rax\n"
-                                 << "    push %rbx\n";
+                    else {
+                        asm_file << "    ;; -- get length of string --\n"
+                                 << "    pop rdi\n"
+                                 << "    call strlen\n"
+                                 << "    push rax\n";
                     }
-                    else if (tok.text == GetKeywordStr(Keyword::OVER)) {
-                        asm_file << "    # -- over --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    push %rbx\n"
-                                 << "    push %rax\n"
-                                 << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_GROW)) {
+                    asm_file << "    ;; -- mem_grow --\n";
+                    if (ctx.mem_grow) {
+                        asm_file << "    pop rdi\n"
+                                 << "    mov rbx, rsp\n"
+                                 << "    and rsp, -16\n"
+                                 << "    call mem_commit\n"
+                                 << "    mov rsp, rbx\n"
+                                 << "    push rax\n";
                     }
-                    else if (tok.text == GetKeywordStr(Keyword::DUMP)) {
-                        asm_file << "    # -- dump --\n"
-                                 << "    lea fmt(%rip), %rdi\n"
-                                 << "    pop %rsi\n"
-                                 << "    xor %rax, %rax\n"
-                                 << "    call printf\n";
+                    else {
+                        asm_file << "    pop rax\n"
+                                 << "    mov rbx, " << ctx.MEM_SIZE << '\n'
+                                 << "    xor rcx, rcx\n"
+                                 << "    cmp rax, rbx\n"
+                                 << "    setbe cl\n"
+                                 << "    push rcx\n";
                     }
-                    else if (tok.text == GetKeywordStr(Keyword::DUMP_C)) {
-                        asm_file << "    # -- dump --\n"
-                                 << "    lea fmt_char(%rip), %rdi\n"
-                                 << "    pop %rsi\n"
-                                 << "    xor %rax, %rax\n"
-                                 << "    call printf\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MAP_FILE)) {
+                    WriteMapFile_NASM_linux64(instr_ptr, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_READ)
+                         || tok.text == GetKeywordStr(Keyword::ASYNC_WRITE)) {
+                    bool read = tok.text == GetKeywordStr(Keyword::ASYNC_READ);
+                    asm_file << "    ;; -- submit asynchronous " << (read ? "read" : "write") << " --\n"
+                             << "    pop r8\n"
+                             << "    pop rcx\n"
+                             << "    pop rdx\n"
+                             << "    pop rsi\n"
+                             << "    mov rbx, rsp\n"
+                             << "    and rsp, -16\n";
+                    if (read && ctx.mem_grow) {
+                        asm_file << "    mov rdi, rsi\n"
+                                 << "    mov rax, rdx\n"
+                                 << "    call mem_commit_range\n";
+                    }
+                    asm_file << "    mov edi, " << (read ? IORING_OP_READ : IORING_OP_WRITE) << '\n'
+                             << "    call async_submit\n"
+                             << "    mov rsp, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_WAIT)) {
+                    asm_file << "    ;; -- wait for asynchronous request --\n"
+                             << "    pop rdi\n"
+                             << "    mov rbx, rsp\n"
+                             << "    and rsp, -16\n"
+                             << "    call async_wait\n"
+                             << "    mov rsp, rbx\n"
+                             << "    push rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::UNMAP_FILE)) {
+                    asm_file << "    ;; -- unmap file --\n"
+                             << "    pop rsi\n"
+                             << "    pop rdi\n"
+                             << "    mov rbx, rsp\n"
+                             << "    and rsp, -16\n"
+                             << "    call munmap\n"
+                             << "    mov rsp, rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MAP_ADVISE)) {
+                    asm_file << "    ;; -- advise kernel of access pattern --\n"
+                             << "    pop rdx\n"
+                             << "    pop rsi\n"
+                             << "    pop rdi\n"
+                             << "    mov rbx, rsp\n"
+                             << "    and rsp, -16\n"
+                             << "    call madvise\n"
+                             << "    mov rsp, rbx\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::WRITE)) {
+                    asm_file << "    ;; -- push pointer to write file mode constant --\n"
+                             << "    push write\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::WRITE_PLUS)) {
+                    asm_file << "    ;; -- push pointer to write/read file mode constant --\n"
+                             << "    push write_plus\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::APPEND)) {
+                    asm_file << "    ;; -- push pointer to append file mode constant --\n"
+                             << "    push append\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::APPEND_PLUS)) {
+                    asm_file << "    ;; -- push pointer to append/read file mode constant --\n"
+                             << "    push append_plus\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ)) {
+                    asm_file << "    ;; -- push pointer to read file mode constant --\n"
+                             << "    push read\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_PLUS)) {
+                    asm_file << "    ;; -- push pointer to read/write file mode constant --\n"
+                             << "    push read_plus\n";
+                }
+            }
+            instr_ptr++;
+        }
+        // The reports below are not the program's own code; samples taken in them count as outside of it.
+        if (ctx.sample) { asm_file << "sample_token_end:\n"; }
+        if (ctx.perfstat) { WritePerfStatReport_NASM_linux64(asm_file); }
+        if (ctx.memtrace) { WriteMemTraceDump_NASM_linux64(ctx, memtrace_sites.size(), asm_file); }
+        if (ctx.sample) { WriteSamplerDump_NASM_linux64(prog.tokens.size(), asm_file); }
+        if (ctx.profile) {
+            // A block that starts after the last token (i.e. just past `endwhile`)
+            if (StartsBasicBlock(prog, instr_ptr_max) && instr_ptr_max != 0) {
+                asm_file << "    inc qword [prof_counts + " << 8 * profile_blocks.size() << "]\n";
+                profile_blocks.push_back(instr_ptr_max);
+            }
+            WriteProfileDump_NASM_linux64(profile_blocks.size(), asm_file);
+        }
+
+        // WRITE ASM FOOTER (GRACEFUL PROGRAM EXIT, CONSTANTS)
+        asm_file << "    mov rdi, 0\n"
+                 << "    call exit\n";
+        if (UsesBulkMemory(prog)) { WriteBulkMemory_NASM(asm_file); }
+        if (UsesByteSearch(prog)) { WriteByteSearch_NASM(TargetHas(ctx, CPU_FEATURE::AVX2), asm_file); }
+        asm_file << '\n'
+                 << "    SECTION .data\n"
+                 << "    fmt db '%u', 0\n"
+                 << "    fmt_char db '%c', 0\n"
+                 << "    fmt_str db '%s', 0\n"
+				 << "    write db \"w\", 0\n"
+				 << "    append db \"a\", 0\n"
+				 << "    write_plus db \"w+\", 0\n"
+				 << "    append_plus db \"a+\", 0\n"
+				 << "    read db \"r\", 0\n"
+				 << "    read_plus db \"r+\", 0\n";
+
+        // WRITE USER DEFINED STRING CONSTANTS
+        WriteStringPool_NASM(ctx, prog, asm_file);
+
+        // ALLOCATE MEMORY
+        asm_file << '\n'
+                 << "    SECTION .bss\n";
+        if (MemIsMapped(ctx)) {
+            asm_file << "    mem_ptr resq 1\n";
+            if (ctx.mem_grow) {
+                asm_file << "    mem_committed resq 1\n"
+                         << "    mem_fault_sigaction resb " << SIGACTION_SIZE << '\n'
+                         << "    mem_fault_default resb " << SIGACTION_SIZE << '\n';
+            }
+            asm_file << "    SECTION .data\n"
+                     << "mem_map_error db " << NASMBytes("Could not map mem") << '\n';
+        }
+        else { asm_file << "    mem resb " << ctx.MEM_SIZE << '\n'; }
+        if (UsesAsyncIO(prog)) { WriteAsyncData_NASM_linux64(asm_file); }
+        if (ctx.profile) { WriteProfileData_NASM_linux64(ctx, prog, profile_blocks, asm_file); }
+        if (ctx.sample) { WriteSamplerData_NASM_linux64(ctx, prog, asm_file); }
+        if (ctx.perfstat) { WritePerfStatData_NASM_linux64(asm_file); }
+        if (ctx.memtrace) { WriteMemTraceData_NASM_linux64(ctx, prog, memtrace_sites, asm_file); }
+    }
+
+    bool GenerateAssembly_NASM_linux64(Context& ctx, Program& prog) {
+        PhaseTimer timer(ctx, "Codegen");
+        std::string asm_file_path = ctx.OUTPUT_NAME + ".asm";
+        std::fstream asm_file;
+        asm_file.open(asm_file_path.c_str(), std::ios::out);
+        if (asm_file) {
+            Log("Generating NASM elf64 assembly");
+            {
+                AsmStatsBuffer asm_stats(asm_file.rdbuf(), ctx.stats);
+                std::ostream counted_asm_file(&asm_stats);
+                WriteAssembly_NASM_linux64(ctx, prog, counted_asm_file);
+            }
+            asm_file.close();
+            Log("NASM elf64 assembly generated at " + asm_file_path);
+        }
+        else {
+            Error("Could not open " + asm_file_path + " for writing. Does directory exist?");
+            return false;
+        }
+        return true;
+    }
+
+    void WriteAssembly_GAS_linux64(Context& ctx, Program& prog, std::ostream& asm_file) {
+        // WRITE HEADER TO ASM FILE
+        asm_file << "    # CORTH COMPILER GENERATED THIS ASSEMBLY -- (BY LENSOR RADII)\n"
+                 << "    # USING `GAS` SYNTAX\n"
+                 << "    # USING `SYSTEM V AMD64 ABI` CALLING CONVENTION (RDI, RSI, RDX, RCX, R8, R9, -> STACK)\n"
+                 << "    # LINUX SYSTEM CALLS USE R10 INSTEAD OF RCX\n";
+        if (ctx.debug_info) {
+            // Source file for `.loc` line information; GAS generates the DWARF sections from it.
+            asm_file << "    .file 1 \"" << EscapeGASString(std::filesystem::absolute(ctx.SOURCE_PATH).string()) << "\"\n";
+        }
+        asm_file << "    .text\n"
+                 << "    .globl main\n"
+                 << "main:\n";
+        if (MemIsMapped(ctx)) { WriteMemMap_GAS_linux64(ctx, asm_file); }
+        if (ctx.mem_grow) { WriteMemGrowSetup_GAS_linux64(ctx, asm_file); }
+        if (UsesAsyncIO(prog)) { WriteAsyncSetup_GAS_linux64(asm_file); }
+        if (ctx.memtrace) { WriteMemTraceSetup_GAS_linux64(ctx, asm_file); }
+        if (ctx.sample) { WriteSamplerSetup_GAS_linux64(asm_file); }
+        if (ctx.perfstat) { WritePerfStatOpen_GAS_linux64(asm_file); }
+
+        // Token index at which every profiled basic block starts
+        std::vector<size_t> profile_blocks;
+        // Token index of every load and store traced with `-memtrace`
+        std::vector<size_t> memtrace_sites;
+
+        // WRITE TOKENS TO ASM FILE MAIN LABEL
+        static_assert(static_cast<int>(TokenType::COUNT) == 5,
+                      "Exhaustive handling of token types in WriteAssembly_GAS_linux64");
+        size_t instr_ptr = 0;
+        size_t instr_ptr_max = prog.tokens.size();
+        while (instr_ptr < instr_ptr_max) {
+            Token& tok = prog.tokens[instr_ptr];
+            if (ctx.sample) { asm_file << "sample_token_" << instr_ptr << ":\n"; }
+            if (ctx.debug_info) {
+                asm_file << "    .loc 1 " << tok.line_number << ' ' << tok.col_number << '\n';
+            }
+            if (ctx.profile && StartsBasicBlock(prog, instr_ptr)) {
+                asm_file << "    incq prof_counts+" << 8 * profile_blocks.size() << "(%rip)\n";
+                profile_blocks.push_back(instr_ptr);
+            }
+            if (ctx.memtrace && MemoryAccessSize(tok) != 0) {
+                WriteMemTraceAccess_GAS_linux64(ctx, tok, memtrace_sites.size(), asm_file);
+                memtrace_sites.push_back(instr_ptr);
+            }
+            // Write assembly to opened file based on token type and value
+            if (tok.type == TokenType::INT) {
+                asm_file << "    # -- push INT --\n"
+                         << "    mov $"  << tok.text << ", %rax" << "\n"
+                         << "    push %rax\n";
+            }
+            else if (tok.type == TokenType::STRING) {
+                asm_file << "    # -- push STRING --\n"
+                         << "    lea str_pool+" << tok.data << "(%rip), %rax\n"
+                         << "    push %rax\n";
+            }
+            else if (tok.type == TokenType::OP) {
+                static_assert(OP_COUNT == 15,
+                              "Exhaustive handling of operators in WriteAssembly_GAS_linux64");
+                if (tok.text == "+") {
+                    asm_file << "    # -- add --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    add %rbx, %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == "-") {
+                    asm_file << "    # -- subtract --\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    sub %rbx, %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == "*") {
+                    asm_file << "    # -- multiply --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    mul %rbx\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == "/") {
+                    asm_file << "    # -- divide --\n"
+                             << "    xor %rdx, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    div %rbx\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == "%") {
+                    asm_file << "    # -- modulo --\n"
+                             << "    xor %rdx, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    div %rbx\n"
+                             << "    push %rdx\n";
+                }
+                else if (tok.text == "=") {
+                    asm_file << "    # -- equality condition --\n"
+                             << "    mov $0, %rcx\n"
+                             << "    mov $1, %rdx\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    cmp %rbx, %rax\n"
+                             << "    cmove %rdx, %rcx\n"
+                             << "    push %rcx\n";
+                }
+                else if (tok.text == "<") {
+                    asm_file << "    # -- less than condition --\n"
+                             << "    mov $0, %rcx\n"
+                             << "    mov $1, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    cmp %rbx, %rax\n"
+                             << "    cmovl %rdx, %rcx\n"
+                             << "    push %rcx\n";
+                }
+                else if (tok.text == ">") {
+                    asm_file << "    # -- greater than condition --\n"
+                             << "    mov $0, %rcx\n"
+                             << "    mov $1, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    cmp %rbx, %rax\n"
+                             << "    cmovg %rdx, %rcx\n"
+                             << "    push %rcx\n";
+                }
+                else if (tok.text == "<=") {
+                    asm_file << "    # -- less than or equal condition --\n"
+                             << "    mov $0, %rcx\n"
+                             << "    mov $1, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    cmp %rbx, %rax\n"
+                             << "    cmovle %rdx, %rcx\n"
+                             << "    push %rcx\n";
+                }
+                else if (tok.text == ">=") {
+                    asm_file << "    # -- greater than or equal condition --\n"
+                             << "    mov $0, %rcx\n"
+                             << "    mov $1, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    cmp %rbx, %rax\n"
+                             << "    cmovge %rdx, %rcx\n"
+                             << "    push %rcx\n";
+                }
+                else if (tok.text == "<<") {
+                    WriteShift_GAS(ctx, true, asm_file);
+                }
+                else if (tok.text == ">>") {
+                    WriteShift_GAS(ctx, false, asm_file);
+                }
+                else if (tok.text == "||") {
+                    asm_file << "    # -- bitwise or --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    or %rbx, %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == "&&") {
+                    asm_file << "    # -- bitwise and --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    and %rbx, %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == "#") {
+                    asm_file << "    # -- dump --\n"
+                             << "    lea fmt(%rip), %rdi\n"
+                             << "    pop %rsi\n"
+                             << "    xor %rax, %rax\n"
+                             << "    call printf\n";
+                }
+            }
+            else if (tok.type == TokenType::KEYWORD) {
+                static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                              "Exhaustive handling of keywords in WriteAssembly_GAS_linux64");
+                if (tok.text == GetKeywordStr(Keyword::IF)) {
+                    asm_file << "    # -- if --\n"
+                             << "    pop %rax\n"
+                             << "    cmp $0, %rax\n"
+                             << "    je addr_" << tok.data << "\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ELSE)) {
+                    asm_file << "    # -- else --\n"
+                             << "    jmp addr_" << tok.data << "\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ENDIF)) {
+                    asm_file << "    # -- endif --\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::WHILE)) {
+                    asm_file << "    # -- while --\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DO)) {
+                    asm_file << "    # -- do --\n"
+                             << "    pop %rax\n"
+                             << "    cmp $0, %rax\n"
+                             << "    je addr_" << tok.data << "\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ENDWHILE)) {
+                    asm_file << "    # -- endwhile --\n"
+                             << "    jmp addr_" << tok.data << "\n"
+                             << "addr_" << instr_ptr << ":\n";
+                }
+                
+                else if (tok.text == GetKeywordStr(Keyword::DUP)) {
+                    asm_file << "    # -- dup --\n"
+                             << "    pop %rax\n"
+                             << "    push %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::TWODUP)) {
+                    asm_file << "    # -- twodup --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    push %rbx\n"
+                             << "    push %rax\n"
+                             << "    push %rbx\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DROP)) {
+                    asm_file << "    # -- drop --\n"
+                             << "    pop %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::SWAP)) {
+                    asm_file << "    # -- swap --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    push %rax\n"
+                             << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::OVER)) {
+                    asm_file << "    # -- over --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    push %rbx\n"
+                             << "    push %rax\n"
+                             << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP)) {
+                    asm_file << "    # -- dump --\n"
+                             << "    lea fmt(%rip), %rdi\n"
+                             << "    pop %rsi\n"
+                             << "    xor %rax, %rax\n"
+                             << "    call printf\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP_C)) {
+                    asm_file << "    # -- dump --\n"
+                             << "    lea fmt_char(%rip), %rdi\n"
+                             << "    pop %rsi\n"
+                             << "    xor %rax, %rax\n"
+                             << "    call printf\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP_S)) {
+                    if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                        // fwrite(literal, 1, length, stdout)
+                        asm_file << "    # -- dump string literal --\n"
+                                 << "    pop %rdi\n"
+                                 << "    mov $1, %rsi\n"
+                                 << "    mov $" << KnownStringLength(*literal) << ", %rdx\n"
+                                 << "    mov stdout@GOTPCREL(%rip), %rcx\n"
+                                 << "    mov (%rcx), %rcx\n"
+                                 << "    mov %rsp, %rbx\n"
+                                 << "    and $-16, %rsp\n"
+                                 << "    call fwrite\n"
+                                 << "    mov %rbx, %rsp\n";
                     }
-                    else if (tok.text == GetKeywordStr(Keyword::DUMP_S)) {
+                    else {
                         asm_file << "    # -- dump --\n"
                                  << "    lea fmt_str(%rip), %rdi\n"
                                  << "    pop %rsi\n"
                                  << "    xor %rax, %rax\n"
                                  << "    call printf\n";
                     }
+                }
 
-                    else if (tok.text == GetKeywordStr(Keyword::MEM)) {
-                        asm_file << "    # -- mem --\n"
-                                 << "    lea mem(%rip), %rax\n"
-                                 << "    push %rax\n";
-                        // Pushes the relative address of allocated memory onto the stack
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADB)) {
-                        asm_file << "    # -- load byte --\n"
-                                 << "    pop %rax\n"
-                                 << "    xor %rbx, %rbx\n"
-                                 << "    mov (%rax), %bl\n"
-                                 << "    push %rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STOREB)) {
-                        asm_file << "    # -- store byte --\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    mov %bl, (%rax)\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADW)) {
-                        asm_file << "    # -- load word --\n"
-                                 << "    pop %rax\n"
-                                 << "    xor %rbx, %rbx\n"
-                                 << "    mov (%rax), %bx\n"
-                                 << "    push %rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STOREW)) {
-                        asm_file << "    # -- store word --\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    mov %bx, (%rax)\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADD)) {
-                        asm_file << "    # -- load double word --\n"
-                                 << "    pop %rax\n"
-                                 << "    xor %rbx, %rbx\n"
-                                 << "    mov (%rax), %ebx\n"
-                                 << "    push %rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STORED)) {
-                        asm_file << "    # -- store double word --\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    mov %ebx, (%rax)\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::LOADQ)) {
-                        asm_file << "    # -- load quad word --\n"
-                                 << "    pop %rax\n"
-                                 << "    xor %rbx, %rbx\n"
-                                 << "    mov (%rax), %rbx\n"
-                                 << "    push %rbx\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::STOREQ)) {
-                        asm_file << "    # -- store quad word --\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    mov %rbx, (%rax)\n";
-                    }
-                    
-                    else if (tok.text == GetKeywordStr(Keyword::SHL)) {
-                        asm_file << "    # -- bitwise-shift left --\n"
-                                 << "    pop %rcx\n"
-                                 << "    pop %rbx\n"
-                                 << "    shl %cl, %rbx\n"
-                                 << "    push %rbx";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::SHR)) {
-                        asm_file << "    # -- bitwise-shift right --\n"
-                                 << "    pop %rcx\n"
-                                 << "    pop %rbx\n"
-                                 << "    shr %cl %rbx\n"
-                                 << "    push %rbx";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::OR)) {
-                        asm_file << "    # -- bitwise or --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    or %rbx, %rax\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::AND)) {
-                        asm_file << "    # -- bitwise and --\n"
-                                 << "    pop %rax\n"
-                                 << "    pop %rbx\n"
-                                 << "    and %rbx, %rax\n"
-                                 << "    push %rax\n";
-                    }
-                    else if (tok.text == GetKeywordStr(Keyword::MOD)) {
-                        asm_file << "    # -- modulo --\n"
-                                 << "    xor %rdx, %rdx\n"
-                                 << "    pop %rbx\n"
-                                 << "    pop %rax\n"
-                                 << "    div %rbx\n"
-                                 << "    push %rdx\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::OPEN_FILE)) {
-                        asm_file << "    # -- open file and push pointer --\n"
-                                 << "    pop %rsi\n"
-                                 << "    pop %rdi\n"
-                                 << "    call fopen\n"
-                                 << "    push %rax\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::WRITE_TO_FILE)) {
-                        asm_file << "    # -- write to file --\n"
-                                 << "    pop %rcx\n"
-                                 << "    pop %rdx\n"
-                                 << "    pop %rsi\n"
-                                 << "    pop %rdi\n"
-                                 << "    call fwrite\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE)) {
-                        asm_file << "    # -- close file --\n"
-                                 << "    pop %rdi\n"
-                                 << "    call fclose\n";
+                else if (tok.text == GetKeywordStr(Keyword::MEM)) {
+                    asm_file << "    # -- mem --\n"
+                             << (MemIsMapped(ctx) ? "    mov mem_ptr(%rip), %rax\n" : "    lea mem(%rip), %rax\n")
+                             << "    push %rax\n";
+                    // Pushes the relative address of allocated memory onto the stack
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADB)) {
+                    asm_file << "    # -- load byte --\n"
+                             << "    pop %rax\n"
+                             << "    xor %rbx, %rbx\n"
+                             << "    mov (%rax), %bl\n"
+                             << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STOREB)) {
+                    asm_file << "    # -- store byte --\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    mov %bl, (%rax)\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADW)) {
+                    asm_file << "    # -- load word --\n"
+                             << "    pop %rax\n"
+                             << "    xor %rbx, %rbx\n"
+                             << "    mov (%rax), %bx\n"
+                             << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STOREW)) {
+                    asm_file << "    # -- store word --\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    mov %bx, (%rax)\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADD)) {
+                    asm_file << "    # -- load double word --\n"
+                             << "    pop %rax\n"
+                             << "    xor %rbx, %rbx\n"
+                             << "    mov (%rax), %ebx\n"
+                             << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STORED)) {
+                    asm_file << "    # -- store double word --\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    mov %ebx, (%rax)\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::LOADQ)) {
+                    asm_file << "    # -- load quad word --\n"
+                             << "    pop %rax\n"
+                             << "    xor %rbx, %rbx\n"
+                             << "    mov (%rax), %rbx\n"
+                             << "    push %rbx\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::STOREQ)) {
+                    asm_file << "    # -- store quad word --\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    mov %rbx, (%rax)\n";
+                }
+                
+                else if (tok.text == GetKeywordStr(Keyword::SHL)) {
+                    WriteShift_GAS(ctx, true, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::SHR)) {
+                    WriteShift_GAS(ctx, false, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::OR)) {
+                    asm_file << "    # -- bitwise or --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    or %rbx, %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::AND)) {
+                    asm_file << "    # -- bitwise and --\n"
+                             << "    pop %rax\n"
+                             << "    pop %rbx\n"
+                             << "    and %rbx, %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MOD)) {
+                    asm_file << "    # -- modulo --\n"
+                             << "    xor %rdx, %rdx\n"
+                             << "    pop %rbx\n"
+                             << "    pop %rax\n"
+                             << "    div %rbx\n"
+                             << "    push %rdx\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::OPEN_FILE)) {
+                    asm_file << "    # -- open file and push pointer --\n"
+                             << "    pop %rsi\n"
+                             << "    pop %rdi\n"
+                             << "    call fopen\n"
+                             << "    push %rax\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::WRITE_TO_FILE)) {
+                    asm_file << "    # -- write to file --\n"
+                             << "    pop %rcx\n"
+                             << "    pop %rdx\n"
+                             << "    pop %rsi\n"
+                             << "    pop %rdi\n"
+                             << "    call fwrite\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_FILE)) {
+                    asm_file << "    # -- read from file --\n"
+                             << "    pop %rcx\n"
+                             << "    pop %rdx\n"
+                             << "    pop %rsi\n"
+                             << "    pop %rdi\n"
+                             << "    mov %rsp, %rbx\n"
+                             << "    and $-16, %rsp\n";
+                    if (ctx.mem_grow) {
+                        asm_file << "    mov %rsi, %rax\n"
+                                 << "    imul %rdx, %rax\n"
+                                 << "    call mem_commit_range\n";
+                    }
+                    asm_file << "    call fread\n"
+                             << "    mov %rbx, %rsp\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_BLOCK)) {
+                    asm_file << "    # -- read block from file --\n"
+                             << "    pop %rcx\n"
+                             << "    pop %rdx\n"
+                             << "    pop %rdi\n"
+                             << "    mov $1, %rsi\n"
+                             << "    mov $" << ctx.READ_BLOCK_SIZE << ", %rax\n"
+                             << "    cmp %rax, %rdx\n"
+                             << "    cmova %rax, %rdx\n"
+                             << "    mov %rsp, %rbx\n"
+                             << "    and $-16, %rsp\n";
+                    if (ctx.mem_grow) {
+                        asm_file << "    mov %rdx, %rax\n"
+                                 << "    call mem_commit_range\n";
+                    }
+                    asm_file << "    call fread\n"
+                             << "    mov %rbx, %rsp\n"
+                             << "    push %rax\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE)) {
+                    asm_file << "    # -- close file --\n"
+                             << "    pop %rdi\n"
+                             << "    call fclose\n";
+                }
+                else if (IsBitManipulation(tok)) {
+                    WriteBitManipulation_GAS(ctx, tok, instr_ptr, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_FILL)
+                         || tok.text == GetKeywordStr(Keyword::MEM_COPY)
+                         || tok.text == GetKeywordStr(Keyword::MEM_COMPARE)
+                         || tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)
+                         || tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY)) {
+                    WriteBulkMemoryCall_GAS(tok, asm_file);
+                }
+				else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
+                    if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                        asm_file << "    # -- get length of string literal --\n"
+                                 << "    movq $" << KnownStringLength(*literal) << ", (%rsp)\n";
                     }
-					else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
+                    else {
                         asm_file << "    # -- get length of string --\n"
                                  << "    pop %rdi\n"
                                  << "    call strlen\n"
                                  << "    push %rax\n";
                     }
-					else if (tok.text == GetKeywordStr(Keyword::WRITE)) {
-                        asm_file << "    # -- push pointer to write file mode constant --\n"
-                                 << "    lea write(%rip), %rax\n"
-                                 << "    push %rax\n";
-                    }
-					else if (tok.text == GetKeywordStr(Keyword::WRITE_PLUS)) {
-                        asm_file << "    # -- push pointer to write/read file mode constant --\n"
-								 << "    lea write_plus(%rip), %rax\n"
-                                 << "    push %rax\n";
-                    }
-				    else if (tok.text == GetKeywordStr(Keyword::APPEND)) {
-                        asm_file << "    # -- push pointer to append file mode constant --\n"
-                                 << "    lea append(%rip), %rax\n"
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_GROW)) {
+                    asm_file << "    # -- mem_grow --\n";
+                    if (ctx.mem_grow) {
+                        asm_file << "    pop %rdi\n"
+                                 << "    mov %rsp, %rbx\n"
+                                 << "    and $-16, %rsp\n"
+                                 << "    call mem_commit\n"
+                                 << "    mov %rbx, %rsp\n"
                                  << "    push %rax\n";
                     }
-					else if (tok.text == GetKeywordStr(Keyword::APPEND_PLUS)) {
-                        asm_file << "    # -- push pointer to append/read file mode constant --\n"
-								 << "    lea append_plus(%rip), %rax\n"
-                                 << "    push %rax\n";
+                    else {
+                        asm_file << "    pop %rax\n"
+                                 << "    mov $" << ctx.MEM_SIZE << ", %rbx\n"
+                                 << "    xor %rcx, %rcx\n"
+                                 << "    cmp %rbx, %rax\n"
+                                 << "    setbe %cl\n"
+                                 << "    push %rcx\n";
                     }
                 }
-                instr_ptr++;
+                else if (tok.text == GetKeywordStr(Keyword::MAP_FILE)) {
+                    WriteMapFile_GAS_linux64(instr_ptr, asm_file);
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_READ)
+                         || tok.text == GetKeywordStr(Keyword::ASYNC_WRITE)) {
+                    bool read = tok.text == GetKeywordStr(Keyword::ASYNC_READ);
+                    asm_file << "    # -- submit asynchronous " << (read ? "read" : "write") << " --\n"
+                             << "    pop %r8\n"
+                             << "    pop %rcx\n"
+                             << "    pop %rdx\n"
+                             << "    pop %rsi\n"
+                             << "    mov %rsp, %rbx\n"
+                             << "    and $-16, %rsp\n";
+                    if (read && ctx.mem_grow) {
+                        asm_file << "    mov %rsi, %rdi\n"
+                                 << "    mov %rdx, %rax\n"
+                                 << "    call mem_commit_range\n";
+                    }
+                    asm_file << "    mov $" << (read ? IORING_OP_READ : IORING_OP_WRITE) << ", %edi\n"
+                             << "    call async_submit\n"
+                             << "    mov %rbx, %rsp\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_WAIT)) {
+                    asm_file << "    # -- wait for asynchronous request --\n"
+                             << "    pop %rdi\n"
+                             << "    mov %rsp, %rbx\n"
+                             << "    and $-16, %rsp\n"
+                             << "    call async_wait\n"
+                             << "    mov %rbx, %rsp\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::UNMAP_FILE)) {
+                    asm_file << "    # -- unmap file --\n"
+                             << "    pop %rsi\n"
+                             << "    pop %rdi\n"
+                             << "    mov %rsp, %rbx\n"
+                             << "    and $-16, %rsp\n"
+                             << "    call munmap\n"
+                             << "    mov %rbx, %rsp\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MAP_ADVISE)) {
+                    asm_file << "    # -- advise kernel of access pattern --\n"
+                             << "    pop %rdx\n"
+                             << "    pop %rsi\n"
+                             << "    pop %rdi\n"
+                             << "    mov %rsp, %rbx\n"
+                             << "    and $-16, %rsp\n"
+                             << "    call madvise\n"
+                             << "    mov %rbx, %rsp\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::WRITE)) {
+                    asm_file << "    # -- push pointer to write file mode constant --\n"
+                             << "    lea write(%rip), %rax\n"
+                             << "    push %rax\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::WRITE_PLUS)) {
+                    asm_file << "    # -- push pointer to write/read file mode constant --\n"
+							 << "    lea write_plus(%rip), %rax\n"
+                             << "    push %rax\n";
+                }
+			    else if (tok.text == GetKeywordStr(Keyword::APPEND)) {
+                    asm_file << "    # -- push pointer to append file mode constant --\n"
+                             << "    lea append(%rip), %rax\n"
+                             << "    push %rax\n";
+                }
+				else if (tok.text == GetKeywordStr(Keyword::APPEND_PLUS)) {
+                    asm_file << "    # -- push pointer to append/read file mode constant --\n"
+							 << "    lea append_plus(%rip), %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ)) {
+                    asm_file << "    # -- push pointer to read file mode constant --\n"
+                             << "    lea read(%rip), %rax\n"
+                             << "    push %rax\n";
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_PLUS)) {
+                    asm_file << "    # -- push pointer to read/write file mode constant --\n"
+                             << "    lea read_plus(%rip), %rax\n"
+                             << "    push %rax\n";
+                }
             }
-            
-            // WRITE ASM FOOTER (GRACEFUL PROGRAM EXIT, CONSTANTS)
-            asm_file << "    mov $0, %rdi\n"
-                     << "    call exit\n"
-                     << '\n'
-                     << "    .data\n"
-                     << "    fmt: .string \"%u\"\n"
-                     << "    fmt_char: .string \"%c\"\n"
-                     << "    fmt_str: .string \"%s\"\n"
-					 << "    write: .string \"w\"\n"
-					 << "    append: .string \"a\"\n"
-					 << "    write_plus: .string \"w+\"\n"
-					 << "    append_plus: .string \"a+\"\n";
+            instr_ptr++;
+        }
+        // The reports below are not the program's own code; samples taken in them count as outside of it.
+        if (ctx.sample) { asm_file << "sample_token_end:\n"; }
+        if (ctx.perfstat) { WritePerfStatReport_GAS_linux64(asm_file); }
+        if (ctx.memtrace) { WriteMemTraceDump_GAS_linux64(ctx, memtrace_sites.size(), asm_file); }
+        if (ctx.sample) { WriteSamplerDump_GAS_linux64(prog.tokens.size(), asm_file); }
+        if (ctx.profile) {
+            // A block that starts after the last token (i.e. just past `endwhile`)
+            if (StartsBasicBlock(prog, instr_ptr_max) && instr_ptr_max != 0) {
+                asm_file << "    incq prof_counts+" << 8 * profile_blocks.size() << "(%rip)\n";
+                profile_blocks.push_back(instr_ptr_max);
+            }
+            WriteProfileDump_GAS_linux64(profile_blocks.size(), asm_file);
+        }
+
+        // WRITE ASM FOOTER (GRACEFUL PROGRAM EXIT, CONSTANTS)
+        asm_file << "    mov $0, %rdi\n"
+                 << "    call exit\n";
+        if (UsesBulkMemory(prog)) { WriteBulkMemory_GAS(asm_file); }
+        if (UsesByteSearch(prog)) { WriteByteSearch_GAS(TargetHas(ctx, CPU_FEATURE::AVX2), asm_file); }
+        asm_file << '\n'
+                 << "    .data\n"
+                 << "    fmt: .string \"%u\"\n"
+                 << "    fmt_char: .string \"%c\"\n"
+                 << "    fmt_str: .string \"%s\"\n"
+				 << "    write: .string \"w\"\n"
+				 << "    append: .string \"a\"\n"
+				 << "    write_plus: .string \"w+\"\n"
+				 << "    append_plus: .string \"a+\"\n"
+				 << "    read: .string \"r\"\n"
+				 << "    read_plus: .string \"r+\"\n";
+
+        // WRITE USER DEFINED STRING CONSTANTS
+        if (!prog.string_pool.empty()) { asm_file << "\n    # USER DEFINED STRINGS\n"; }
+        WriteStringPool_GAS(ctx, prog, asm_file);
 
-            // WRITE USER DEFINED STRING CONSTANTS
-            size_t index = 0;
-            if (string_literals.size() > 0) { asm_file << "\n    # USER DEFINED STRINGS\n"; }
-            for (auto& string : string_literals) {
-                asm_file << "str_" << index << ": .string \"" << string << "\"\n";
-                index++;
+        // ALLOCATE MEMORY
+        asm_file << '\n'
+                 << "    .bss\n";
+        if (MemIsMapped(ctx)) {
+            asm_file << "    .comm mem_ptr, 8, 8\n";
+            if (ctx.mem_grow) {
+                asm_file << "    .comm mem_committed, 8, 8\n"
+                         << "    .comm mem_fault_sigaction, " << SIGACTION_SIZE << ", 8\n"
+                         << "    .comm mem_fault_default, " << SIGACTION_SIZE << ", 8\n";
             }
+            asm_file << "    .data\n"
+                     << "mem_map_error: .string \"Could not map mem\"\n";
+        }
+        else { asm_file << "    .comm mem, " << ctx.MEM_SIZE << '\n'; }
+        if (UsesAsyncIO(prog)) { WriteAsyncData_GAS_linux64(asm_file); }
+        if (ctx.profile) { WriteProfileData_GAS_linux64(ctx, prog, profile_blocks, asm_file); }
+        if (ctx.sample) { WriteSamplerData_GAS_linux64(ctx, prog, asm_file); }
+        if (ctx.perfstat) { WritePerfStatData_GAS_linux64(asm_file); }
+        if (ctx.memtrace) { WriteMemTraceData_GAS_linux64(ctx, prog, memtrace_sites, asm_file); }
+    }
 
-            // ALLOCATE MEMORY
-            asm_file << '\n'
-                     << "    .bss\n"
-                     << "    .comm mem, " << MEM_CAPACITY << '\n';
-            
+    bool GenerateAssembly_GAS_linux64(Context& ctx, Program& prog) {
+        PhaseTimer timer(ctx, "Codegen");
+        std::string asm_file_path = ctx.OUTPUT_NAME + ".s";
+        std::fstream asm_file;
+        asm_file.open(asm_file_path.c_str(), std::ios::out);
+        if (asm_file) {
+            Log("Generating Linux x64 GAS assembly");
+            {
+                AsmStatsBuffer asm_stats(asm_file.rdbuf(), ctx.stats);
+                std::ostream counted_asm_file(&asm_stats);
+                WriteAssembly_GAS_linux64(ctx, prog, counted_asm_file);
+            }
             asm_file.close();
-                
             Log("Linux x64 GAS assembly generated at " + asm_file_path);
         }
         else {
-            Error("Could not open file for writing. Does directory exist?");
-            exit(1);
+            Error("Could not open " + asm_file_path + " for writing. Does directory exist?");
+            return false;
         }
+        return true;
     }
 
-    void GenerateAssembly_NASM_mac64(Program& prog) {
-        std::string asm_file_path = OUTPUT_NAME + ".asm";
+    bool GenerateAssembly_NASM_mac64(Context& ctx, Program& prog) {
+        std::string asm_file_path = ctx.OUTPUT_NAME + ".asm";
         std::fstream asm_file;
         asm_file.open(asm_file_path.c_str(), std::ios::out);
         if (asm_file) {
@@ -1247,25 +5113,28 @@ namespace Corth {
 					 << "    write db \"w\", 0\n"
 					 << "    append db \"a\", 0\n"
 					 << "    write_plus db \"w+\", 0\n"
-					 << "    append_plus db \"a+\", 0\n";
+					 << "    append_plus db \"a+\", 0\n"
+					 << "    read db \"r\", 0\n"
+					 << "    read_plus db \"r+\", 0\n";
         }
         else {
-            Error("Could not open file for writing. Does directory exist?");
-            exit(1);
+            Error("Could not open " + asm_file_path + " for writing. Does directory exist?");
+            return false;
         }
+        return true;
     }
 
-    void GenerateAssembly_NASM_win64(Program& prog) {
+    bool GenerateAssembly_NASM_win64(Context& ctx, Program& prog) {
+        PhaseTimer timer(ctx, "Codegen");
         // Loop through a lexed program and then generate assembly file from it.
-        std::string asm_file_path = OUTPUT_NAME + ".asm";
-        std::fstream asm_file;
-        asm_file.open(asm_file_path.c_str(), std::ios::out);
-        if (asm_file) {
+        std::string asm_file_path = ctx.OUTPUT_NAME + ".asm";
+        std::fstream asm_output;
+        asm_output.open(asm_file_path.c_str(), std::ios::out);
+        if (asm_output) {
+            AsmStatsBuffer asm_stats(asm_output.rdbuf(), ctx.stats);
+            std::ostream asm_file(&asm_stats);
             Log("Generating NASM win64 assembly");
 
-            // String constants
-            std::vector<std::string> string_literals;
-            
             // WRITE HEADER TO ASM FILE
             asm_file << "    ;; CORTH COMPILER GENERATED THIS ASSEMBLY -- (BY LENSOR RADII)\n"
                      << "    ;; USING `WINDOWS x64` CALLING CONVENTION (RCX, RDX, R8, R9, ETC)\n"
@@ -1274,6 +5143,7 @@ namespace Corth {
                      << "    extern printf\n"
                      << "    extern fopen\n"
                      << "    extern fwrite\n"
+                     << "    extern fread\n"
                      << "    extern fclose\n"
                      << "    extern strlen\n"
                      << "    extern exit\n"
@@ -1295,9 +5165,8 @@ namespace Corth {
                 }
                 else if (tok.type == TokenType::STRING) {
                     asm_file << "    ;; -- push STRING --\n"
-                             << "    mov rax, str_" << string_literals.size() << '\n'
+                             << "    mov rax, str_pool + " << tok.data << '\n'
                              << "    push rax\n";
-                    string_literals.push_back(tok.text);
                 }
                 else if (tok.type == TokenType::OP) {
                     static_assert(OP_COUNT == 15,
@@ -1394,14 +5263,14 @@ namespace Corth {
                                  << "    pop rcx\n"
                                  << "    pop rbx\n"
                                  << "    shl rbx, cl\n"
-                                 << "    push rbx";
+                                 << "    push rbx\n";
                     }
                     else if (tok.text == ">>") {
                         asm_file << "    ;; -- bitwise-shift right --\n"
                                  << "    pop rcx\n"
                                  << "    pop rbx\n"
                                  << "    shr rbx, cl\n"
-                                 << "    push rbx";
+                                 << "    push rbx\n";
                     }
                     else if (tok.text == "||") {
                         asm_file << "    ;; -- bitwise or --\n"
@@ -1434,7 +5303,7 @@ namespace Corth {
                     }
                 }
                 else if (tok.type == TokenType::KEYWORD) {
-                    static_assert(static_cast<int>(Keyword::COUNT) == 36,
+                    static_assert(static_cast<int>(Keyword::COUNT) == 60,
                                   "Exhaustive handling of keywords in GenerateAssembly_NASM_win64");
                     if (tok.text == GetKeywordStr(Keyword::IF)) {
                         asm_file << "    ;; -- if --\n"
@@ -1593,14 +5462,14 @@ namespace Corth {
                                  << "    pop rcx\n"
                                  << "    pop rbx\n"
                                  << "    shl rbx, cl\n"
-                                 << "    push rbx";
+                                 << "    push rbx\n";
                     }
                     else if (tok.text == GetKeywordStr(Keyword::SHR)) {
                         asm_file << "    ;; -- bitwise-shift right --\n"
                                  << "    pop rcx\n"
                                  << "    pop rbx\n"
                                  << "    shr rbx, cl\n"
-                                 << "    push rbx";
+                                 << "    push rbx\n";
                     }
                     else if (tok.text == GetKeywordStr(Keyword::OR)) {
                         asm_file << "    ;; -- bitwise or --\n"
@@ -1642,6 +5511,31 @@ namespace Corth {
 								 << "    sub rsp, 64\n"
                                  << "    call fwrite\n"
 								 << "    add rsp, 64\n";
+                    }
+					else if (tok.text == GetKeywordStr(Keyword::READ_FILE)) {
+                        asm_file << "    ;; -- read from file --\n"
+                                 << "    pop r9\n"
+                                 << "    pop r8\n"
+                                 << "    pop rdx\n"
+                                 << "    pop rcx\n"
+								 << "    sub rsp, 64\n"
+                                 << "    call fread\n"
+								 << "    add rsp, 64\n"
+                                 << "    push rax\n";
+                    }
+					else if (tok.text == GetKeywordStr(Keyword::READ_BLOCK)) {
+                        asm_file << "    ;; -- read block from file --\n"
+                                 << "    pop r9\n"
+                                 << "    pop r8\n"
+                                 << "    pop rcx\n"
+                                 << "    mov rdx, 1\n"
+                                 << "    mov rax, " << ctx.READ_BLOCK_SIZE << '\n'
+                                 << "    cmp r8, rax\n"
+                                 << "    cmova r8, rax\n"
+								 << "    sub rsp, 64\n"
+                                 << "    call fread\n"
+								 << "    add rsp, 64\n"
+                                 << "    push rax\n";
                     }
 					else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE)) {
                         asm_file << "    ;; -- close file --\n"
@@ -1649,14 +5543,40 @@ namespace Corth {
 								 << "    sub rsp, 64\n"
                                  << "    call fclose\n"
 								 << "    add rsp, 64\n";
+                    }
+                    else if (IsBitManipulation(tok)) {
+                        WriteBitManipulation_NASM(ctx, tok, instr_ptr, asm_file);
+                    }
+                    else if (tok.text == GetKeywordStr(Keyword::MEM_FILL)
+                             || tok.text == GetKeywordStr(Keyword::MEM_COPY)
+                             || tok.text == GetKeywordStr(Keyword::MEM_COMPARE)
+                             || tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)
+                             || tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY)) {
+                        WriteBulkMemoryCall_NASM(tok, asm_file);
                     }
 					else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
-                        asm_file << "    ;; -- get length of string --\n"
-                                 << "    pop rcx\n"
-								 << "    sub rsp, 64\n"
-                                 << "    call strlen\n"
-								 << "    add rsp, 64\n"
-                                 << "    push rax\n";
+                        if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                            asm_file << "    ;; -- get length of string literal --\n"
+                                     << "    mov qword [rsp], " << KnownStringLength(*literal) << '\n';
+                        }
+                        else {
+                            asm_file << "    ;; -- get length of string --\n"
+                                     << "    pop rcx\n"
+                                     << "    sub rsp, 64\n"
+                                     << "    call strlen\n"
+                                     << "    add rsp, 64\n"
+                                     << "    push rax\n";
+                        }
+                    }
+                    else if (tok.text == GetKeywordStr(Keyword::MEM_GROW)) {
+                        // `mem` can't grow on Windows; only report whether it's big enough.
+                        asm_file << "    ;; -- mem_grow --\n"
+                                 << "    pop rax\n"
+                                 << "    mov rbx, " << ctx.MEM_SIZE << '\n'
+                                 << "    xor rcx, rcx\n"
+                                 << "    cmp rax, rbx\n"
+                                 << "    setbe cl\n"
+                                 << "    push rcx\n";
                     }
 					else if (tok.text == GetKeywordStr(Keyword::WRITE)) {
                         asm_file << "    ;; -- push pointer to write file mode constant --\n"
@@ -1674,12 +5594,23 @@ namespace Corth {
                         asm_file << "    ;; -- push pointer to append/read file mode constant --\n"
                                  << "    push append_plus\n";
                     }
+                    else if (tok.text == GetKeywordStr(Keyword::READ)) {
+                        asm_file << "    ;; -- push pointer to read file mode constant --\n"
+                                 << "    push read\n";
+                    }
+                    else if (tok.text == GetKeywordStr(Keyword::READ_PLUS)) {
+                        asm_file << "    ;; -- push pointer to read/write file mode constant --\n"
+                                 << "    push read_plus\n";
+                    }
                 }
                 instr_ptr++;
             }
             // EXIT GRACEFUL
             asm_file << "    mov rcx, 0\n"
-                     << "    call exit\n\n";
+                     << "    call exit\n";
+            if (UsesBulkMemory(prog)) { WriteBulkMemory_NASM(asm_file); }
+            if (UsesByteSearch(prog)) { WriteByteSearch_NASM(false, asm_file); }
+            asm_file << '\n';
 
             // DECLARE CORTH CONSTANTS
             asm_file << "    SECTION .data\n"
@@ -1689,45 +5620,39 @@ namespace Corth {
 					 << "    write db \"w\", 0\n"
 					 << "    append db \"a\", 0\n"
 					 << "    write_plus db \"w+\", 0\n"
-					 << "    append_plus db \"a+\", 0\n";
+					 << "    append_plus db \"a+\", 0\n"
+					 << "    read db \"r\", 0\n"
+					 << "    read_plus db \"r+\", 0\n";
 
             // DECLARE USER-DEFINED STRING CONSTANTS HERE
-            size_t index = 0;
-            for (auto& string : string_literals) {
-                std::vector<std::string> hex_chars = string_to_hex(string);
-                asm_file << "str_" << index << " db ";
-                for (auto& c : hex_chars) {
-                    asm_file << c << ',';
-                }
-                // Null-terminator
-                asm_file << "0\n";
-                index++;
-            }
+            WriteStringPool_NASM(ctx, prog, asm_file);
 
             // ALLOCATE MEMORY
             asm_file << "\n"
                      << "    SECTION .bss\n"
-                     << "    mem resb " << MEM_CAPACITY << "\n";
+                     << "    mem resb " << ctx.MEM_SIZE << "\n";
 
-            asm_file.close();
+            asm_file.flush();
+            asm_output.close();
             Log("NASM win64 assembly generated at " + asm_file_path);
         }
         else {
-            Error("Could not open file for writing. Does directory exist?");
-            exit(1);
+            Error("Could not open " + asm_file_path + " for writing. Does directory exist?");
+            return false;
         }
+        return true;
     }
 
-    void GenerateAssembly_GAS_win64(Program& prog) {
-        std::string asm_file_path = OUTPUT_NAME + ".s";
-        std::fstream asm_file;
-        asm_file.open(asm_file_path.c_str(), std::ios::out);
-        if (asm_file) {
+    bool GenerateAssembly_GAS_win64(Context& ctx, Program& prog) {
+        PhaseTimer timer(ctx, "Codegen");
+        std::string asm_file_path = ctx.OUTPUT_NAME + ".s";
+        std::fstream asm_output;
+        asm_output.open(asm_file_path.c_str(), std::ios::out);
+        if (asm_output) {
+            AsmStatsBuffer asm_stats(asm_output.rdbuf(), ctx.stats);
+            std::ostream asm_file(&asm_stats);
             Log("Generating WIN64 GAS assembly");
 
-            // Save list of defined strings in file to write at the end of the assembly in the `.data` section.
-            std::vector<std::string> string_literals;
-
             // WRITE HEADER TO ASM FILE
             asm_file << "    # CORTH COMPILER GENERATED THIS ASSEMBLY -- (BY LENSOR RADII)\n"
                      << "    # USING `GAS` SYNTAX\n"
@@ -1751,10 +5676,8 @@ namespace Corth {
                 }
                 else if (tok.type == TokenType::STRING) {
                     asm_file << "    # -- push STRING --\n"
-                             << "    lea str_" << string_literals.size() << "(%rip), %rax\n"
+                             << "    lea str_pool+" << tok.data << "(%rip), %rax\n"
                              << "    push %rax\n";
-                    // String value is stored in tok.text
-                    string_literals.push_back(tok.text);
                 }
                 else if (tok.type == TokenType::OP) {
                     static_assert(OP_COUNT == 15,
@@ -1851,14 +5774,14 @@ namespace Corth {
                                  << "    pop %rcx\n"
                                  << "    pop %rbx\n"
                                  << "    shl %cl, %rbx\n"
-                                 << "    push %rbx";
+                                 << "    push %rbx\n";
                     }
                     else if (tok.text == ">>") {
                         asm_file << "    # -- bitwise-shift right --\n"
                                  << "    pop %rcx\n"
                                  << "    pop %rbx\n"
                                  << "    shr %cl, %rbx\n"
-                                 << "    push %rbx";
+                                 << "    push %rbx\n";
                     }
                     else if (tok.text == "||") {
                         asm_file << "    # -- bitwise or --\n"
@@ -1885,7 +5808,7 @@ namespace Corth {
                     }
                 }
                 else if (tok.type == TokenType::KEYWORD) {
-                    static_assert(static_cast<int>(Keyword::COUNT) == 36,
+                    static_assert(static_cast<int>(Keyword::COUNT) == 60,
                                   "Exhaustive handling of keywords in GenerateAssembly_GAS_win64");
                     if (tok.text == GetKeywordStr(Keyword::IF)) {
                         asm_file << "    # -- if --\n"
@@ -2044,14 +5967,14 @@ namespace Corth {
                                  << "    pop %rcx\n"
                                  << "    pop %rbx\n"
                                  << "    shl %cl, %rbx\n"
-                                 << "    push %rbx";
+                                 << "    push %rbx\n";
                     }
                     else if (tok.text == GetKeywordStr(Keyword::SHR)) {
                         asm_file << "    # -- bitwise-shift right --\n"
                                  << "    pop %rcx\n"
                                  << "    pop %rbx\n"
-                                 << "    shr %cl %rbx\n"
-                                 << "    push %rbx";
+                                 << "    shr %cl, %rbx\n"
+                                 << "    push %rbx\n";
                     }
                     else if (tok.text == GetKeywordStr(Keyword::OR)) {
                         asm_file << "    # -- bitwise or --\n"
@@ -2093,6 +6016,31 @@ namespace Corth {
 								 << "    sub $64, %rsp\n"
                                  << "    call fwrite\n"
 								 << "    add $64, %rsp\n";
+                    }
+					else if (tok.text == GetKeywordStr(Keyword::READ_FILE)) {
+                        asm_file << "    # -- read from file --\n"
+                                 << "    pop %r9\n"
+                                 << "    pop %r8\n"
+                                 << "    pop %rdx\n"
+                                 << "    pop %rcx\n"
+								 << "    sub $64, %rsp\n"
+                                 << "    call fread\n"
+								 << "    add $64, %rsp\n"
+                                 << "    push %rax\n";
+                    }
+					else if (tok.text == GetKeywordStr(Keyword::READ_BLOCK)) {
+                        asm_file << "    # -- read block from file --\n"
+                                 << "    pop %r9\n"
+                                 << "    pop %r8\n"
+                                 << "    pop %rcx\n"
+                                 << "    mov $1, %rdx\n"
+                                 << "    mov $" << ctx.READ_BLOCK_SIZE << ", %rax\n"
+                                 << "    cmp %rax, %r8\n"
+                                 << "    cmova %rax, %r8\n"
+								 << "    sub $64, %rsp\n"
+                                 << "    call fread\n"
+								 << "    add $64, %rsp\n"
+                                 << "    push %rax\n";
                     }
 					else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE)) {
                         asm_file << "    # -- close file --\n"
@@ -2100,14 +6048,40 @@ namespace Corth {
 								 << "    sub $64, %rsp\n"
                                  << "    call fclose\n"
 								 << "    add $64, %rsp\n";
+                    }
+                    else if (IsBitManipulation(tok)) {
+                        WriteBitManipulation_GAS(ctx, tok, instr_ptr, asm_file);
+                    }
+                    else if (tok.text == GetKeywordStr(Keyword::MEM_FILL)
+                             || tok.text == GetKeywordStr(Keyword::MEM_COPY)
+                             || tok.text == GetKeywordStr(Keyword::MEM_COMPARE)
+                             || tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)
+                             || tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY)) {
+                        WriteBulkMemoryCall_GAS(tok, asm_file);
                     }
 					else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
-                        asm_file << "    # -- get length of string --\n"
-                                 << "    pop %rcx\n"
-								 << "    sub $64, %rsp\n"
-                                 << "    call strlen\n"
-								 << "    add $64, %rsp\n"
-                                 << "    push %rax\n";
+                        if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                            asm_file << "    # -- get length of string literal --\n"
+                                     << "    movq $" << KnownStringLength(*literal) << ", (%rsp)\n";
+                        }
+                        else {
+                            asm_file << "    # -- get length of string --\n"
+                                     << "    pop %rcx\n"
+                                     << "    sub $64, %rsp\n"
+                                     << "    call strlen\n"
+                                     << "    add $64, %rsp\n"
+                                     << "    push %rax\n";
+                        }
+                    }
+                    else if (tok.text == GetKeywordStr(Keyword::MEM_GROW)) {
+                        // `mem` can't grow on Windows; only report whether it's big enough.
+                        asm_file << "    # -- mem_grow --\n"
+                                 << "    pop %rax\n"
+                                 << "    mov $" << ctx.MEM_SIZE << ", %rbx\n"
+                                 << "    xor %rcx, %rcx\n"
+                                 << "    cmp %rbx, %rax\n"
+                                 << "    setbe %cl\n"
+                                 << "    push %rcx\n";
                     }
 					else if (tok.text == GetKeywordStr(Keyword::WRITE)) {
                         asm_file << "    # -- push pointer to write file mode constant --\n"
@@ -2129,13 +6103,25 @@ namespace Corth {
 								 << "    lea append_plus(%rip), %rax\n"
                                  << "    push %rax\n";
                     }
+                    else if (tok.text == GetKeywordStr(Keyword::READ)) {
+                        asm_file << "    # -- push pointer to read file mode constant --\n"
+                                 << "    lea read(%rip), %rax\n"
+                                 << "    push %rax\n";
+                    }
+                    else if (tok.text == GetKeywordStr(Keyword::READ_PLUS)) {
+                        asm_file << "    # -- push pointer to read/write file mode constant --\n"
+                                 << "    lea read_plus(%rip), %rax\n"
+                                 << "    push %rax\n";
+                    }
                 }
                 instr_ptr++;
             }
             // WRITE ASM FOOTER (GRACEFUL PROGRAM EXIT, CONSTANTS)
             asm_file << "    mov $0, %rcx\n"
-                     << "    call exit\n"
-                     << '\n'
+                     << "    call exit\n";
+            if (UsesBulkMemory(prog)) { WriteBulkMemory_GAS(asm_file); }
+            if (UsesByteSearch(prog)) { WriteByteSearch_GAS(false, asm_file); }
+            asm_file << '\n'
                      << "    .data\n"
                      << "    fmt: .string \"%u\"\n"
                      << "    fmt_char: .string \"%c\"\n"
@@ -2143,37 +6129,53 @@ namespace Corth {
 					 << "    write: .string \"w\"\n"
 					 << "    append: .string \"a\"\n"
 					 << "    write_plus: .string \"w+\"\n"
-					 << "    append_plus: .string \"a+\"\n";
+					 << "    append_plus: .string \"a+\"\n"
+					 << "    read: .string \"r\"\n"
+					 << "    read_plus: .string \"r+\"\n";
 
             // WRITE USER DEFINED STRINGS
-            size_t index = 0;
-            if (string_literals.size() > 0) { asm_file << "\n    # USER DEFINED STRINGS\n"; }
-            for (auto& string : string_literals) {
-                asm_file << "str_" << index << ": .string \"" << string << "\"\n";
-                index++;
-            }
+            if (!prog.string_pool.empty()) { asm_file << "\n    # USER DEFINED STRINGS\n"; }
+            WriteStringPool_GAS(ctx, prog, asm_file);
 
             // ALLOCATE MEMORY
             asm_file << '\n'
                      << "    .bss\n"
-                     << "    .comm mem, " << MEM_CAPACITY << '\n';
+                     << "    .comm mem, " << ctx.MEM_SIZE << '\n';
 
             // Close open filestream.
-            asm_file.close();
+            asm_file.flush();
+            asm_output.close();
             
             Log("WIN64 GAS assembly generated at " + asm_file_path);
         }
         else {
-            Error("Could not open file for writing. Does directory exist?");
-            exit(1);
+            Error("Could not open " + asm_file_path + " for writing. Does directory exist?");
+            return false;
         }
+        return true;
     }
 
-    bool HandleCMDLineArgs(int argc, char** argv) {
+    // Parse a size in bytes with an optional binary suffix, i.e. `720000`, `64K`, `512M` or `4G`.
+    bool ParseSize(const std::string& text, uint64_t& size) {
+        size_t end = 0;
+        try { size = std::stoull(text, &end); }
+        catch (...) { return false; }
+        std::string suffix = text.substr(end);
+        uint64_t multiplier = 1;
+        if      (suffix == "K" || suffix == "k") { multiplier = 1ull << 10; }
+        else if (suffix == "M" || suffix == "m") { multiplier = 1ull << 20; }
+        else if (suffix == "G" || suffix == "g") { multiplier = 1ull << 30; }
+        else if (!suffix.empty()) { return false; }
+        if (size > UINT64_MAX / multiplier) { return false; }
+        size *= multiplier;
+        return size != 0;
+    }
+
+    bool HandleCMDLineArgs(Context& ctx, int argc, char** argv, std::vector<std::string>& source_paths, unsigned& jobs) {
         // Return value:
         // False = Execution will halt in main function
         // True = Execution will continue in main function
-        static_assert(static_cast<int>(MODE::COUNT) == 2,
+        static_assert(static_cast<int>(MODE::COUNT) == 4,
                       "Exhaustive handling of supported modes in HandleCMDLineArgs");
         static_assert(static_cast<int>(PLATFORM::COUNT) == 2,
                       "Exhaustive handling of supported platforms in HandleCMDLineArgs");
@@ -2194,12 +6196,12 @@ namespace Corth {
             }
             else if (arg == "-v" || arg == "--verbose") {
                 Log("Verbose logging enabled");
-                verbose_logging = true;
+                ctx.verbose_logging = true;
             }
             else if (arg == "-o" || arg == "--output-name") {
                 if (i + 1 < argc) {
                     i++;
-                    OUTPUT_NAME = argv[i];
+                    ctx.OUTPUT_NAME = argv[i];
                 }
                 else {
                     Error("Expected name of output file to be specified after `-o`!");
@@ -2209,7 +6211,7 @@ namespace Corth {
             else if (arg == "-a" || arg == "--assembler-path") {
                 if (i + 1 < argc) {
                     i++;
-                    ASMB_PATH = argv[i];
+                    ctx.ASMB_PATH = argv[i];
                 }
                 else {
                     Error("Expected path to assembler to be specified after `-a`!");
@@ -2219,7 +6221,7 @@ namespace Corth {
             else if (arg == "-ao" || arg == "--assembler-options") {
                 if (i + 1 < argc) {
                     i++;
-                    ASMB_OPTS = argv[i];
+                    ctx.ASMB_OPTS = argv[i];
                 }
                 else {
                     Error("Expected assembler options to be specified afer `-ao`!");
@@ -2229,7 +6231,7 @@ namespace Corth {
             else if (arg == "-l" || arg == "--linker-path") {
                 if (i + 1 < argc) {
                     i++;
-                    LINK_PATH = argv[i];
+                    ctx.LINK_PATH = argv[i];
                 }
                 else {
                     Error("Expected path to linker to be specified after `-l`!");
@@ -2239,7 +6241,7 @@ namespace Corth {
             else if (arg == "-lo" || arg == "--linker-options") {
                 if (i + 1 < argc) {
                     i++;
-                    LINK_OPTS = argv[i];
+                    ctx.LINK_OPTS = argv[i];
                 }
                 else {
                     Error("Expected linker options to be specified after `-lo`!");
@@ -2249,8 +6251,8 @@ namespace Corth {
             else if (arg == "-add-ao" || arg == "--add-asm-opt") {
                 if (i + 1 < argc) {
                     i++;
-                    ASMB_OPTS.append(1, ' ');
-                    ASMB_OPTS += argv[i];
+                    ctx.ASMB_OPTS.append(1, ' ');
+                    ctx.ASMB_OPTS += argv[i];
                 }
                 else {
                     Error("Expected an assembler command line option to be specified after `-add-ao`!");
@@ -2260,71 +6262,196 @@ namespace Corth {
             else if (arg == "-add-lo" || arg == "--add-link-opt") {
                 if (i + 1 < argc) {
                     i++;
-                    LINK_OPTS.append(1, ' ');
-                    LINK_OPTS += argv[i];                   
+                    ctx.LINK_OPTS.append(1, ' ');
+                    ctx.LINK_OPTS += argv[i];                   
                 }
                 else {
                     Error("Expected a linker command line option to be specified after `-add-lo`!");
                     return false;
                 }
             }
+            else if (arg == "-cache" || arg == "--cache-dir") {
+                if (i + 1 < argc) {
+                    i++;
+                    ctx.CACHE_DIR = argv[i];
+                }
+                else {
+                    Error("Expected path to build cache directory to be specified after `-cache`!");
+                    return false;
+                }
+            }
+            else if (arg == "-cache-limit" || arg == "--cache-size-limit") {
+                if (i + 1 < argc) {
+                    i++;
+                    try {
+                        ctx.CACHE_SIZE_LIMIT = std::stoull(argv[i]) * 1024 * 1024;
+                    }
+                    catch (...) {
+                        Error("Expected build cache size limit in MiB after `-cache-limit`, got " + std::string(argv[i]));
+                        return false;
+                    }
+                }
+                else {
+                    Error("Expected build cache size limit in MiB to be specified after `-cache-limit`!");
+                    return false;
+                }
+            }
+            else if (arg == "-mem-size" || arg == "--mem-size") {
+                if (i + 1 < argc) {
+                    i++;
+                    if (!ParseSize(argv[i], ctx.MEM_SIZE)) {
+                        Error("Expected size of memory in bytes (optionally followed by K, M or G) after `-mem-size`, got " + std::string(argv[i]));
+                        return false;
+                    }
+                }
+                else {
+                    Error("Expected size of memory to be specified after `-mem-size`!");
+                    return false;
+                }
+            }
+            else if (arg == "-read-block-size" || arg == "--read-block-size") {
+                if (i + 1 < argc) {
+                    i++;
+                    if (!ParseSize(argv[i], ctx.READ_BLOCK_SIZE) || ctx.READ_BLOCK_SIZE == 0) {
+                        Error("Expected block size in bytes (optionally followed by K, M or G) after `-read-block-size`, got " + std::string(argv[i]));
+                        return false;
+                    }
+                }
+                else {
+                    Error("Expected block size to be specified after `-read-block-size`!");
+                    return false;
+                }
+            }
+            else if (arg.rfind("-march=", 0) == 0) {
+                ctx.TARGET_ARCH = arg.substr(7);
+                if (!ParseTargetArch(ctx.TARGET_ARCH, ctx.TARGET_FEATURES)) {
+                    Error("Unknown target `" + ctx.TARGET_ARCH + "` in `-march`; expected x86-64, x86-64-v2, x86-64-v3, x86-64-v4 or native");
+                    return false;
+                }
+            }
+            else if (arg == "-mem-mmap" || arg == "--mem-mmap") {
+                ctx.mem_mmap = true;
+            }
+            else if (arg == "-mem-huge" || arg == "--mem-huge") {
+                ctx.mem_huge = true;
+            }
+            else if (arg == "-mem-populate" || arg == "--mem-populate") {
+                ctx.mem_populate = true;
+            }
+            else if (arg == "-mem-grow" || arg == "--mem-grow") {
+                ctx.mem_grow = true;
+            }
+            else if (arg == "-pipe" || arg == "--pipe") {
+                ctx.pipe_assembly = true;
+            }
+            else if (arg == "-g" || arg == "--debug-info") {
+                ctx.debug_info = true;
+            }
+            else if (arg == "-memtrace" || arg == "--memtrace") {
+                ctx.memtrace = true;
+            }
+            else if (arg == "-perfstat" || arg == "--perfstat") {
+                ctx.perfstat = true;
+            }
+            else if (arg == "-sample" || arg == "--sample") {
+                ctx.sample = true;
+            }
+            else if (arg == "-profile" || arg == "--profile") {
+                ctx.profile = true;
+            }
+            else if (arg == "-time" || arg == "--time") {
+                ctx.time_phases = true;
+            }
+            else if (arg == "-time-json" || arg == "--time-json") {
+                if (i + 1 < argc) {
+                    i++;
+                    ctx.time_phases = true;
+                    ctx.TIME_JSON_PATH = argv[i];
+                }
+                else {
+                    Error("Expected path to timing report to be specified after `-time-json`!");
+                    return false;
+                }
+            }
             else if (arg == "-win" || arg == "-win64" ) {
-                RUN_PLATFORM = PLATFORM::WIN64;
+                ctx.RUN_PLATFORM = PLATFORM::WIN64;
             }
             else if (arg == "-linux" || arg == "-linux64") {
-                RUN_PLATFORM = PLATFORM::LINUX64;
+                ctx.RUN_PLATFORM = PLATFORM::LINUX64;
             }
             else if (arg == "-win32" || arg == "-m32" || arg == "-linux32" || arg == "-Wa,--32") {
                 Error("32-bit mode is not supported!");
                 return false;
             }
             else if (arg == "-com" || arg == "--compile") {
-                RUN_MODE = MODE::COMPILE;
+                ctx.RUN_MODE = MODE::COMPILE;
             }
             else if (arg == "-gen" || arg == "--generate") {
-                RUN_MODE = MODE::GENERATE;
+                ctx.RUN_MODE = MODE::GENERATE;
+            }
+            else if (arg == "-int" || arg == "--interpret") {
+                ctx.RUN_MODE = MODE::INTERPRET;
+            }
+            else if (arg == "-bc" || arg == "--bytecode") {
+                ctx.RUN_MODE = MODE::BYTECODE;
             }
             else if (arg == "-NASM") {
-                ASSEMBLY_SYNTAX = ASM_SYNTAX::NASM;
+                ctx.ASSEMBLY_SYNTAX = ASM_SYNTAX::NASM;
                 // PLATFORM SPECIFIC DEFAULTS
                 #ifdef _WIN64
                 // Defaults assume tools were installed on the same drive as Corth as well as in the root directory of the drive.
-                Corth::ASMB_PATH = "\\NASM\\nasm.exe";
-                Corth::ASMB_OPTS = "-f win64";
-                Corth::LINK_PATH = "\\Golink\\golink.exe";
-                Corth::LINK_OPTS = "/console /ENTRY:main msvcrt.dll";
+                ctx.ASMB_PATH = "\\NASM\\nasm.exe";
+                ctx.ASMB_OPTS = "-f win64";
+                ctx.LINK_PATH = "\\Golink\\golink.exe";
+                ctx.LINK_OPTS = "/console /ENTRY:main msvcrt.dll";
                 #endif
 
                 #ifdef __linux__
-                Corth::ASMB_PATH = "nasm";
-                Corth::ASMB_OPTS = "-f elf64";
-                Corth::LINK_PATH = "ld";
-                Corth::LINK_OPTS = "-dynamic-linker /lib64/ld-linux-x86-64.so.2 -lc -m elf_x86_64";
+                ctx.ASMB_PATH = "nasm";
+                ctx.ASMB_OPTS = "-f elf64";
+                ctx.LINK_PATH = "ld";
+                ctx.LINK_OPTS = "-dynamic-linker /lib64/ld-linux-x86-64.so.2 -lc -m elf_x86_64";
                 #endif  
             }
             else if (arg == "-GAS") {
-                ASSEMBLY_SYNTAX = ASM_SYNTAX::GAS;
+                ctx.ASSEMBLY_SYNTAX = ASM_SYNTAX::GAS;
                 #ifdef _WIN64
                 // Defaults assume tools were installed on the same drive as Corth as well as in the root directory of the drive.
-                Corth::ASMB_PATH = "\\TDM-GCC-64\\bin\\gcc.exe";
-                Corth::ASMB_OPTS = "-e main";
-                Corth::LINK_PATH = "";
-                Corth::LINK_OPTS = "";
+                ctx.ASMB_PATH = "\\TDM-GCC-64\\bin\\gcc.exe";
+                ctx.ASMB_OPTS = "-e main";
+                ctx.LINK_PATH = "";
+                ctx.LINK_OPTS = "";
                 #endif
 
                 #ifdef __linux__
-                Corth::ASMB_PATH = "gcc";
-                Corth::ASMB_OPTS = "-e main";
-                Corth::LINK_PATH = "";
-                Corth::LINK_OPTS = "";
+                ctx.ASMB_PATH = "gcc";
+                ctx.ASMB_OPTS = "-e main";
+                ctx.LINK_PATH = "";
+                ctx.LINK_OPTS = "";
                 #endif  
             }
+            else if (arg == "-j" || arg == "--jobs") {
+                if (i + 1 < argc) {
+                    i++;
+                    try {
+                        jobs = std::stoul(argv[i]);
+                    }
+                    catch (...) {
+                        Error("Expected number of jobs after `-j`, got " + std::string(argv[i]));
+                        return false;
+                    }
+                }
+                else {
+                    Error("Expected number of jobs to be specified after `-j`!");
+                    return false;
+                }
+            }
             else {
-                SOURCE_PATH = argv[i];
+                source_paths.push_back(argv[i]);
             }
         }
 
-        if (SOURCE_PATH.empty()) {
+        if (source_paths.empty()) {
             Error("Expected source file path in command line arguments!");
             return false;
         }
@@ -2381,6 +6508,7 @@ namespace Corth {
                 // Look-ahead to check for multi-character operators
                 i++;
                 current = src[i];
+                bool lookahead_used = true;
                 if ((tok.text == "=" && current == '=')
                     || (tok.text == "<" && current == '=')
                     || (tok.text == ">" && current == '=')
@@ -2396,6 +6524,7 @@ namespace Corth {
                     else {
                         Warning("Expected '|' following '|'", tok.line_number, tok.col_number);
                         tok.text.append(1, '|'); // Create missing text so it will still work
+                        lookahead_used = false;
                     }
                 }
                 else if (tok.text == "&") {
@@ -2405,6 +6534,7 @@ namespace Corth {
                     else {
                         Warning("Expected '&' following '&'", tok.line_number, tok.col_number);
                         tok.text.append(1, '&'); // Create missing text so it will still work
+                        lookahead_used = false;
                     }
                 }
                 else if (tok.text == "/" && current == '/') {
@@ -2421,6 +6551,12 @@ namespace Corth {
                         }
                     }
                 }
+                else {
+                    lookahead_used = false;
+                }
+                // Undo look-ahead of single-character operators,
+                //   so that i.e. a new-line right after one is still counted.
+                if (!lookahead_used) { i--; }
                 PushToken(toks, tok);
             }
             else if (isdigit(current)) {
@@ -2483,6 +6619,31 @@ namespace Corth {
                         tok.col_number++;
                         break;
                     }
+                    // Escapes are decoded right here, so nothing after the lexer has to deal with them.
+                    // "\n" and "\t" become a newline and a horizontal tab; "\r" is dropped (suck it, Windows).
+                    // "\\" is a backslash, and up to three octal digits (i.e. "\0") are the byte they spell,
+                    //   as the GNU assembler decoded them back when literals were emitted verbatim.
+                    else if (current == '\\' && static_cast<size_t>(i) + 1 < src_end
+                             && (src[i + 1] == 'n' || src[i + 1] == 'r' || src[i + 1] == 't'
+                                 || src[i + 1] == '\\' || (src[i + 1] >= '0' && src[i + 1] <= '7')))
+                    {
+                        i++;
+                        tok.col_number++;
+                        if (src[i] == 'n')       { tok.text.append(1, '\n'); }
+                        else if (src[i] == 't')  { tok.text.append(1, '\t'); }
+                        else if (src[i] == '\\') { tok.text.append(1, '\\'); }
+                        else if (src[i] != 'r') {
+                            unsigned value = src[i] - '0';
+                            for (int digits = 1; digits < 3 && static_cast<size_t>(i) + 1 < src_end
+                                 && src[i + 1] >= '0' && src[i + 1] <= '7'; digits++)
+                            {
+                                i++;
+                                tok.col_number++;
+                                value = value * 8 + (src[i] - '0');
+                            }
+                            tok.text.append(1, static_cast<char>(value));
+                        }
+                    }
                     else { tok.text.append(1, current);}
                     // Increment current character
                     i++;
@@ -2499,6 +6660,7 @@ namespace Corth {
                 PushToken(toks, tok);
             }
         }
+        BuildStringPool(prog);
         return true;
     }
 
@@ -2590,7 +6752,7 @@ namespace Corth {
                 }
             }
             else if (tok.type == TokenType::KEYWORD) {
-                static_assert(static_cast<int>(Keyword::COUNT) == 36,
+                static_assert(static_cast<int>(Keyword::COUNT) == 60,
                               "Exhaustive handling of keywords in ValidateTokens_Stack. Keep in mind not all keywords do stack operations");
                 // Skip skippable tokens first for speed
                 if (tok.text == GetKeywordStr(Keyword::ELSE)
@@ -2628,7 +6790,9 @@ namespace Corth {
 						 || tok.text == GetKeywordStr(Keyword::WRITE)
 						 || tok.text == GetKeywordStr(Keyword::APPEND)
 						 || tok.text == GetKeywordStr(Keyword::WRITE_PLUS)
-						 || tok.text == GetKeywordStr(Keyword::APPEND_PLUS))
+						 || tok.text == GetKeywordStr(Keyword::APPEND_PLUS)
+						 || tok.text == GetKeywordStr(Keyword::READ)
+						 || tok.text == GetKeywordStr(Keyword::READ_PLUS))
 				{
                     // `mem` will push the address of usable memory onto the stack
                     // [] -> [addr]
@@ -2639,7 +6803,13 @@ namespace Corth {
                          || tok.text == GetKeywordStr(Keyword::LOADW)
                          || tok.text == GetKeywordStr(Keyword::LOADD)
                          || tok.text == GetKeywordStr(Keyword::LOADQ)
-						 || tok.text == GetKeywordStr(Keyword::LENGTH_S))
+						 || tok.text == GetKeywordStr(Keyword::LENGTH_S)
+                         || tok.text == GetKeywordStr(Keyword::MEM_GROW)
+                         || tok.text == GetKeywordStr(Keyword::ASYNC_WAIT)
+                         || tok.text == GetKeywordStr(Keyword::POPCNT)
+                         || tok.text == GetKeywordStr(Keyword::LZCNT)
+                         || tok.text == GetKeywordStr(Keyword::TZCNT)
+                         || tok.text == GetKeywordStr(Keyword::BSWAP))
                 {
 					// All operations that pop one and push one from the stack
 					//  belong in this conditional branch.
@@ -2647,6 +6817,9 @@ namespace Corth {
                     //   then push the value at that address.
                     // [addr] -> [value]
 					// `length_s` pops a string ptr and returns it's length
+                    // `mem_grow` pops a size and returns whether that much of `mem` is usable
+                    // `async_wait` pops a request and returns how many bytes it transferred
+                    // `popcnt`, `lzcnt`, `tzcnt` and `bswap` replace a value with a count of its bits, or its bytes reversed
                     if (stackSize > 0) {
                         continue;
                     }
@@ -2655,11 +6828,13 @@ namespace Corth {
                 else if (tok.text == GetKeywordStr(Keyword::STOREB)
                          || tok.text == GetKeywordStr(Keyword::STOREW)
                          || tok.text == GetKeywordStr(Keyword::STORED)
-                         || tok.text == GetKeywordStr(Keyword::STOREQ))
+                         || tok.text == GetKeywordStr(Keyword::STOREQ)
+                         || tok.text == GetKeywordStr(Keyword::UNMAP_FILE))
                 {
                     // `store` operations will pop a value and an
                     //   address from the stack.
                     // [addr][value] -> []
+                    // `unmap_file` pops the address and length of a mapping.
                     if (stackSize > 1) {
                         stackSize -= 2;
                     }
@@ -2682,8 +6857,10 @@ namespace Corth {
                         TokenStackError(tok);
                     }
                 }
-                else if (tok.text == GetKeywordStr(Keyword::SWAP)) {
+                else if (tok.text == GetKeywordStr(Keyword::SWAP)
+                         || tok.text == GetKeywordStr(Keyword::MAP_FILE)) {
                     // `swap` will pop two values but also push two values, net zero.
+                    // `map_file` pops a path and a file mode, then pushes the address and length of the mapping.
                     if (stackSize > 1) {
 						continue;
 					}
@@ -2702,9 +6879,14 @@ namespace Corth {
                          || tok.text == GetKeywordStr(Keyword::OR)
                          || tok.text == GetKeywordStr(Keyword::AND)
                          || tok.text == GetKeywordStr(Keyword::MOD)
+                         || tok.text == GetKeywordStr(Keyword::ROL)
+                         || tok.text == GetKeywordStr(Keyword::ROR)
+                         || tok.text == GetKeywordStr(Keyword::PEXT)
+                         || tok.text == GetKeywordStr(Keyword::PDEP)
 						 || tok.text == GetKeywordStr(Keyword::OPEN_FILE))
                 {
-                    // Bitwise-shift left and right, bitwise-or and bitwise-and, modulo,
+                    // Bitwise-shift left and right, bitwise-or and bitwise-and, modulo, rotates,
+                    //   bit extract and deposit,
 					//   as well as fopen will pop two values off the stack and
 					//   add one, net negative one.
                     // [a][b] -> [c]
@@ -2723,6 +6905,59 @@ namespace Corth {
 					}
 					else { TokenStackError(tok); }
 				}
+                else if (tok.text == GetKeywordStr(Keyword::MAP_ADVISE)) {
+                    // [addr][length][advice] -> []
+                    if (stackSize > 2) {
+                        stackSize -= 3;
+                    }
+                    else { TokenStackError(tok); }
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_FILL)
+                         || tok.text == GetKeywordStr(Keyword::MEM_COPY)) {
+                    // [destination][byte][length] -> []
+                    // [destination][source][length] -> []
+                    if (stackSize > 2) {
+                        stackSize -= 3;
+                    }
+                    else { TokenStackError(tok); }
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_COMPARE)
+                         || tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)
+                         || tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY)) {
+                    // [a][b][length] -> [offset of first difference]
+                    // [address][length][byte] -> [offset of first match]
+                    // [address][length][set] -> [offset of first match]
+                    if (stackSize > 2) {
+                        stackSize -= 2;
+                    }
+                    else { TokenStackError(tok); }
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_BLOCK)) {
+                    // [buffer][max bytes][file pointer] -> [bytes read]
+                    if (stackSize > 2) {
+                        stackSize -= 2;
+                    }
+                    else { TokenStackError(tok); }
+                }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_READ)
+                         || tok.text == GetKeywordStr(Keyword::ASYNC_WRITE)) {
+                    // [buffer][length][offset][file pointer] -> [request]
+                    if (stackSize > 3) {
+                        stackSize -= 3;
+                    }
+                    else { TokenStackError(tok); }
+                }
+                else if (tok.text == GetKeywordStr(Keyword::READ_FILE)) {
+                    // `read_file` calls fread, which takes the same four arguments as fwrite,
+                    //   and pushes how many items were read.
+                    // [buffer][bytes per item][number of items][file pointer]
+                    // ->
+                    // [number of items read]
+                    if (stackSize > 3) {
+                        stackSize -= 3;
+                    }
+                    else { TokenStackError(tok); }
+                }
             }
         }
         
@@ -2735,7 +6970,7 @@ namespace Corth {
         // Assume that current token at instruction pointer is an `if`, `else`, `do`, or `while`
         size_t block_instr_ptr = instr_ptr;
 
-        static_assert(static_cast<int>(Keyword::COUNT) == 36,
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
                       "Exhaustive handling of keywords in ValidateBlock. Keep in mind not all keywords form blocks.");
         
         // Handle while block
@@ -2829,42 +7064,1224 @@ namespace Corth {
         return false;
     }
 
-    // This function ensures any tokens that start or stop blocks are correctly referenced
-    // For example, an `if` statement needs to know where to jump to if it is false.
-    // Another example: `endwhile` statement needs to know where to jump back to.
-    void ValidateTokens_Blocks(Program& prog) {
-        static_assert(static_cast<int>(Keyword::COUNT) == 36,
-                      "Exhaustive handling of keywords in ValidateTokens_Blocks. Keep in mind not all tokens form blocks");
-        size_t instr_ptr = 0;
-        size_t instr_ptr_max = prog.tokens.size();
-        while (instr_ptr < instr_ptr_max) {
-            if (prog.tokens[instr_ptr].text == GetKeywordStr(Keyword::IF)
-                || prog.tokens[instr_ptr].text == GetKeywordStr(Keyword::WHILE))
-            {
-                ValidateBlock(prog, instr_ptr, instr_ptr_max);
-                // Undo look-ahead
-                instr_ptr--;
+    // This function ensures any tokens that start or stop blocks are correctly referenced
+    // For example, an `if` statement needs to know where to jump to if it is false.
+    // Another example: `endwhile` statement needs to know where to jump back to.
+    void ValidateTokens_Blocks(Program& prog) {
+        static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                      "Exhaustive handling of keywords in ValidateTokens_Blocks. Keep in mind not all tokens form blocks");
+        size_t instr_ptr = 0;
+        size_t instr_ptr_max = prog.tokens.size();
+        while (instr_ptr < instr_ptr_max) {
+            if (prog.tokens[instr_ptr].text == GetKeywordStr(Keyword::IF)
+                || prog.tokens[instr_ptr].text == GetKeywordStr(Keyword::WHILE))
+            {
+                ValidateBlock(prog, instr_ptr, instr_ptr_max);
+                // Undo look-ahead
+                instr_ptr--;
+            }
+            instr_ptr++;
+        }
+    }
+    
+    void ValidateTokens(Context& ctx, Program& prog) {
+        // Stack protection
+        {
+            PhaseTimer timer(ctx, "ValidateTokens_Stack");
+            ValidateTokens_Stack(prog);
+        }
+
+        // Cross-reference blocks (give `if` tokens a reference to it's `endif` counterpart
+        {
+            PhaseTimer timer(ctx, "ValidateTokens_Blocks");
+            ValidateTokens_Blocks(prog);
+        }
+
+        // Remove all un-neccessary tokens
+        static_cast<void>(std::remove_if(prog.tokens.begin(), prog.tokens.end(), RemovableToken));
+
+        if (ctx.verbose_logging) { Log("Tokens validated"); }
+    }
+
+    // Every operation the interpreter can execute.
+    // The order of this enum must match the handler table in `Interpret`.
+    enum class OpCode : uint8_t {
+        PUSH_INT,
+        PUSH_STR,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        MOD,
+        EQ,
+        LT,
+        GT,
+        LE,
+        GE,
+        SHL,
+        SHR,
+        OR,
+        AND,
+        JMP,
+        JMP_IF_ZERO,
+        DUP,
+        TWODUP,
+        DROP,
+        SWAP,
+        OVER,
+        DUMP,
+        DUMP_C,
+        DUMP_S,
+        MEM,
+        LOADB,
+        STOREB,
+        LOADW,
+        STOREW,
+        LOADD,
+        STORED,
+        LOADQ,
+        STOREQ,
+        OPEN_FILE,
+        WRITE_TO_FILE,
+        READ_FILE,
+        READ_BLOCK,
+        CLOSE_FILE,
+        LENGTH_S,
+        MEM_GROW,
+        MAP_FILE,
+        UNMAP_FILE,
+        MAP_ADVISE,
+        ASYNC_READ,
+        ASYNC_WRITE,
+        ASYNC_WAIT,
+        MEM_FILL,
+        MEM_COPY,
+        MEM_COMPARE,
+        MEM_FIND_BYTE,
+        MEM_FIND_ANY,
+        POPCNT,
+        LZCNT,
+        TZCNT,
+        BSWAP,
+        ROL,
+        ROR,
+        PEXT,
+        PDEP,
+        HALT,
+        COUNT
+    };
+
+    struct Instruction {
+        OpCode op;
+        // Integer to push, offset into the string pool, or index of jump target.
+        uint64_t operand;
+    };
+
+    struct Bytecode {
+        std::vector<Instruction> code;
+        // Null-terminated string literals stored back to back.
+        // `PUSH_STR` operands are byte offsets into this pool.
+        std::string string_pool;
+        // Offset of every string already in the pool, so each literal is only stored once.
+        std::map<std::string, uint64_t> string_offsets;
+    };
+
+    // Amount of 64-bit values the interpreter's data stack can hold (8MiB, same as a default Linux stack).
+    const size_t INTERPRETER_STACK_CAPACITY = 1024 * 1024;
+
+    uint64_t AddToStringPool(Bytecode& bc, const std::string& str) {
+        auto existing = bc.string_offsets.find(str);
+        if (existing != bc.string_offsets.end()) {
+            return existing->second;
+        }
+        uint64_t offset = bc.string_pool.size();
+        bc.string_pool.append(str);
+        bc.string_pool.push_back('\0');
+        bc.string_offsets[str] = offset;
+        return offset;
+    }
+
+    // Decode validated tokens into bytecode.
+    // Comparing token text on every step of execution would be painfully slow,
+    //   so each token is translated into (at most) one instruction up front, and
+    //   the token indices stored in block keywords' data fields are resolved
+    //   into instruction indices.
+    bool GenerateBytecode(Context& ctx, Program& prog, Bytecode& bc) {
+        static_assert(static_cast<int>(TokenType::COUNT) == 5,
+                      "Exhaustive handling of token types in GenerateBytecode");
+        size_t instr_ptr_max = prog.tokens.size();
+        // The instruction index each `addr_<token index>` label of the assembly backends would point to.
+        std::vector<uint64_t> labels(instr_ptr_max, 0);
+        // Indices of jump instructions, whose operands are token indices until resolved.
+        std::vector<size_t> jumps;
+
+        // User-defined strings are already pooled by the lexer; file mode constants are added after them.
+        bc.string_pool = prog.string_pool;
+        uint64_t mode_write = AddToStringPool(bc, "w");
+        uint64_t mode_append = AddToStringPool(bc, "a");
+        uint64_t mode_write_plus = AddToStringPool(bc, "w+");
+        uint64_t mode_append_plus = AddToStringPool(bc, "a+");
+        uint64_t mode_read = AddToStringPool(bc, "r");
+        uint64_t mode_read_plus = AddToStringPool(bc, "r+");
+
+        auto emit = [&bc](OpCode op, uint64_t operand = 0) {
+            bc.code.push_back({ op, operand });
+        };
+        for (size_t instr_ptr = 0; instr_ptr < instr_ptr_max; instr_ptr++) {
+            Token& tok = prog.tokens[instr_ptr];
+            if (tok.type == TokenType::INT) {
+                try {
+                    emit(OpCode::PUSH_INT, std::stoull(tok.text));
+                }
+                catch (...) {
+                    Error("Integer literal out of range: " + tok.text, tok.line_number, tok.col_number);
+                    return false;
+                }
+            }
+            else if (tok.type == TokenType::STRING) {
+                emit(OpCode::PUSH_STR, std::stoull(tok.data));
+            }
+            else if (tok.type == TokenType::OP) {
+                static_assert(OP_COUNT == 15,
+                              "Exhaustive handling of operators in GenerateBytecode");
+                if      (tok.text == "+")  { emit(OpCode::ADD);  }
+                else if (tok.text == "-")  { emit(OpCode::SUB);  }
+                else if (tok.text == "*")  { emit(OpCode::MUL);  }
+                else if (tok.text == "/")  { emit(OpCode::DIV);  }
+                else if (tok.text == "%")  { emit(OpCode::MOD);  }
+                else if (tok.text == "=")  { emit(OpCode::EQ);   }
+                else if (tok.text == "<")  { emit(OpCode::LT);   }
+                else if (tok.text == ">")  { emit(OpCode::GT);   }
+                else if (tok.text == "<=") { emit(OpCode::LE);   }
+                else if (tok.text == ">=") { emit(OpCode::GE);   }
+                else if (tok.text == "<<") { emit(OpCode::SHL);  }
+                else if (tok.text == ">>") { emit(OpCode::SHR);  }
+                else if (tok.text == "||") { emit(OpCode::OR);   }
+                else if (tok.text == "&&") { emit(OpCode::AND);  }
+                else if (tok.text == "#")  { emit(OpCode::DUMP); }
+            }
+            else if (tok.type == TokenType::KEYWORD) {
+                static_assert(static_cast<int>(Keyword::COUNT) == 60,
+                              "Exhaustive handling of keywords in GenerateBytecode");
+                if (tok.text == GetKeywordStr(Keyword::IF)
+                    || tok.text == GetKeywordStr(Keyword::DO)
+                    || tok.text == GetKeywordStr(Keyword::ELSE)
+                    || tok.text == GetKeywordStr(Keyword::ENDWHILE))
+                {
+                    size_t target = 0;
+                    try { target = std::stoull(tok.data); }
+                    catch (...) { target = instr_ptr_max; }
+                    if (target >= instr_ptr_max) {
+                        Error("Could not resolve jump target of `" + tok.text + "`",
+                              tok.line_number, tok.col_number);
+                        return false;
+                    }
+                    jumps.push_back(bc.code.size());
+                    if (tok.text == GetKeywordStr(Keyword::IF)
+                        || tok.text == GetKeywordStr(Keyword::DO))
+                    {
+                        emit(OpCode::JMP_IF_ZERO, target);
+                    }
+                    else { emit(OpCode::JMP, target); }
+                }
+                // `while` and `endif` only mark a jump target.
+                else if (tok.text == GetKeywordStr(Keyword::DUP))           { emit(OpCode::DUP);           }
+                else if (tok.text == GetKeywordStr(Keyword::TWODUP))        { emit(OpCode::TWODUP);        }
+                else if (tok.text == GetKeywordStr(Keyword::DROP))          { emit(OpCode::DROP);          }
+                else if (tok.text == GetKeywordStr(Keyword::SWAP))          { emit(OpCode::SWAP);          }
+                else if (tok.text == GetKeywordStr(Keyword::OVER))          { emit(OpCode::OVER);          }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP))          { emit(OpCode::DUMP);          }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP_C))        { emit(OpCode::DUMP_C);        }
+                else if (tok.text == GetKeywordStr(Keyword::DUMP_S))        { emit(OpCode::DUMP_S);        }
+                else if (tok.text == GetKeywordStr(Keyword::MEM))           { emit(OpCode::MEM);           }
+                else if (tok.text == GetKeywordStr(Keyword::LOADB))         { emit(OpCode::LOADB);         }
+                else if (tok.text == GetKeywordStr(Keyword::STOREB))        { emit(OpCode::STOREB);        }
+                else if (tok.text == GetKeywordStr(Keyword::LOADW))         { emit(OpCode::LOADW);         }
+                else if (tok.text == GetKeywordStr(Keyword::STOREW))        { emit(OpCode::STOREW);        }
+                else if (tok.text == GetKeywordStr(Keyword::LOADD))         { emit(OpCode::LOADD);         }
+                else if (tok.text == GetKeywordStr(Keyword::STORED))        { emit(OpCode::STORED);        }
+                else if (tok.text == GetKeywordStr(Keyword::LOADQ))         { emit(OpCode::LOADQ);         }
+                else if (tok.text == GetKeywordStr(Keyword::STOREQ))        { emit(OpCode::STOREQ);        }
+                else if (tok.text == GetKeywordStr(Keyword::SHL))           { emit(OpCode::SHL);           }
+                else if (tok.text == GetKeywordStr(Keyword::SHR))           { emit(OpCode::SHR);           }
+                else if (tok.text == GetKeywordStr(Keyword::OR))            { emit(OpCode::OR);            }
+                else if (tok.text == GetKeywordStr(Keyword::AND))           { emit(OpCode::AND);           }
+                else if (tok.text == GetKeywordStr(Keyword::MOD))           { emit(OpCode::MOD);           }
+                else if (tok.text == GetKeywordStr(Keyword::OPEN_FILE))     { emit(OpCode::OPEN_FILE);     }
+                else if (tok.text == GetKeywordStr(Keyword::WRITE_TO_FILE)) { emit(OpCode::WRITE_TO_FILE); }
+                else if (tok.text == GetKeywordStr(Keyword::READ_FILE))     { emit(OpCode::READ_FILE);     }
+                else if (tok.text == GetKeywordStr(Keyword::READ_BLOCK))    { emit(OpCode::READ_BLOCK, ctx.READ_BLOCK_SIZE); }
+                else if (tok.text == GetKeywordStr(Keyword::CLOSE_FILE))    { emit(OpCode::CLOSE_FILE);    }
+                else if (tok.text == GetKeywordStr(Keyword::LENGTH_S)) {
+                    if (const Token* literal = KnownStringOperand(prog, instr_ptr)) {
+                        // The literal (or its copy made by `dup`) is pushed by the last instruction; push its length instead.
+                        bc.code.back() = { OpCode::PUSH_INT, KnownStringLength(*literal) };
+                    }
+                    else { emit(OpCode::LENGTH_S); }
+                }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_GROW))      { emit(OpCode::MEM_GROW);      }
+                else if (tok.text == GetKeywordStr(Keyword::MAP_FILE))      { emit(OpCode::MAP_FILE);      }
+                else if (tok.text == GetKeywordStr(Keyword::UNMAP_FILE))    { emit(OpCode::UNMAP_FILE);    }
+                else if (tok.text == GetKeywordStr(Keyword::MAP_ADVISE))    { emit(OpCode::MAP_ADVISE);    }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_READ))    { emit(OpCode::ASYNC_READ);    }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_WRITE))   { emit(OpCode::ASYNC_WRITE);   }
+                else if (tok.text == GetKeywordStr(Keyword::ASYNC_WAIT))    { emit(OpCode::ASYNC_WAIT);    }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_FILL))      { emit(OpCode::MEM_FILL);      }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_COPY))      { emit(OpCode::MEM_COPY);      }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_COMPARE))   { emit(OpCode::MEM_COMPARE);   }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_FIND_BYTE)) { emit(OpCode::MEM_FIND_BYTE); }
+                else if (tok.text == GetKeywordStr(Keyword::MEM_FIND_ANY))  { emit(OpCode::MEM_FIND_ANY);  }
+                else if (tok.text == GetKeywordStr(Keyword::POPCNT))        { emit(OpCode::POPCNT);        }
+                else if (tok.text == GetKeywordStr(Keyword::LZCNT))         { emit(OpCode::LZCNT);         }
+                else if (tok.text == GetKeywordStr(Keyword::TZCNT))         { emit(OpCode::TZCNT);         }
+                else if (tok.text == GetKeywordStr(Keyword::BSWAP))         { emit(OpCode::BSWAP);         }
+                else if (tok.text == GetKeywordStr(Keyword::ROL))           { emit(OpCode::ROL);           }
+                else if (tok.text == GetKeywordStr(Keyword::ROR))           { emit(OpCode::ROR);           }
+                else if (tok.text == GetKeywordStr(Keyword::PEXT))          { emit(OpCode::PEXT);          }
+                else if (tok.text == GetKeywordStr(Keyword::PDEP))          { emit(OpCode::PDEP);          }
+                else if (tok.text == GetKeywordStr(Keyword::WRITE))         { emit(OpCode::PUSH_STR, mode_write);       }
+                else if (tok.text == GetKeywordStr(Keyword::WRITE_PLUS))    { emit(OpCode::PUSH_STR, mode_write_plus);  }
+                else if (tok.text == GetKeywordStr(Keyword::APPEND))        { emit(OpCode::PUSH_STR, mode_append);      }
+                else if (tok.text == GetKeywordStr(Keyword::APPEND_PLUS))   { emit(OpCode::PUSH_STR, mode_append_plus); }
+                else if (tok.text == GetKeywordStr(Keyword::READ))          { emit(OpCode::PUSH_STR, mode_read);        }
+                else if (tok.text == GetKeywordStr(Keyword::READ_PLUS))     { emit(OpCode::PUSH_STR, mode_read_plus);   }
+            }
+            // Anything jumping to this token lands after the code generated for it.
+            labels[instr_ptr] = bc.code.size();
+        }
+        emit(OpCode::HALT);
+
+        for (size_t jump : jumps) {
+            bc.code[jump].operand = labels[bc.code[jump].operand];
+        }
+
+        if (ctx.verbose_logging) {
+            Log("Decoded " + std::to_string(instr_ptr_max) + " tokens into "
+                + std::to_string(bc.code.size()) + " instructions");
+        }
+        return true;
+    }
+
+    // The interpreter's `map_file`, with the same semantics as the generated code (see MAPPED FILES).
+    // Mapping files is only supported on Linux; elsewhere, every file fails to map.
+    void MapFile(const char* path, bool writable, uint64_t& address, uint64_t& length) {
+        address = 0;
+        length = 0;
+        #ifdef __linux__
+        int fd = open(path, writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) { return; }
+        off_t size = lseek(fd, 0, SEEK_END);
+        if (size > 0) {
+            void* mapping = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+            if (mapping != MAP_FAILED) {
+                address = reinterpret_cast<uint64_t>(mapping);
+                length = size;
+            }
+        }
+        close(fd);
+        #endif
+    }
+
+    void UnmapFile(uint64_t address, uint64_t length) {
+        #ifdef __linux__
+        munmap(reinterpret_cast<void*>(address), length);
+        #endif
+    }
+
+    void AdviseMapping(uint64_t address, uint64_t length, uint64_t advice) {
+        #ifdef __linux__
+        madvise(reinterpret_cast<void*>(address), length, static_cast<int>(advice));
+        #endif
+    }
+
+    // The interpreter's `async_read` and `async_write`; returns the bytes transferred, or zero on failure.
+    // Asynchronous file I/O is only supported on Linux; elsewhere, every request fails.
+    uint64_t TransferAt(bool write, uint64_t buffer, uint64_t length, uint64_t offset, FILE* file) {
+        #ifdef __linux__
+        ssize_t transferred = write
+            ? pwrite(fileno(file), reinterpret_cast<const void*>(buffer), length, offset)
+            : pread(fileno(file), reinterpret_cast<void*>(buffer), length, offset);
+        return transferred < 0 ? 0 : transferred;
+        #else
+        return 0;
+        #endif
+    }
+
+    // The interpreter's bit manipulation keywords; `lzcnt` and `tzcnt` of zero are 64.
+    uint64_t PopCount(uint64_t a) {
+        uint64_t count = 0;
+        for (; a; a &= a - 1) { count++; }
+        return count;
+    }
+
+    uint64_t LeadingZeros(uint64_t a) {
+        uint64_t count = 0;
+        for (uint64_t bit = 1ull << 63; bit && !(a & bit); bit >>= 1) { count++; }
+        return count;
+    }
+
+    uint64_t TrailingZeros(uint64_t a) {
+        uint64_t count = 0;
+        for (uint64_t bit = 1; bit && !(a & bit); bit <<= 1) { count++; }
+        return count;
+    }
+
+    uint64_t ByteSwap(uint64_t a) {
+        uint64_t swapped = 0;
+        for (int i = 0; i < 8; i++) { swapped = swapped << 8 | ((a >> (i * 8)) & 0xff); }
+        return swapped;
+    }
+
+    // Gather the bits of `a` under the set bits of `mask` into the low bits of the result.
+    uint64_t ExtractBits(uint64_t a, uint64_t mask) {
+        uint64_t result = 0;
+        for (uint64_t bit = 1; mask; mask &= mask - 1, bit <<= 1) {
+            if (a & mask & (~mask + 1)) { result |= bit; }
+        }
+        return result;
+    }
+
+    // Scatter the low bits of `a` to the set bits of `mask`.
+    uint64_t DepositBits(uint64_t a, uint64_t mask) {
+        uint64_t result = 0;
+        for (uint64_t bit = 1; mask; mask &= mask - 1, bit <<= 1) {
+            if (a & bit) { result |= mask & (~mask + 1); }
+        }
+        return result;
+    }
+
+    // Run bytecode with direct-threaded dispatch where the compiler supports
+    //   taking the address of a label (GCC and Clang), or a plain switch otherwise.
+    // The semantics of every instruction match the code generated by the
+    //   assembly backends, down to `dump` only printing the low 32 bits.
+    bool Interpret(Context& ctx, const Instruction* instructions, size_t instruction_count, char* string_pool) {
+        static_assert(static_cast<int>(OpCode::COUNT) == 62,
+                      "Exhaustive handling of opcodes in Interpret");
+        std::vector<uint64_t> stack(INTERPRETER_STACK_CAPACITY);
+        #ifdef __linux__
+        // Reserve no swap for `mem`, like the `.bss` of a compiled program, so that i.e. `-mem-size 8G`
+        //   works on a machine with less memory; pages are only allocated once they are touched.
+        size_t mem_size = ctx.MEM_SIZE;
+        void* mem_mapping = mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        auto release_mem = [mem_size](uint8_t* mem) { munmap(mem, mem_size); };
+        std::unique_ptr<uint8_t, decltype(release_mem)> mem(mem_mapping == MAP_FAILED ? nullptr : static_cast<uint8_t*>(mem_mapping), release_mem);
+        #else
+        // `calloc` leaves the pages of a large `mem` untouched until they are used.
+        std::unique_ptr<uint8_t, decltype(&free)> mem(static_cast<uint8_t*>(calloc(ctx.MEM_SIZE, 1)), &free);
+        #endif
+        if (!mem) {
+            Error("Interpreter: could not allocate " + std::to_string(ctx.MEM_SIZE) + " bytes of memory");
+            return false;
+        }
+        uint64_t* stack_base = stack.data();
+        uint64_t* stack_end = stack_base + stack.size();
+        // Points to the next free slot on the stack.
+        uint64_t* sp = stack_base;
+        uint64_t a = 0;
+        uint64_t b = 0;
+        // Requests in flight of `async_read` and `async_write`, each running on a thread of its own.
+        std::vector<std::future<uint64_t>> async_requests(ASYNC_QUEUE_DEPTH);
+        std::vector<uint64_t> async_request_ids(ASYNC_QUEUE_DEPTH);
+        uint64_t async_next = 0;
+
+        #if defined(__GNUC__) || defined(__clang__)
+        static const void* const handlers[] = {
+            &&op_PUSH_INT, &&op_PUSH_STR,
+            &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_MOD,
+            &&op_EQ, &&op_LT, &&op_GT, &&op_LE, &&op_GE,
+            &&op_SHL, &&op_SHR, &&op_OR, &&op_AND,
+            &&op_JMP, &&op_JMP_IF_ZERO,
+            &&op_DUP, &&op_TWODUP, &&op_DROP, &&op_SWAP, &&op_OVER,
+            &&op_DUMP, &&op_DUMP_C, &&op_DUMP_S,
+            &&op_MEM,
+            &&op_LOADB, &&op_STOREB, &&op_LOADW, &&op_STOREW,
+            &&op_LOADD, &&op_STORED, &&op_LOADQ, &&op_STOREQ,
+            &&op_OPEN_FILE, &&op_WRITE_TO_FILE, &&op_READ_FILE, &&op_READ_BLOCK,
+            &&op_CLOSE_FILE, &&op_LENGTH_S,
+            &&op_MEM_GROW, &&op_MAP_FILE, &&op_UNMAP_FILE, &&op_MAP_ADVISE,
+            &&op_ASYNC_READ, &&op_ASYNC_WRITE, &&op_ASYNC_WAIT,
+            &&op_MEM_FILL, &&op_MEM_COPY, &&op_MEM_COMPARE, &&op_MEM_FIND_BYTE, &&op_MEM_FIND_ANY,
+            &&op_POPCNT, &&op_LZCNT, &&op_TZCNT, &&op_BSWAP, &&op_ROL, &&op_ROR, &&op_PEXT, &&op_PDEP,
+            &&op_HALT
+        };
+        static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(OpCode::COUNT),
+                      "Every opcode needs a handler in Interpret");
+        struct ThreadedInstruction {
+            const void* handler;
+            uint64_t operand;
+        };
+        // Replace each opcode with the address of its handler, so dispatch is a single indirect jump.
+        std::vector<ThreadedInstruction> threaded(instruction_count);
+        for (size_t i = 0; i < instruction_count; i++) {
+            threaded[i] = { handlers[static_cast<size_t>(instructions[i].op)], instructions[i].operand };
+        }
+        const ThreadedInstruction* code = threaded.data();
+        #define CORTH_OP(name) op_##name
+        #define CORTH_NEXT() do { cur = ip++; goto *cur->handler; } while (0)
+        #else
+        const Instruction* code = instructions;
+        #define CORTH_OP(name) case OpCode::name
+        #define CORTH_NEXT() continue
+        #endif
+        #define CORTH_PUSH(value) do { if (sp == stack_end) { goto stack_overflow; } *sp++ = (value); } while (0)
+
+        auto ip = code;
+        auto cur = code;
+        #if defined(__GNUC__) || defined(__clang__)
+        CORTH_NEXT();
+        #else
+        for (;;) {
+            cur = ip++;
+            switch (cur->op) {
+        #endif
+            CORTH_OP(PUSH_INT):
+                CORTH_PUSH(cur->operand);
+                CORTH_NEXT();
+            CORTH_OP(PUSH_STR):
+                CORTH_PUSH(reinterpret_cast<uint64_t>(string_pool + cur->operand));
+                CORTH_NEXT();
+            CORTH_OP(ADD):
+                b = *--sp; sp[-1] += b;
+                CORTH_NEXT();
+            CORTH_OP(SUB):
+                b = *--sp; sp[-1] -= b;
+                CORTH_NEXT();
+            CORTH_OP(MUL):
+                b = *--sp; sp[-1] *= b;
+                CORTH_NEXT();
+            CORTH_OP(DIV):
+                b = *--sp; sp[-1] /= b;
+                CORTH_NEXT();
+            CORTH_OP(MOD):
+                b = *--sp; sp[-1] %= b;
+                CORTH_NEXT();
+            CORTH_OP(EQ):
+                b = *--sp; sp[-1] = sp[-1] == b;
+                CORTH_NEXT();
+            CORTH_OP(LT):
+                b = *--sp; sp[-1] = static_cast<int64_t>(sp[-1]) < static_cast<int64_t>(b);
+                CORTH_NEXT();
+            CORTH_OP(GT):
+                b = *--sp; sp[-1] = static_cast<int64_t>(sp[-1]) > static_cast<int64_t>(b);
+                CORTH_NEXT();
+            CORTH_OP(LE):
+                b = *--sp; sp[-1] = static_cast<int64_t>(sp[-1]) <= static_cast<int64_t>(b);
+                CORTH_NEXT();
+            CORTH_OP(GE):
+                b = *--sp; sp[-1] = static_cast<int64_t>(sp[-1]) >= static_cast<int64_t>(b);
+                CORTH_NEXT();
+            CORTH_OP(SHL):
+                // x86 masks the shift count of a 64-bit shift to six bits.
+                b = *--sp; sp[-1] <<= (b & 63);
+                CORTH_NEXT();
+            CORTH_OP(SHR):
+                b = *--sp; sp[-1] >>= (b & 63);
+                CORTH_NEXT();
+            CORTH_OP(OR):
+                b = *--sp; sp[-1] |= b;
+                CORTH_NEXT();
+            CORTH_OP(AND):
+                b = *--sp; sp[-1] &= b;
+                CORTH_NEXT();
+            CORTH_OP(JMP):
+                ip = code + cur->operand;
+                CORTH_NEXT();
+            CORTH_OP(JMP_IF_ZERO):
+                if (*--sp == 0) { ip = code + cur->operand; }
+                CORTH_NEXT();
+            CORTH_OP(DUP):
+                a = sp[-1];
+                CORTH_PUSH(a);
+                CORTH_NEXT();
+            CORTH_OP(TWODUP):
+                a = sp[-2];
+                b = sp[-1];
+                CORTH_PUSH(a);
+                CORTH_PUSH(b);
+                CORTH_NEXT();
+            CORTH_OP(DROP):
+                --sp;
+                CORTH_NEXT();
+            CORTH_OP(SWAP):
+                a = sp[-2]; sp[-2] = sp[-1]; sp[-1] = a;
+                CORTH_NEXT();
+            CORTH_OP(OVER):
+                a = sp[-2];
+                CORTH_PUSH(a);
+                CORTH_NEXT();
+            CORTH_OP(DUMP):
+                printf("%u", static_cast<unsigned int>(*--sp));
+                CORTH_NEXT();
+            CORTH_OP(DUMP_C):
+                printf("%c", static_cast<int>(*--sp));
+                CORTH_NEXT();
+            CORTH_OP(DUMP_S):
+                printf("%s", reinterpret_cast<const char*>(*--sp));
+                CORTH_NEXT();
+            CORTH_OP(MEM):
+                CORTH_PUSH(reinterpret_cast<uint64_t>(mem.get()));
+                CORTH_NEXT();
+            CORTH_OP(LOADB):
+                sp[-1] = *reinterpret_cast<uint8_t*>(sp[-1]);
+                CORTH_NEXT();
+            CORTH_OP(STOREB):
+                b = *--sp; a = *--sp;
+                *reinterpret_cast<uint8_t*>(a) = static_cast<uint8_t>(b);
+                CORTH_NEXT();
+            CORTH_OP(LOADW):
+                { uint16_t w; memcpy(&w, reinterpret_cast<void*>(sp[-1]), sizeof(w)); sp[-1] = w; }
+                CORTH_NEXT();
+            CORTH_OP(STOREW):
+                b = *--sp; a = *--sp;
+                { uint16_t w = static_cast<uint16_t>(b); memcpy(reinterpret_cast<void*>(a), &w, sizeof(w)); }
+                CORTH_NEXT();
+            CORTH_OP(LOADD):
+                { uint32_t d; memcpy(&d, reinterpret_cast<void*>(sp[-1]), sizeof(d)); sp[-1] = d; }
+                CORTH_NEXT();
+            CORTH_OP(STORED):
+                b = *--sp; a = *--sp;
+                { uint32_t d = static_cast<uint32_t>(b); memcpy(reinterpret_cast<void*>(a), &d, sizeof(d)); }
+                CORTH_NEXT();
+            CORTH_OP(LOADQ):
+                { uint64_t q; memcpy(&q, reinterpret_cast<void*>(sp[-1]), sizeof(q)); sp[-1] = q; }
+                CORTH_NEXT();
+            CORTH_OP(STOREQ):
+                b = *--sp; a = *--sp;
+                memcpy(reinterpret_cast<void*>(a), &b, sizeof(b));
+                CORTH_NEXT();
+            CORTH_OP(OPEN_FILE):
+                b = *--sp;
+                sp[-1] = reinterpret_cast<uint64_t>(fopen(reinterpret_cast<const char*>(sp[-1]),
+                                                          reinterpret_cast<const char*>(b)));
+                CORTH_NEXT();
+            CORTH_OP(WRITE_TO_FILE):
+                // [content string][bytes per character][number of characters][file pointer]
+                sp -= 4;
+                fwrite(reinterpret_cast<const void*>(sp[0]), sp[1], sp[2], reinterpret_cast<FILE*>(sp[3]));
+                CORTH_NEXT();
+            CORTH_OP(READ_FILE):
+                // [buffer][bytes per item][number of items][file pointer] -> [number of items read]
+                sp -= 3;
+                sp[-1] = fread(reinterpret_cast<void*>(sp[-1]), sp[0], sp[1], reinterpret_cast<FILE*>(sp[2]));
+                CORTH_NEXT();
+            CORTH_OP(READ_BLOCK):
+                // [buffer][max bytes][file pointer] -> [bytes read]; the operand is the block size.
+                sp -= 2;
+                sp[-1] = fread(reinterpret_cast<void*>(sp[-1]), 1, std::min(sp[0], cur->operand), reinterpret_cast<FILE*>(sp[1]));
+                CORTH_NEXT();
+            CORTH_OP(CLOSE_FILE):
+                fclose(reinterpret_cast<FILE*>(*--sp));
+                CORTH_NEXT();
+            CORTH_OP(LENGTH_S):
+                sp[-1] = strlen(reinterpret_cast<const char*>(sp[-1]));
+                CORTH_NEXT();
+            CORTH_OP(MEM_GROW):
+                // All of `mem` is allocated up front; pages are only committed once touched.
+                sp[-1] = sp[-1] <= ctx.MEM_SIZE;
+                CORTH_NEXT();
+            CORTH_OP(MAP_FILE):
+                // [path][mode] -> [addr][length]
+                {
+                    const char* mode = reinterpret_cast<const char*>(sp[-1]);
+                    MapFile(reinterpret_cast<const char*>(sp[-2]), mode[0] != 'r' || mode[1] == '+', sp[-2], sp[-1]);
+                }
+                CORTH_NEXT();
+            CORTH_OP(UNMAP_FILE):
+                sp -= 2;
+                UnmapFile(sp[0], sp[1]);
+                CORTH_NEXT();
+            CORTH_OP(MAP_ADVISE):
+                sp -= 3;
+                AdviseMapping(sp[0], sp[1], sp[2]);
+                CORTH_NEXT();
+            CORTH_OP(ASYNC_READ):
+                // [buffer][length][offset][file pointer] -> [request]
+                sp -= 3;
+                a = async_next++;
+                async_request_ids[a & (ASYNC_QUEUE_DEPTH - 1)] = a;
+                async_requests[a & (ASYNC_QUEUE_DEPTH - 1)] = std::async(std::launch::async, TransferAt,
+                    false, sp[-1], sp[0], sp[1], reinterpret_cast<FILE*>(sp[2]));
+                sp[-1] = a;
+                CORTH_NEXT();
+            CORTH_OP(ASYNC_WRITE):
+                sp -= 3;
+                a = async_next++;
+                async_request_ids[a & (ASYNC_QUEUE_DEPTH - 1)] = a;
+                async_requests[a & (ASYNC_QUEUE_DEPTH - 1)] = std::async(std::launch::async, TransferAt,
+                    true, sp[-1], sp[0], sp[1], reinterpret_cast<FILE*>(sp[2]));
+                sp[-1] = a;
+                CORTH_NEXT();
+            CORTH_OP(ASYNC_WAIT):
+                {
+                    std::future<uint64_t>& request = async_requests[sp[-1] & (ASYNC_QUEUE_DEPTH - 1)];
+                    bool in_flight = request.valid() && async_request_ids[sp[-1] & (ASYNC_QUEUE_DEPTH - 1)] == sp[-1];
+                    sp[-1] = in_flight ? request.get() : 0;
+                }
+                CORTH_NEXT();
+            CORTH_OP(MEM_FILL):
+                sp -= 3;
+                memset(reinterpret_cast<void*>(sp[0]), static_cast<int>(sp[1]), sp[2]);
+                CORTH_NEXT();
+            CORTH_OP(MEM_COPY):
+                sp -= 3;
+                memmove(reinterpret_cast<void*>(sp[0]), reinterpret_cast<const void*>(sp[1]), sp[2]);
+                CORTH_NEXT();
+            CORTH_OP(MEM_COMPARE):
+                {
+                    sp -= 2;
+                    const uint8_t* first = reinterpret_cast<const uint8_t*>(sp[-1]);
+                    sp[-1] = std::mismatch(first, first + sp[1], reinterpret_cast<const uint8_t*>(sp[0])).first - first;
+                }
+                CORTH_NEXT();
+            CORTH_OP(MEM_FIND_BYTE):
+                {
+                    sp -= 2;
+                    const uint8_t* first = reinterpret_cast<const uint8_t*>(sp[-1]);
+                    const void* match = memchr(first, static_cast<int>(sp[1] & 0xff), sp[0]);
+                    sp[-1] = match ? static_cast<const uint8_t*>(match) - first : sp[0];
+                }
+                CORTH_NEXT();
+            CORTH_OP(MEM_FIND_ANY):
+                {
+                    sp -= 2;
+                    const uint8_t* first = reinterpret_cast<const uint8_t*>(sp[-1]);
+                    const uint8_t* set = reinterpret_cast<const uint8_t*>(sp[1]);
+                    sp[-1] = std::find_first_of(first, first + sp[0], set, set + strlen(reinterpret_cast<const char*>(set))) - first;
+                }
+                CORTH_NEXT();
+            CORTH_OP(POPCNT):
+                sp[-1] = PopCount(sp[-1]);
+                CORTH_NEXT();
+            CORTH_OP(LZCNT):
+                sp[-1] = LeadingZeros(sp[-1]);
+                CORTH_NEXT();
+            CORTH_OP(TZCNT):
+                sp[-1] = TrailingZeros(sp[-1]);
+                CORTH_NEXT();
+            CORTH_OP(BSWAP):
+                sp[-1] = ByteSwap(sp[-1]);
+                CORTH_NEXT();
+            CORTH_OP(ROL):
+                b = *--sp & 63; sp[-1] = b ? sp[-1] << b | sp[-1] >> (64 - b) : sp[-1];
+                CORTH_NEXT();
+            CORTH_OP(ROR):
+                b = *--sp & 63; sp[-1] = b ? sp[-1] >> b | sp[-1] << (64 - b) : sp[-1];
+                CORTH_NEXT();
+            CORTH_OP(PEXT):
+                b = *--sp; sp[-1] = ExtractBits(sp[-1], b);
+                CORTH_NEXT();
+            CORTH_OP(PDEP):
+                b = *--sp; sp[-1] = DepositBits(sp[-1], b);
+                CORTH_NEXT();
+            CORTH_OP(HALT):
+                goto halt;
+        #if !defined(__GNUC__) && !defined(__clang__)
+            default:
+                Error("UNREACHABLE in Interpret");
+                return false;
+            }
+        }
+        #endif
+
+        #undef CORTH_OP
+        #undef CORTH_NEXT
+        #undef CORTH_PUSH
+
+    stack_overflow:
+        Error("Interpreter: stack overflow (capacity is "
+              + std::to_string(INTERPRETER_STACK_CAPACITY) + " values)");
+        return false;
+
+    halt:
+        fflush(stdout);
+        if (ctx.verbose_logging) {
+            Log("Interpreter halted with " + std::to_string(sp - stack_base) + " value(s) left on the stack");
+        }
+        return true;
+    }
+
+    bool Interpret(Context& ctx, Bytecode& bc) {
+        #ifdef __linux__
+        // String literals are read-only, like in a compiled program.
+        size_t pool_size = bc.string_pool.size();
+        void* pool = mmap(nullptr, pool_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pool != MAP_FAILED) {
+            memcpy(pool, bc.string_pool.data(), pool_size);
+            mprotect(pool, pool_size, PROT_READ);
+            bool success = Interpret(ctx, bc.code.data(), bc.code.size(), static_cast<char*>(pool));
+            munmap(pool, pool_size);
+            return success;
+        }
+        #endif
+        return Interpret(ctx, bc.code.data(), bc.code.size(), &bc.string_pool[0]);
+    }
+
+    /* Precompiled bytecode (`.corthc`) file layout, all integers little-endian:
+         BytecodeFileHeader
+         code:        `code_size` bytes; each instruction is one opcode byte,
+                        followed by its operand as an unsigned LEB128 varint
+                        if the opcode takes one (jump operands are already
+                        resolved to instruction indices).
+         string pool: `string_pool_size` bytes of null-terminated strings.
+    */
+    const char BYTECODE_MAGIC[8] = { 'C', 'O', 'R', 'T', 'H', 'C', '\0', '\0' };
+    // This needs to be changed whenever opcodes are added, removed, or re-ordered.
+    const uint32_t BYTECODE_VERSION = 11;
+
+    struct BytecodeFileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t instruction_count;
+        uint64_t code_size;
+        uint64_t string_pool_size;
+        // `-mem-size` the program was compiled with; it is run with as much `mem`.
+        uint64_t mem_size;
+    };
+
+    bool OpCodeHasOperand(OpCode op) {
+        return op == OpCode::PUSH_INT
+            || op == OpCode::PUSH_STR
+            || op == OpCode::JMP
+            || op == OpCode::JMP_IF_ZERO
+            || op == OpCode::READ_BLOCK;
+    }
+
+    // Decode the instruction stream of a `.corthc` file, checking its structure: the header,
+    //   the opcodes, operand encoding, jump targets and string offsets. That rejects truncated
+    //   and most corrupt files, but not a well-formed program that misbehaves: stack effects and
+    //   memory accesses are not checked (as `-bc` output was validated when it was written),
+    //   so running an untrusted or tampered file can still underflow the stack or crash Corth.
+    bool DecodeBytecode(const uint8_t* data, size_t size, std::vector<Instruction>& code) {
+        BytecodeFileHeader header;
+        if (size < sizeof(header)) {
+            Error("Bytecode file is too small to contain a header");
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, BYTECODE_MAGIC, sizeof(header.magic)) != 0) {
+            Error("Not a Corth bytecode file (bad magic)");
+            return false;
+        }
+        if (header.version != BYTECODE_VERSION) {
+            Error("Bytecode version " + std::to_string(header.version)
+                  + " is not supported by this Corth (expected version "
+                  + std::to_string(BYTECODE_VERSION) + "); regenerate it with `-bc`");
+            return false;
+        }
+        if (header.code_size > size - sizeof(header)
+            || header.string_pool_size != size - sizeof(header) - header.code_size
+            || header.instruction_count > header.code_size
+            || header.string_pool_size == 0
+            || header.mem_size == 0
+            || data[size - 1] != '\0')
+        {
+            Error("Bytecode file is truncated or corrupt");
+            return false;
+        }
+
+        const uint8_t* it = data + sizeof(header);
+        const uint8_t* end = it + header.code_size;
+        code.reserve(header.instruction_count);
+        while (it < end) {
+            Instruction instr;
+            if (*it >= static_cast<uint8_t>(OpCode::COUNT)) {
+                Error("Invalid opcode in bytecode file");
+                return false;
+            }
+            instr.op = static_cast<OpCode>(*it++);
+            instr.operand = 0;
+            if (OpCodeHasOperand(instr.op)) {
+                unsigned shift = 0;
+                uint8_t byte = 0x80;
+                while (byte & 0x80) {
+                    if (it == end || shift > 63) {
+                        Error("Malformed operand in bytecode file");
+                        return false;
+                    }
+                    byte = *it++;
+                    instr.operand |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                    shift += 7;
+                }
+            }
+            code.push_back(instr);
+        }
+
+        if (code.size() != header.instruction_count
+            || code.empty()
+            || code.back().op != OpCode::HALT)
+        {
+            Error("Bytecode file is truncated or corrupt");
+            return false;
+        }
+        for (auto& instr : code) {
+            if (((instr.op == OpCode::JMP || instr.op == OpCode::JMP_IF_ZERO)
+                 && instr.operand >= code.size())
+                || (instr.op == OpCode::PUSH_STR && instr.operand >= header.string_pool_size))
+            {
+                Error("Bytecode file contains an out-of-range operand");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool WriteBytecodeFile(Context& ctx, Bytecode& bc) {
+        std::string bc_file_path = ctx.OUTPUT_NAME + ".corthc";
+        std::ofstream bc_file(bc_file_path, std::ios::out | std::ios::binary);
+        if (!bc_file) {
+            Error("Could not open " + bc_file_path + " for writing. Does directory exist?");
+            return false;
+        }
+
+        std::string code;
+        code.reserve(bc.code.size() * 2);
+        for (auto& instr : bc.code) {
+            code.push_back(static_cast<char>(instr.op));
+            if (OpCodeHasOperand(instr.op)) {
+                uint64_t value = instr.operand;
+                do {
+                    uint8_t byte = value & 0x7f;
+                    value >>= 7;
+                    if (value != 0) { byte |= 0x80; }
+                    code.push_back(static_cast<char>(byte));
+                } while (value != 0);
+            }
+        }
+
+        BytecodeFileHeader header;
+        memcpy(header.magic, BYTECODE_MAGIC, sizeof(header.magic));
+        header.version = BYTECODE_VERSION;
+        header.flags = 0;
+        header.instruction_count = bc.code.size();
+        header.code_size = code.size();
+        header.string_pool_size = bc.string_pool.size();
+        header.mem_size = ctx.MEM_SIZE;
+
+        std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+        contents += code;
+        contents += bc.string_pool;
+
+        // Read the file back before writing it, so that an operand left out of the encoding
+        //   (see OpCodeHasOperand) fails here instead of changing what the program does.
+        std::vector<Instruction> decoded;
+        if (!DecodeBytecode(reinterpret_cast<const uint8_t*>(contents.data()), contents.size(), decoded)
+            || !std::equal(decoded.begin(), decoded.end(), bc.code.begin(), bc.code.end(),
+                           [](const Instruction& a, const Instruction& b) { return a.op == b.op && a.operand == b.operand; }))
+        {
+            Error("Bytecode did not survive a round trip through " + bc_file_path + "; this is a bug in Corth");
+            return false;
+        }
+
+        bc_file.write(contents.data(), contents.size());
+        bc_file.close();
+
+        Log("Bytecode written to " + bc_file_path + " ("
+            + std::to_string(contents.size()) + " bytes)");
+        return true;
+    }
+
+    // Run a precompiled `.corthc` file without lexing or validating anything.
+    // On Linux the file is memory-mapped read-only, so string literals are used straight
+    //   from the page cache and stay immutable like in a compiled program.
+    bool RunBytecodeFile(Context& ctx, std::string path) {
+        #ifdef __linux__
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            Error("Could not open bytecode file at " + path);
+            return false;
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+            close(fd);
+            Error("Could not read bytecode file at " + path);
+            return false;
+        }
+        size_t size = static_cast<size_t>(file_stat.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            Error("Could not map bytecode file at " + path);
+            return false;
+        }
+        uint8_t* data = static_cast<uint8_t*>(mapping);
+        #else
+        std::ifstream bc_file(path, std::ios::in | std::ios::binary);
+        if (!bc_file) {
+            Error("Could not open bytecode file at " + path);
+            return false;
+        }
+        std::string contents((std::istreambuf_iterator<char>(bc_file)), std::istreambuf_iterator<char>());
+        size_t size = contents.size();
+        uint8_t* data = reinterpret_cast<uint8_t*>(&contents[0]);
+        #endif
+
+        std::vector<Instruction> code;
+        bool success = DecodeBytecode(data, size, code);
+        if (success) {
+            if (ctx.verbose_logging) {
+                Log("Loaded " + std::to_string(code.size()) + " instructions from " + path);
+            }
+            const BytecodeFileHeader* header = reinterpret_cast<BytecodeFileHeader*>(data);
+            ctx.MEM_SIZE = header->mem_size;
+            char* string_pool = reinterpret_cast<char*>(data) + size - header->string_pool_size;
+            success = Interpret(ctx, code.data(), code.size(), string_pool);
+        }
+
+        #ifdef __linux__
+        munmap(mapping, size);
+        #endif
+        return success;
+    }
+}
+
+namespace Corth {
+    // Build cache
+    // Executables are stored under a hash of everything that could change them:
+    //   the source bytes, the target platform and syntax, the tools and their options,
+    //   and the version of Corth itself. Every option that changes generated code must be part of the key.
+    std::string ComputeCacheKey(Context& ctx, const std::string& source) {
+        uint64_t hash = 14695981039346656037ULL;
+        auto feed = [&hash](const std::string& data) {
+            for (unsigned char c : data) {
+                hash ^= c;
+                hash *= 1099511628211ULL;
+            }
+            // Separator, so that moving bytes between fields changes the hash.
+            hash ^= 0xff;
+            hash *= 1099511628211ULL;
+        };
+        feed(CORTH_VERSION);
+        feed(source);
+        feed(std::to_string(static_cast<int>(ctx.RUN_PLATFORM)));
+        feed(std::to_string(static_cast<int>(ctx.ASSEMBLY_SYNTAX)));
+        feed(ctx.ASMB_PATH);
+        feed(ctx.ASMB_OPTS);
+        feed(ctx.LINK_PATH);
+        feed(ctx.LINK_OPTS);
+        feed(ctx.debug_info ? "debug" : "");
+        // Debug info and profiled executables embed the absolute path of the source,
+        //   so the same file reached through another working directory is another executable.
+        if (ctx.debug_info || ctx.profile || ctx.sample || ctx.memtrace) {
+            feed(std::filesystem::absolute(ctx.SOURCE_PATH).string());
+        }
+        // Profiled executables also embed where they write the profile.
+        feed(ctx.profile ? ProfilePath(ctx) : "");
+        feed(ctx.sample ? SamplePath(ctx) : "");
+        feed(ctx.perfstat ? "perfstat" : "");
+        feed(std::to_string(ctx.MEM_SIZE) + (ctx.mem_mmap ? " mmap" : "") + (ctx.mem_huge ? " huge" : "") + (ctx.mem_populate ? " populate" : "") + (ctx.mem_grow ? " grow" : ""));
+        feed(ctx.memtrace ? MemTracePath(ctx) : "");
+        feed(std::to_string(ctx.READ_BLOCK_SIZE));
+        // With `native`, the features detected on this machine.
+        feed(std::to_string(ctx.TARGET_FEATURES));
+
+        static const char hex_digits[] = "0123456789abcdef";
+        std::string key;
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            key.push_back(hex_digits[(hash >> shift) & 15]);
+        }
+        return key;
+    }
+
+    // Path of the executable produced by the final tool (assembler or linker),
+    //   which is whatever it was told with `-o`, or the tool's default.
+    std::string GetExecutablePath(Context& ctx) {
+        static_assert(static_cast<int>(ASM_SYNTAX::COUNT) == 2,
+                      "Exhaustive handling of assembly syntaxes in GetExecutablePath");
+        bool final_tool_is_linker = ctx.ASSEMBLY_SYNTAX == ASM_SYNTAX::NASM;
+        std::string opts = final_tool_is_linker ? ctx.LINK_OPTS : ctx.ASMB_OPTS;
+        std::string output;
+        std::stringstream opts_ss(opts);
+        std::string opt;
+        while (opts_ss >> opt) {
+            if (opt == "-o") { opts_ss >> output; }
+            else if (opt.rfind("-o", 0) == 0 && opt.size() > 2) { output = opt.substr(2); }
+        }
+        if (!output.empty()) { return output; }
+        if (ctx.RUN_PLATFORM == PLATFORM::WIN64) {
+            // GoLink names the executable after the object file.
+            return final_tool_is_linker ? ctx.OUTPUT_NAME + ".exe" : "a.exe";
+        }
+        return "a.out";
+    }
+
+    struct CacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    CacheStats UpdateCacheStats(Context& ctx, bool hit) {
+        // Batch compilation workers share a single stats file, and so do separate Corth processes
+        //   using the same cache; both must not interleave their read-modify-write cycles.
+        static std::mutex stats_mutex;
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        std::filesystem::path stats_path = std::filesystem::path(ctx.CACHE_DIR) / "stats";
+        #ifdef __linux__
+        int lock_fd = open(stats_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock_fd >= 0) { flock(lock_fd, LOCK_EX); }
+        #endif
+        CacheStats stats;
+        std::ifstream stats_in(stats_path);
+        std::string name;
+        uint64_t value;
+        while (stats_in >> name >> value) {
+            if (name == "hits") { stats.hits = value; }
+            else if (name == "misses") { stats.misses = value; }
+        }
+        stats_in.close();
+        if (hit) { stats.hits++; }
+        else { stats.misses++; }
+        std::ofstream stats_out(stats_path, std::ios::out | std::ios::trunc);
+        stats_out << "hits " << stats.hits << '\n'
+                  << "misses " << stats.misses << '\n';
+        stats_out.close();
+        #ifdef __linux__
+        // Closing the descriptor releases the lock.
+        if (lock_fd >= 0) { close(lock_fd); }
+        #endif
+        return stats;
+    }
+
+    void LogCacheStats(bool hit, const CacheStats& stats) {
+        uint64_t total = stats.hits + stats.misses;
+        Log(std::string(hit ? "Build cache hit" : "Build cache miss")
+            + " (" + std::to_string(stats.hits) + " hits, "
+            + std::to_string(stats.misses) + " misses, "
+            + std::to_string(total ? stats.hits * 100 / total : 0) + "% hit rate)");
+    }
+
+    // Copy a cached executable to `exe_path` if one exists for `key`.
+    bool CacheLookup(Context& ctx, const std::string& key, const std::string& exe_path) {
+        std::error_code ec;
+        std::filesystem::create_directories(ctx.CACHE_DIR, ec);
+        std::filesystem::path entry = std::filesystem::path(ctx.CACHE_DIR) / key;
+        bool hit = std::filesystem::is_regular_file(entry, ec)
+            && std::filesystem::copy_file(entry, exe_path, std::filesystem::copy_options::overwrite_existing, ec);
+        if (hit) {
+            // Mark entry as recently used, for eviction.
+            std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), ec);
+        }
+        LogCacheStats(hit, UpdateCacheStats(ctx, hit));
+        return hit;
+    }
+
+    // Evict least recently used entries until the cache fits within CACHE_SIZE_LIMIT.
+    void TrimCache(Context& ctx) {
+        if (ctx.CACHE_SIZE_LIMIT == 0) { return; }
+        struct Entry {
+            std::filesystem::path path;
+            uint64_t size;
+            std::filesystem::file_time_type last_used;
+        };
+        std::vector<Entry> entries;
+        uint64_t total_size = 0;
+        std::error_code ec;
+        for (auto& file : std::filesystem::directory_iterator(ctx.CACHE_DIR, ec)) {
+            if (!file.is_regular_file(ec) || file.path().filename() == "stats") { continue; }
+            Entry entry { file.path(), file.file_size(ec), file.last_write_time(ec) };
+            total_size += entry.size;
+            entries.push_back(entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.last_used < b.last_used;
+        });
+        for (auto& entry : entries) {
+            if (total_size <= ctx.CACHE_SIZE_LIMIT) { break; }
+            if (std::filesystem::remove(entry.path, ec)) {
+                total_size -= entry.size;
+                if (ctx.verbose_logging) { Log("Evicted " + entry.path.string() + " from build cache"); }
             }
-            instr_ptr++;
         }
     }
-    
-    void ValidateTokens(Program& prog) {
-        // Stack protection
-        ValidateTokens_Stack(prog);
 
-        // Cross-reference blocks (give `if` tokens a reference to it's `endif` counterpart
-        ValidateTokens_Blocks(prog);
+    void CacheStore(Context& ctx, const std::string& key, const std::string& exe_path) {
+        std::error_code ec;
+        std::filesystem::path entry = std::filesystem::path(ctx.CACHE_DIR) / key;
+        // Copy then rename, so a concurrent lookup never sees a partially written entry.
+        std::filesystem::path temporary = entry;
+        temporary += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if (!std::filesystem::copy_file(exe_path, temporary, std::filesystem::copy_options::overwrite_existing, ec)) {
+            Warning("Could not store " + exe_path + " in build cache (" + ec.message() + ")");
+            return;
+        }
+        std::filesystem::rename(temporary, entry, ec);
+        if (ec) {
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+        if (ctx.verbose_logging) { Log("Stored " + exe_path + " in build cache as " + key); }
+        TrimCache(ctx);
+    }
 
-        // Remove all un-neccessary tokens
-        static_cast<void>(std::remove_if(prog.tokens.begin(), prog.tokens.end(), RemovableToken));
+    // Timing report
+    void PrintTimingReport(const Context& ctx) {
+        printf("\n[TIME]: %s\n", ctx.SOURCE_PATH.c_str());
+        printf("    %-24s %12s %14s\n", "Phase", "Wall time", "Peak RSS");
+        double total = 0;
+        for (auto& phase : ctx.stats.phases) {
+            printf("    %-24s %10.3f ms %10ld KiB%s\n", phase.name.c_str(), phase.seconds * 1000, phase.peak_rss_kb,
+                   phase.peak_rss_of_tool ? " (tool)" : "");
+            total += phase.seconds;
+        }
+        printf("    %-24s %10.3f ms\n", "Total", total * 1000);
+        printf("    Peak RSS is Corth's process peak so far, or that of the tool for `(tool)` phases.\n");
+        printf("    Tokens: %llu, String literals: %llu, Assembly bytes: %llu, Instructions: %llu\n",
+               (unsigned long long)ctx.stats.tokens,
+               (unsigned long long)ctx.stats.string_literals,
+               (unsigned long long)ctx.stats.asm_bytes,
+               (unsigned long long)ctx.stats.asm_instructions);
+    }
 
-        if (verbose_logging) { Log("Tokens validated"); }
+    std::string JsonString(const std::string& text) {
+        std::string json = "\"";
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') { json += '\\'; json += c; }
+            else if (c < 0x20) {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                json += escape;
+            }
+            else { json += c; }
+        }
+        return json + "\"";
+    }
+
+    // Write the timing report of every compilation as JSON, so that throughput can be tracked over time.
+    bool WriteTimingReport(const std::string& path, const std::vector<Context>& compilations) {
+        std::ofstream json(path, std::ios::out | std::ios::trunc);
+        if (!json) {
+            Error("Could not open timing report at " + path + " for writing");
+            return false;
+        }
+        json << "{\n  \"version\": " << JsonString(CORTH_VERSION) << ",\n  \"compilations\": [";
+        for (size_t i = 0; i < compilations.size(); i++) {
+            const Context& ctx = compilations[i];
+            json << (i ? "," : "") << "\n    {\n"
+                 << "      \"source\": " << JsonString(ctx.SOURCE_PATH) << ",\n"
+                 << "      \"phases\": [";
+            for (size_t j = 0; j < ctx.stats.phases.size(); j++) {
+                const PhaseTiming& phase = ctx.stats.phases[j];
+                json << (j ? "," : "") << "\n        { \"name\": " << JsonString(phase.name)
+                     << ", \"seconds\": " << phase.seconds
+                     << ", \"peak_rss_kb\": " << phase.peak_rss_kb
+                     << ", \"peak_rss_scope\": " << (phase.peak_rss_of_tool ? "\"tool\"" : "\"process_so_far\"") << " }";
+            }
+            json << "\n      ],\n"
+                 << "      \"counters\": {"
+                 << " \"tokens\": " << ctx.stats.tokens
+                 << ", \"string_literals\": " << ctx.stats.string_literals
+                 << ", \"asm_bytes\": " << ctx.stats.asm_bytes
+                 << ", \"asm_instructions\": " << ctx.stats.asm_instructions
+                 << " }\n    }";
+        }
+        json << "\n  ]\n}\n";
+        return true;
     }
 }
 
 // This function is my Windows version of the `where` cmd
-bool FileExists(std::string filePath) {
+// `ctx` is only used on Windows, to log every path that is tried.
+bool FileExists([[maybe_unused]] Corth::Context& ctx, std::string filePath) {
     // Check path relative Corth.exe
     std::ifstream file(filePath);
     if (file.is_open()) { file.close(); return true; }
@@ -2891,7 +8308,7 @@ bool FileExists(std::string filePath) {
     // Check each path in Windows PATH variable if file exists
     for (auto& path : path_var) {
         std::string test(path + filePath);
-        if (Corth::verbose_logging) { Corth::Log("Testing " + test); }
+        if (ctx.verbose_logging) { Corth::Log("Testing " + test); }
         std::ifstream f(test);
         if (f.is_open()) { f.close(); return true; }
     }
@@ -2932,60 +8349,380 @@ void printCharactersFromFile(std::string filePath, std::string logPrefix = "[LOG
     }
 }
 
-int main(int argc, char** argv) {
-    // PLATFORM SPECIFIC DEFAULTS
-    #ifdef _WIN64
-    // Defaults assume tools were installed on the same drive as Corth as well as in the root directory of the drive.
-    Corth::ASMB_PATH = "\\NASM\\nasm.exe";
-    Corth::ASMB_OPTS = "-f win64";
-    Corth::LINK_PATH = "\\Golink\\golink.exe";
-    Corth::LINK_OPTS = "/console /ENTRY:main msvcrt.dll";
-    #endif
+#ifdef __linux__
+// Split a string of command line options into separate arguments on whitespace.
+// Double quotes group words containing spaces, just like a shell would.
+std::vector<std::string> SplitCommandLine(const std::string& cmd) {
+    std::vector<std::string> args;
+    std::string current;
+    bool in_quotes = false;
+    bool has_arg = false;
+    for (char c : cmd) {
+        if (c == '"') {
+            in_quotes = !in_quotes;
+            has_arg = true;
+        }
+        else if (!in_quotes && (c == ' ' || c == '\t' || c == '\n')) {
+            if (has_arg) {
+                args.push_back(current);
+                current.clear();
+                has_arg = false;
+            }
+        }
+        else {
+            current.append(1, c);
+            has_arg = true;
+        }
+    }
+    if (has_arg) { args.push_back(current); }
+    return args;
+}
 
-    #ifdef __linux__
-    Corth::ASMB_PATH = "nasm";
-    Corth::ASMB_OPTS = "-f elf64";
-    Corth::LINK_PATH = "ld";
-    Corth::LINK_OPTS = "-dynamic-linker /lib64/ld-linux-x86-64.so.2 -lc -m elf_x86_64";
-    #endif
-    
-    if (!Corth::HandleCMDLineArgs(argc, argv)){
-        // Non-graceful handling of command line arguments, abort execution.
+std::string JoinCommandLine(const std::vector<std::string>& args) {
+    std::string cmd;
+    for (auto& arg : args) {
+        if (!cmd.empty()) { cmd.append(1, ' '); }
+        if (arg.find(' ') != std::string::npos) { cmd += '"' + arg + '"'; }
+        else { cmd += arg; }
+    }
+    return cmd;
+}
+
+// This function is my Linux version of the `which` cmd.
+// Returns the path to the executable, or an empty string if it can not be found.
+std::string FindExecutable(Corth::Context& ctx, const std::string& name) {
+    if (name.empty()) { return ""; }
+    // Paths are not looked up in PATH, same as a shell.
+    if (name.find('/') != std::string::npos) {
+        return access(name.c_str(), X_OK) == 0 ? name : "";
+    }
+    const char* path_var = getenv("PATH");
+    std::string paths = path_var ? path_var : "/usr/local/bin:/usr/bin:/bin";
+    size_t begin = 0;
+    while (begin <= paths.size()) {
+        size_t end = paths.find(':', begin);
+        if (end == std::string::npos) { end = paths.size(); }
+        std::string dir = paths.substr(begin, end - begin);
+        // An empty PATH entry means the current directory.
+        std::string candidate = (dir.empty() ? "." : dir) + "/" + name;
+        if (ctx.verbose_logging) { Corth::Log("Testing " + candidate); }
+        struct stat file_stat;
+        if (stat(candidate.c_str(), &file_stat) == 0
+            && S_ISREG(file_stat.st_mode)
+            && access(candidate.c_str(), X_OK) == 0)
+        {
+            return candidate;
+        }
+        begin = end + 1;
+    }
+    return "";
+}
+
+// Run a program directly (no shell), capturing everything it writes to
+//   stdout and stderr into `output`.
+// Returns the exit code of the program, or -1 if it could not be run.
+// If `peak_rss_kb` is given, it receives the peak memory usage of the program in KiB.
+int RunCommand(const std::vector<std::string>& args, std::string& output, long* peak_rss_kb = nullptr) {
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        Corth::Error("Could not create pipe to capture command output");
         return -1;
     }
-    
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDERR_FILENO);
+
+    std::vector<char*> argv;
+    for (auto& arg : args) { argv.push_back(const_cast<char*>(arg.c_str())); }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int spawn_result = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fds[1]);
+    if (spawn_result != 0) {
+        close(pipe_fds[0]);
+        Corth::Error("Could not run " + args[0] + " (" + strerror(spawn_result) + ")");
+        return -1;
+    }
+
+    char buffer[16384];
+    for (;;) {
+        ssize_t bytes_read = read(pipe_fds[0], buffer, sizeof(buffer));
+        if (bytes_read > 0) { output.append(buffer, bytes_read); }
+        else if (bytes_read == 0 || errno != EINTR) { break; }
+    }
+    close(pipe_fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) { return -1; }
+    }
+    if (peak_rss_kb) { *peak_rss_kb = usage.ru_maxrss; }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// A minimal output stream buffer that writes into a file descriptor (i.e. a pipe).
+class FdOutputBuffer : public std::streambuf {
+public:
+    explicit FdOutputBuffer(int fd) : fd(fd) {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+    ~FdOutputBuffer() { sync(); }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (flush_buffer() != 0) { return traits_type::eof(); }
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override { return flush_buffer(); }
+
+private:
+    int flush_buffer() {
+        const char* it = pbase();
+        while (it < pptr()) {
+            ssize_t written = write(fd, it, pptr() - it);
+            if (written < 0) {
+                if (errno == EINTR) { continue; }
+                return -1;
+            }
+            it += written;
+        }
+        setp(buffer, buffer + sizeof(buffer));
+        return 0;
+    }
+
+    int fd;
+    char buffer[65536];
+};
+
+// Same as RunCommand, but the program's stdin is a pipe that `write_input` writes into.
+// The program runs concurrently with `write_input`; its output is drained on a
+//   separate thread so that neither side can block the other on a full pipe.
+int RunCommandWithInput(const std::vector<std::string>& args,
+                        const std::function<void(std::ostream&)>& write_input,
+                        std::string& output,
+                        long* peak_rss_kb = nullptr)
+{
+    int input_fds[2];
+    int output_fds[2];
+    if (pipe2(input_fds, O_CLOEXEC) != 0) {
+        Corth::Error("Could not create pipe to stream command input");
+        return -1;
+    }
+    if (pipe2(output_fds, O_CLOEXEC) != 0) {
+        close(input_fds[0]);
+        close(input_fds[1]);
+        Corth::Error("Could not create pipe to capture command output");
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input_fds[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output_fds[1], STDERR_FILENO);
+
+    std::vector<char*> argv;
+    for (auto& arg : args) { argv.push_back(const_cast<char*>(arg.c_str())); }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    int spawn_result = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(input_fds[0]);
+    close(output_fds[1]);
+    if (spawn_result != 0) {
+        close(input_fds[1]);
+        close(output_fds[0]);
+        Corth::Error("Could not run " + args[0] + " (" + strerror(spawn_result) + ")");
+        return -1;
+    }
+
+    std::thread drain([&output, fd = output_fds[0]]() {
+        char buffer[16384];
+        for (;;) {
+            ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+            if (bytes_read > 0) { output.append(buffer, bytes_read); }
+            else if (bytes_read == 0 || errno != EINTR) { break; }
+        }
+    });
+
+    // SIGPIPE is ignored in main, so if the program exits early writing to the pipe fails instead of killing Corth.
+    {
+        FdOutputBuffer input_buffer(input_fds[1]);
+        std::ostream input(&input_buffer);
+        write_input(input);
+        input.flush();
+    }
+    close(input_fds[1]);
+
+    drain.join();
+    close(output_fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) { return -1; }
+    }
+    if (peak_rss_kb) { *peak_rss_kb = usage.ru_maxrss; }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void printCommandOutput(const std::string& output, std::string logPrefix = "[LOG]") {
+    // Don't print if there was no output
+    if (!output.empty()) {
+        printf("\n%s:\n%s", logPrefix.c_str(), output.c_str());
+    }
+}
+#endif
+
+// Run a single compilation of SOURCE_PATH through to the requested output.
+int Compile(Corth::Context& ctx) {
     Corth::Program prog;
 
-    static_assert(static_cast<int>(Corth::MODE::COUNT) == 2,
-                  "Exhaustive handling of modes in main method");
+    static_assert(static_cast<int>(Corth::MODE::COUNT) == 4,
+                  "Exhaustive handling of modes in Compile");
     static_assert(static_cast<int>(Corth::PLATFORM::COUNT) == 2,
-                  "Exhaustive handling of platforms in main method");
+                  "Exhaustive handling of platforms in Compile");
     static_assert(static_cast<int>(Corth::ASM_SYNTAX::COUNT) == 2,
-                  "Exhaustive handling of assembly syntaxes in main method");
+                  "Exhaustive handling of assembly syntaxes in Compile");
+
+    if (ctx.debug_info) {
+        if (ctx.RUN_MODE == Corth::MODE::INTERPRET || ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+            Corth::Warning("`-g` only affects generated assembly; ignoring it");
+            ctx.debug_info = false;
+        }
+        else if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64) {
+            Corth::Error("`-g` is only supported when generating assembly for Linux");
+            return -1;
+        }
+    }
+    if ((ctx.mem_mmap || ctx.mem_huge || ctx.mem_populate || ctx.mem_grow) && ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64
+        && ctx.RUN_MODE != Corth::MODE::INTERPRET && ctx.RUN_MODE != Corth::MODE::BYTECODE) {
+        Corth::Error("`-mem-mmap`, `-mem-huge`, `-mem-populate` and `-mem-grow` are only supported when generating assembly for Linux");
+        return -1;
+    }
+    if (ctx.mem_grow && ctx.mem_populate) {
+        Corth::Error("`-mem-grow` commits `mem` as it is used, so it can't be combined with `-mem-populate`");
+        return -1;
+    }
+    if (ctx.MEM_SIZE > Corth::MEM_BSS_LIMIT && ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64
+        && ctx.RUN_MODE != Corth::MODE::INTERPRET && ctx.RUN_MODE != Corth::MODE::BYTECODE) {
+        Corth::Error("`mem` can be at most 1G when generating assembly for Windows");
+        return -1;
+    }
+    if (ctx.memtrace) {
+        if (ctx.RUN_MODE == Corth::MODE::INTERPRET || ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+            Corth::Warning("`-memtrace` only affects generated assembly; ignoring it");
+            ctx.memtrace = false;
+        }
+        else if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64) {
+            Corth::Error("`-memtrace` is only supported when generating assembly for Linux");
+            return -1;
+        }
+    }
+    if (ctx.perfstat) {
+        if (ctx.RUN_MODE == Corth::MODE::INTERPRET || ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+            Corth::Warning("`-perfstat` only affects generated assembly; ignoring it");
+            ctx.perfstat = false;
+        }
+        else if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64) {
+            Corth::Error("`-perfstat` is only supported when generating assembly for Linux");
+            return -1;
+        }
+    }
+    if (ctx.sample) {
+        if (ctx.RUN_MODE == Corth::MODE::INTERPRET || ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+            Corth::Warning("`-sample` only affects generated assembly; ignoring it");
+            ctx.sample = false;
+        }
+        else if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64) {
+            Corth::Error("`-sample` is only supported when generating assembly for Linux");
+            return -1;
+        }
+    }
+    if (ctx.TARGET_FEATURES) {
+        if (ctx.RUN_MODE == Corth::MODE::INTERPRET || ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+            Corth::Warning("`-march` only affects generated assembly; ignoring it");
+            ctx.TARGET_FEATURES = 0;
+        }
+        else if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64) {
+            Corth::Warning("`-march` only affects generated assembly for Linux; ignoring it");
+            ctx.TARGET_FEATURES = 0;
+        }
+    }
+    if (ctx.profile) {
+        if (ctx.RUN_MODE == Corth::MODE::INTERPRET || ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+            Corth::Warning("`-profile` only affects generated assembly; ignoring it");
+            ctx.profile = false;
+        }
+        else if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64) {
+            Corth::Error("`-profile` is only supported when generating assembly for Linux");
+            return -1;
+        }
+    }
+
+    // Precompiled bytecode skips the front end entirely.
+    if (ctx.SOURCE_PATH.size() > 7
+        && ctx.SOURCE_PATH.compare(ctx.SOURCE_PATH.size() - 7, 7, ".corthc") == 0)
+    {
+        return Corth::RunBytecodeFile(ctx, ctx.SOURCE_PATH) ? 0 : -1;
+    }
 
     // Try to load program source from a file
     try {
-        prog.source = loadFromFile(Corth::SOURCE_PATH);
-        if (Corth::verbose_logging) { Corth::Log("Load file: successful"); }
+        Corth::PhaseTimer timer(ctx, "loadFromFile");
+        prog.source = loadFromFile(ctx.SOURCE_PATH);
+        if (ctx.verbose_logging) { Corth::Log("Load file: successful"); }
     }
     catch (std::runtime_error e) {
         Corth::Error("Could not load source file!", e);
         return -1;
     }
     catch (...) {
-        Corth::Error(("Could not load source file at " + Corth::SOURCE_PATH));
+        Corth::Error(("Could not load source file at " + ctx.SOURCE_PATH));
         return -1;
     }
 
+    // A cache hit skips lexing, validation, code generation, and the external tools.
+    bool use_cache = !ctx.CACHE_DIR.empty() && ctx.RUN_MODE == Corth::MODE::COMPILE;
+    std::string cache_key;
+    if (use_cache) {
+        cache_key = Corth::ComputeCacheKey(ctx, prog.source);
+        if (Corth::CacheLookup(ctx, cache_key, Corth::GetExecutablePath(ctx))) {
+            Corth::Log("Executable restored from build cache at " + Corth::GetExecutablePath(ctx));
+            return 0;
+        }
+    }
+    // Set once the final tool (assembler or linker) produced an executable.
+    bool build_successful = false;
+
     // Lex program source into tokens
-    bool lexSuccessful = Corth::Lex(prog);
+    bool lexSuccessful = false;
+    {
+        Corth::PhaseTimer timer(ctx, "Lex");
+        lexSuccessful = Corth::Lex(prog);
+    }
+    ctx.stats.tokens = prog.tokens.size();
+    ctx.stats.string_literals = std::count_if(prog.tokens.begin(), prog.tokens.end(), [](const Corth::Token& tok) {
+        return tok.type == Corth::TokenType::STRING;
+    });
     if (lexSuccessful) {
-		if (Corth::verbose_logging) {
+		if (ctx.verbose_logging) {
 			Corth::Log("Lexed file into tokens");
 			Corth::PrintTokens(prog);
 		}
-        Corth::ValidateTokens(prog);
-        if (Corth::verbose_logging) {
+        Corth::ValidateTokens(ctx, prog);
+        if (ctx.verbose_logging) {
             Corth::PrintTokens(prog);
         }
     }
@@ -2994,27 +8731,63 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    if (Corth::RUN_MODE == Corth::MODE::GENERATE) {
-        if (Corth::RUN_PLATFORM == Corth::PLATFORM::WIN64) {
+    if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64 && Corth::MapsFiles(prog)
+        && ctx.RUN_MODE != Corth::MODE::INTERPRET && ctx.RUN_MODE != Corth::MODE::BYTECODE) {
+        Corth::Error("`map_file`, `unmap_file` and `map_advise` are only supported when generating assembly for Linux");
+        return -1;
+    }
+    if (ctx.RUN_PLATFORM != Corth::PLATFORM::LINUX64 && Corth::UsesAsyncIO(prog)
+        && ctx.RUN_MODE != Corth::MODE::INTERPRET && ctx.RUN_MODE != Corth::MODE::BYTECODE) {
+        Corth::Error("`async_read`, `async_write` and `async_wait` are only supported when generating assembly for Linux");
+        return -1;
+    }
+
+    if (ctx.RUN_MODE == Corth::MODE::INTERPRET) {
+        Corth::Bytecode bc;
+        bool bytecode_generated = false;
+        {
+            Corth::PhaseTimer timer(ctx, "GenerateBytecode");
+            bytecode_generated = Corth::GenerateBytecode(ctx, prog, bc);
+        }
+        if (!bytecode_generated) {
+            Corth::Error("Failure when decoding tokens into bytecode");
+            return -1;
+        }
+        Corth::PhaseTimer timer(ctx, "Interpret");
+        if (!Corth::Interpret(ctx, bc)) {
+            return -1;
+        }
+    }
+    else if (ctx.RUN_MODE == Corth::MODE::BYTECODE) {
+        Corth::Bytecode bc;
+        Corth::PhaseTimer timer(ctx, "GenerateBytecode");
+        if (!Corth::GenerateBytecode(ctx, prog, bc)) {
+            Corth::Error("Failure when decoding tokens into bytecode");
+            return -1;
+        }
+        if (!Corth::WriteBytecodeFile(ctx, bc)) { return -1; }
+    }
+    else if (ctx.RUN_MODE == Corth::MODE::GENERATE) {
+        if (ctx.RUN_PLATFORM == Corth::PLATFORM::WIN64) {
             #ifdef _WIN64
-            if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
-                Corth::GenerateAssembly_NASM_win64(prog);
+            if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
+                if (!Corth::GenerateAssembly_NASM_win64(ctx, prog)) { return -1; }
             }
-            else if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
-                Corth::GenerateAssembly_GAS_win64(prog);
+            else if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
+                if (!Corth::GenerateAssembly_GAS_win64(ctx, prog)) { return -1; }
             }
             #else
             Corth::Error("_WIN64 is undefined; specify the correct platform with a cmd-line flag");
             return -1;
             #endif
         }
-        else if (Corth::RUN_PLATFORM == Corth::PLATFORM::LINUX64) {
+        else if (ctx.RUN_PLATFORM == Corth::PLATFORM::LINUX64) {
             #ifdef __linux__
-            if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
-                Corth::GenerateAssembly_NASM_linux64(prog);
+            if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
+                if (!Corth::GenerateAssembly_NASM_linux64(ctx, prog)) { return -1; }
             }
-            else if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
-                Corth::GenerateAssembly_GAS_linux64(prog);
+            else if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
+                if (!Corth::GenerateAssembly_GAS_linux64(ctx, prog)) { return -1; }
             }
             #else
             Corth::Error("__linux__ is undefined. Incorrect platform selected using cmd-line flags?");
@@ -3022,58 +8795,69 @@ int main(int argc, char** argv) {
             #endif
         }
     }
-    else if (Corth::RUN_MODE == Corth::MODE::COMPILE) {
-        if (Corth::RUN_PLATFORM == Corth::PLATFORM::WIN64) {
+    else if (ctx.RUN_MODE == Corth::MODE::COMPILE) {
+        if (ctx.RUN_PLATFORM == Corth::PLATFORM::WIN64) {
             #ifdef _WIN64
-            if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
-                Corth::GenerateAssembly_GAS_win64(prog);
-                if (FileExists(Corth::ASMB_PATH)) {
+            if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
+                if (!Corth::GenerateAssembly_GAS_win64(ctx, prog)) { return -1; }
+                if (FileExists(ctx, ctx.ASMB_PATH)) {
                     /* Construct Commands
-                       Assembly is generated at `Corth::OUTPUT_NAME.s` */
+                       Assembly is generated at `OUTPUT_NAME.s` */
                         
-                    std::string cmd_asmb = Corth::ASMB_PATH + " "
-                        + Corth::ASMB_OPTS + " "
-                        + Corth::OUTPUT_NAME + ".s "
+                    std::string cmd_asmb = ctx.ASMB_PATH + " "
+                        + ctx.ASMB_OPTS + " "
+                        + ctx.OUTPUT_NAME + ".s "
                         + ">assembler-log.txt 2>&1";
         
                     printf("[CMD]: `%s`\n", cmd_asmb.c_str());
-                    if (system(cmd_asmb.c_str()) == 0) {
+                    int asmb_result = -1;
+                    {
+                        Corth::PhaseTimer timer(ctx, "Assembler");
+                        asmb_result = system(cmd_asmb.c_str());
+                    }
+                    if (asmb_result == 0) {
                         Corth::Log("Assembler successful!");
+                        build_successful = true;
                     }
                     else {
                         Corth::Log("Assembler returned non-zero exit code, indicating a failure. Check `assembler-log.txt` for the output of the assembler, or enable verbose logging (`-v` flag) to print output to the console.");
                     }
 
-                    if (Corth::verbose_logging) {
+                    if (ctx.verbose_logging) {
                         printCharactersFromFile("assembler-log.txt", "Assembler Log");
                     }
                 }
                 else {
-                    Corth::Error("Assembler not found at " + Corth::ASMB_PATH + "\n");
+                    Corth::Error("Assembler not found at " + ctx.ASMB_PATH + "\n");
                     return -1;
                 }
             }
-            else if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
-                Corth::GenerateAssembly_NASM_win64(prog);
-                if (FileExists(Corth::ASMB_PATH)) {
-                    if (FileExists(Corth::LINK_PATH)) {
+            else if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
+                if (!Corth::GenerateAssembly_NASM_win64(ctx, prog)) { return -1; }
+                if (FileExists(ctx, ctx.ASMB_PATH)) {
+                    if (FileExists(ctx, ctx.LINK_PATH)) {
                         /* Construct Commands
-                           Assembly is generated at `Corth::OUTPUT_NAME.asm`
+                           Assembly is generated at `OUTPUT_NAME.asm`
                            By default on win64, NASM generates an output `.obj` file of the same name as the input file.
-                           This means the linker needs to link to `Corth::OUTPUT_NAME.obj` */
+                           This means the linker needs to link to `OUTPUT_NAME.obj` */
                         
-                        std::string cmd_asmb = Corth::ASMB_PATH + " "
-                            + Corth::ASMB_OPTS + " "
-                            + Corth::OUTPUT_NAME + ".asm "
+                        std::string cmd_asmb = ctx.ASMB_PATH + " "
+                            + ctx.ASMB_OPTS + " "
+                            + ctx.OUTPUT_NAME + ".asm "
                             + ">assembler-log.txt 2>&1";
                         
-                        std::string cmd_link = Corth::LINK_PATH + " "
-                            + Corth::LINK_OPTS + " "
-                            + Corth::OUTPUT_NAME + ".obj "
+                        std::string cmd_link = ctx.LINK_PATH + " "
+                            + ctx.LINK_OPTS + " "
+                            + ctx.OUTPUT_NAME + ".obj "
                             + ">linker-log.txt 2>&1";
         
                         printf("[CMD]: `%s`\n", cmd_asmb.c_str());
-                        if (system(cmd_asmb.c_str()) == 0) {
+                        int asmb_result = -1;
+                        {
+                            Corth::PhaseTimer timer(ctx, "Assembler");
+                            asmb_result = system(cmd_asmb.c_str());
+                        }
+                        if (asmb_result == 0) {
                             Corth::Log("Assembler successful!");
                         }
                         else {
@@ -3081,25 +8865,31 @@ int main(int argc, char** argv) {
                         }
 
                         printf("[CMD]: `%s`\n", cmd_link.c_str());
-                        if (system(cmd_link.c_str()) == 0) {
+                        int link_result = -1;
+                        {
+                            Corth::PhaseTimer timer(ctx, "Linker");
+                            link_result = system(cmd_link.c_str());
+                        }
+                        if (link_result == 0) {
                             Corth::Log("Linker successful!");
+                            build_successful = true;
                         }
                         else {
                             Corth::Log("Linker returned non-zero exit code, indicating a failure. Check `linker-log.txt` for the output of the linker, or enable verbose logging (`-v` flag) to print output to the console.");
                         }
 
-                        if (Corth::verbose_logging) {
+                        if (ctx.verbose_logging) {
                             printCharactersFromFile("assembler-log.txt", "Assembler Log");
                             printCharactersFromFile("linker-log.txt", "Linker Log");
                         }
                     }
                     else {
-                        Corth::Error("Linker not found at " + Corth::LINK_PATH + "\n");
+                        Corth::Error("Linker not found at " + ctx.LINK_PATH + "\n");
                         return -1;
                     }
                 }
                 else {
-                    Corth::Error("Assembler not found at " + Corth::ASMB_PATH + "\n");
+                    Corth::Error("Assembler not found at " + ctx.ASMB_PATH + "\n");
                     return -1;
                 }
             }
@@ -3108,84 +8898,137 @@ int main(int argc, char** argv) {
             return -1;
             #endif
         }
-        else if (Corth::RUN_PLATFORM == Corth::PLATFORM::LINUX64) {
+        else if (ctx.RUN_PLATFORM == Corth::PLATFORM::LINUX64) {
             #ifdef __linux__
-            if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
-                Corth::GenerateAssembly_GAS_linux64(prog);
-                if (!system(("which " + Corth::ASMB_PATH).c_str())) {
+            if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
+                if (!ctx.pipe_assembly) {
+                    if (!Corth::GenerateAssembly_GAS_linux64(ctx, prog)) { return -1; }
+                }
+                std::string asmb_path = FindExecutable(ctx, ctx.ASMB_PATH);
+                if (!asmb_path.empty()) {
                     /* Construct Commands
-                       Assembly is generated at `<Corth::OUTPUT_NAME>.s` */
-                    std::string cmd_asmb = Corth::ASMB_PATH + " "
-                        + Corth::ASMB_OPTS + " "
-                        + Corth::OUTPUT_NAME + ".s "
-                        + ">assembler-log.txt 2>&1";
-                        
-                    // TODO: Look into exec() family of functions
-                    printf("[CMD]: `%s`\n", cmd_asmb.c_str());
-                    if (system(cmd_asmb.c_str()) == 0) {
-                        Corth::Log("Assembler successful!");
+                       Assembly is generated at `<OUTPUT_NAME>.s`,
+                       or streamed into the assembler's stdin (`-`) when piping. */
+                    std::vector<std::string> cmd_asmb = SplitCommandLine(ctx.ASMB_OPTS);
+                    cmd_asmb.insert(cmd_asmb.begin(), asmb_path);
+                    if (ctx.pipe_assembly) {
+                        // A compiler driver (i.e. the default, gcc) can't guess the language of stdin.
+                        std::string asmb_name = asmb_path.substr(asmb_path.find_last_of('/') + 1);
+                        if (asmb_name != "as" && asmb_name.find("-as") == std::string::npos) {
+                            cmd_asmb.push_back("-x");
+                            cmd_asmb.push_back("assembler");
+                        }
+                        cmd_asmb.push_back("-");
                     }
                     else {
-                        Corth::Log("Assembler returned non-zero exit code, indicating a failure. Check `assembler-log.txt` for the output of the assembler, or enable verbose logging (`-v` flag) to print output to the console.");
+                        cmd_asmb.push_back(ctx.OUTPUT_NAME + ".s");
                     }
 
-                    if (Corth::verbose_logging) {
-                        printCharactersFromFile("assembler-log.txt", "Assembler Log");
+                    std::string asmb_log;
+                    printf("[CMD]: `%s`\n", JoinCommandLine(cmd_asmb).c_str());
+                    int asmb_result = -1;
+                    if (ctx.pipe_assembly) {
+                        Corth::Log("Streaming Linux x64 GAS assembly into the assembler");
+                        // Code generation runs while the assembler does, so it is timed as part of it.
+                        Corth::PhaseTimer timer(ctx, "Codegen + Assembler");
+                        asmb_result = RunCommandWithInput(cmd_asmb, [&ctx, &prog](std::ostream& asm_stream) {
+                            Corth::AsmStatsBuffer asm_stats(asm_stream.rdbuf(), ctx.stats);
+                            std::ostream counted_asm_stream(&asm_stats);
+                            Corth::WriteAssembly_GAS_linux64(ctx, prog, counted_asm_stream);
+                        }, asmb_log, &timer.peak_rss_kb);
+                    }
+                    else {
+                        Corth::PhaseTimer timer(ctx, "Assembler");
+                        asmb_result = RunCommand(cmd_asmb, asmb_log, &timer.peak_rss_kb);
+                    }
+                    if (asmb_result == 0) {
+                        Corth::Log("Assembler successful!");
+                        build_successful = true;
+                        if (ctx.verbose_logging) {
+                            printCommandOutput(asmb_log, "Assembler Log");
+                        }
+                    }
+                    else {
+                        Corth::Log("Assembler returned non-zero exit code, indicating a failure.");
+                        printCommandOutput(asmb_log, "Assembler Log");
                     }
                 }
                 else {
-                    Corth::Error("Assembler not found at " + Corth::ASMB_PATH + "\n");
+                    Corth::Error("Assembler not found at " + ctx.ASMB_PATH + "\n");
                     return -1;
                 }
             }
-            else if (Corth::ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
-                Corth::GenerateAssembly_NASM_linux64(prog);
-                if (!system(("which " + Corth::ASMB_PATH).c_str())) {
-                    if (!system(("which " + Corth::LINK_PATH).c_str())) {
+            else if (ctx.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::NASM) {
+                if (ctx.pipe_assembly) {
+                    // NASM re-opens its input file on every pass, so it can not read from a pipe or FIFO.
+                    Corth::Warning("NASM can not assemble from a pipe; generating an assembly file instead");
+                }
+                if (!Corth::GenerateAssembly_NASM_linux64(ctx, prog)) { return -1; }
+                std::string asmb_path = FindExecutable(ctx, ctx.ASMB_PATH);
+                if (!asmb_path.empty()) {
+                    std::string link_path = FindExecutable(ctx, ctx.LINK_PATH);
+                    if (!link_path.empty()) {
                         /* Construct Commands
-                           Assembly is generated at `<Corth::OUTPUT_NAME>.asm`
+                           Assembly is generated at `<OUTPUT_NAME>.asm`
                            By default on linux, NASM generates an output `.o` file of the same name as the input file
-                           This means the linker needs to link to `Corth::OUTPUT_NAME.o`
+                           This means the linker needs to link to `OUTPUT_NAME.o`
                         */
-                        std::string cmd_asmb = Corth::ASMB_PATH + " "
-                            + Corth::ASMB_OPTS + " "
-                            + Corth::OUTPUT_NAME + ".asm "
-                            + ">assembler-log.txt 2>&1";
-                        
-                        std::string cmd_link = Corth::LINK_PATH + " "
-                            + Corth::LINK_OPTS + " "
-                            + Corth::OUTPUT_NAME + ".o "
-                            + ">linker-log.txt 2>&1";
+                        std::vector<std::string> cmd_asmb = SplitCommandLine(ctx.ASMB_OPTS);
+                        cmd_asmb.insert(cmd_asmb.begin(), asmb_path);
+                        if (ctx.debug_info) {
+                            // Turn the `%line` directives into DWARF line information.
+                            cmd_asmb.insert(cmd_asmb.end(), { "-g", "-F", "dwarf" });
+                        }
+                        cmd_asmb.push_back(ctx.OUTPUT_NAME + ".asm");
 
-                        // TODO: Look into exec() family of functions
-                        printf("[CMD]: `%s`\n", cmd_asmb.c_str());
-                        if (system(cmd_asmb.c_str()) == 0) {
+                        std::vector<std::string> cmd_link = SplitCommandLine(ctx.LINK_OPTS);
+                        cmd_link.insert(cmd_link.begin(), link_path);
+                        cmd_link.push_back(ctx.OUTPUT_NAME + ".o");
+
+                        std::string asmb_log;
+                        printf("[CMD]: `%s`\n", JoinCommandLine(cmd_asmb).c_str());
+                        int asmb_result = -1;
+                        {
+                            Corth::PhaseTimer timer(ctx, "Assembler");
+                            asmb_result = RunCommand(cmd_asmb, asmb_log, &timer.peak_rss_kb);
+                        }
+                        if (asmb_result == 0) {
                             Corth::Log("Assembler successful!");
+                            if (ctx.verbose_logging) {
+                                printCommandOutput(asmb_log, "Assembler Log");
+                            }
                         }
                         else {
-                            Corth::Log("Assembler returned non-zero exit code, indicating a failure. Check `assembler-log.txt` for the output of the assembler, or enable verbose logging (`-v` flag) to print output to the console.");
+                            Corth::Log("Assembler returned non-zero exit code, indicating a failure.");
+                            printCommandOutput(asmb_log, "Assembler Log");
                         }
 
-                        printf("[CMD]: `%s`\n", cmd_link.c_str());
-                        if (system(cmd_link.c_str()) == 0) {
+                        std::string link_log;
+                        printf("[CMD]: `%s`\n", JoinCommandLine(cmd_link).c_str());
+                        int link_result = -1;
+                        {
+                            Corth::PhaseTimer timer(ctx, "Linker");
+                            link_result = RunCommand(cmd_link, link_log, &timer.peak_rss_kb);
+                        }
+                        if (link_result == 0) {
                             Corth::Log("Linker successful!");
+                            build_successful = true;
+                            if (ctx.verbose_logging) {
+                                printCommandOutput(link_log, "Linker Log");
+                            }
                         }
                         else {
-                            Corth::Log("Linker returned non-zero exit code, indicating a failure. Check `linker-log.txt` for the output of the linker, or enable verbose logging (`-v` flag) to print output to the console.");
-                        }
-
-                        if (Corth::verbose_logging) {
-                            printCharactersFromFile("assembler-log.txt", "Assembler Log");
-                            printCharactersFromFile("linker-log.txt", "Linker Log");
+                            Corth::Log("Linker returned non-zero exit code, indicating a failure.");
+                            printCommandOutput(link_log, "Linker Log");
                         }
                     }
                     else {
-                        Corth::Error("Linker not found at " + Corth::LINK_PATH + "\n");
+                        Corth::Error("Linker not found at " + ctx.LINK_PATH + "\n");
                         return -1;
                     }
                 }
                 else {
-                    Corth::Error("Assembler not found at " + Corth::ASMB_PATH + "\n");
+                    Corth::Error("Assembler not found at " + ctx.ASMB_PATH + "\n");
                     return -1;
                 }
             }
@@ -3194,6 +9037,112 @@ int main(int argc, char** argv) {
             return -1;
             #endif
         }
+
+        if (!build_successful) {
+            return -1;
+        }
+        if (use_cache) {
+            Corth::CacheStore(ctx, cache_key, Corth::GetExecutablePath(ctx));
+        }
     }
     return 0;
 }
+
+int main(int argc, char** argv) {
+    Corth::Context ctx;
+    // PLATFORM SPECIFIC DEFAULTS
+    #ifdef _WIN64
+    // Defaults assume tools were installed on the same drive as Corth as well as in the root directory of the drive.
+    ctx.ASMB_PATH = "\\NASM\\nasm.exe";
+    ctx.ASMB_OPTS = "-f win64";
+    ctx.LINK_PATH = "\\Golink\\golink.exe";
+    ctx.LINK_OPTS = "/console /ENTRY:main msvcrt.dll";
+    #endif
+
+    #ifdef __linux__
+    ctx.ASMB_PATH = "nasm";
+    ctx.ASMB_OPTS = "-f elf64";
+    ctx.LINK_PATH = "ld";
+    ctx.LINK_OPTS = "-dynamic-linker /lib64/ld-linux-x86-64.so.2 -lc -m elf_x86_64";
+    // If a tool exits early, writing assembly into its pipe must fail instead of killing Corth.
+    signal(SIGPIPE, SIG_IGN);
+    #endif
+    
+    std::vector<std::string> source_paths;
+    unsigned jobs = 0;
+    if (!Corth::HandleCMDLineArgs(ctx, argc, argv, source_paths, jobs)){
+        // Non-graceful handling of command line arguments, abort execution.
+        return -1;
+    }
+
+    if (source_paths.size() == 1) {
+        ctx.SOURCE_PATH = source_paths[0];
+        int result = Compile(ctx);
+        if (ctx.time_phases) {
+            Corth::PrintTimingReport(ctx);
+            if (!ctx.TIME_JSON_PATH.empty()) {
+                Corth::WriteTimingReport(ctx.TIME_JSON_PATH, { ctx });
+            }
+        }
+        return result;
+    }
+
+    /* Batch compilation
+       Every source file is compiled with its own copy of the context,
+       named after the source file so that outputs don't collide. */
+    std::vector<Corth::Context> batch(source_paths.size(), ctx);
+    for (size_t i = 0; i < batch.size(); i++) {
+        Corth::Context& job = batch[i];
+        job.SOURCE_PATH = source_paths[i];
+        job.OUTPUT_NAME = source_paths[i];
+        if (job.OUTPUT_NAME.size() > 6
+            && job.OUTPUT_NAME.compare(job.OUTPUT_NAME.size() - 6, 6, ".corth") == 0)
+        {
+            job.OUTPUT_NAME.erase(job.OUTPUT_NAME.size() - 6);
+        }
+        // Tell the tool that produces the executable where to put it.
+        if (job.RUN_MODE == Corth::MODE::COMPILE && job.ASSEMBLY_SYNTAX == Corth::ASM_SYNTAX::GAS) {
+            job.ASMB_OPTS += " -o " + job.OUTPUT_NAME;
+            if (job.RUN_PLATFORM == Corth::PLATFORM::WIN64) { job.ASMB_OPTS += ".exe"; }
+        }
+        else if (job.RUN_MODE == Corth::MODE::COMPILE && job.RUN_PLATFORM == Corth::PLATFORM::LINUX64) {
+            job.LINK_OPTS += " -o " + job.OUTPUT_NAME;
+        }
+    }
+
+    if (jobs == 0) { jobs = std::max(1u, std::thread::hardware_concurrency()); }
+    jobs = std::min<size_t>(jobs, batch.size());
+    if (ctx.verbose_logging) {
+        Corth::Log("Compiling " + std::to_string(batch.size()) + " files with " + std::to_string(jobs) + " jobs");
+    }
+
+    std::vector<int> results(batch.size(), -1);
+    std::atomic<size_t> next_job { 0 };
+    auto worker = [&]() {
+        for (size_t i = next_job++; i < batch.size(); i = next_job++) {
+            results[i] = Compile(batch[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < jobs; i++) { workers.emplace_back(worker); }
+    worker();
+    for (auto& thread : workers) { thread.join(); }
+
+    if (ctx.time_phases) {
+        for (auto& job : batch) { Corth::PrintTimingReport(job); }
+        if (!ctx.TIME_JSON_PATH.empty()) {
+            Corth::WriteTimingReport(ctx.TIME_JSON_PATH, batch);
+        }
+    }
+
+    size_t failed = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (results[i] != 0) {
+            Corth::Error("Compilation failed: " + batch[i].SOURCE_PATH);
+            failed++;
+        }
+    }
+    Corth::Log("Batch compilation: " + std::to_string(batch.size() - failed) + " succeeded, "
+               + std::to_string(failed) + " failed");
+    return failed == 0 ? 0 : -1;
+}
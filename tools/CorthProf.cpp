@@ -0,0 +1,319 @@
+// Profile report tool
+// Turns the `<output-name>.prof` file written by a program compiled with
+//   `Corth -profile` into a source listing annotated with execution counts.
+// Every line is shown with the count of the basic block its first token is in,
+//   or of a hotter block that starts later on the same line.
+// The `<output-name>.samples` file written by `Corth -sample` is shown the same
+//   way, with the number and share of samples that landed in each line.
+// The `<output-name>.memtrace` file written by `Corth -memtrace` is shown as
+//   the hottest cache lines of `mem`, and every load and store in the source
+//   with the accesses it made.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace CorthProf {
+    struct Block {
+        size_t line;
+        size_t column;
+        // Whether the block begins with the first token on its line.
+        bool starts_line;
+        uint64_t count;
+    };
+
+    struct Profile {
+        std::string source_path;
+        std::vector<Block> blocks;
+        // Set for a `-sample` histogram; blocks are then single tokens, and their count is hits.
+        bool sampled = false;
+        uint64_t outside = 0;
+        // Samples the program's buffer had no room for.
+        uint64_t dropped = 0;
+    };
+
+    struct CacheLine {
+        size_t index;
+        uint64_t reads;
+        uint64_t writes;
+    };
+
+    struct AccessSite {
+        size_t line;
+        size_t column;
+        std::string keyword;
+        uint64_t accesses;
+        // Accesses that touched two cache lines
+        uint64_t split;
+        // Accesses to memory outside of `mem`
+        uint64_t outside;
+        // Range of cache lines touched
+        uint64_t first;
+        uint64_t last;
+    };
+
+    struct MemTrace {
+        std::string source_path;
+        size_t line_size = 64;
+        std::vector<CacheLine> lines;
+        std::vector<AccessSite> sites;
+    };
+
+    std::string ReadHeader(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line);
+        return line;
+    }
+
+    bool LoadMemTrace(const std::string& path, MemTrace& trace) {
+        std::ifstream file(path);
+        if (!file) {
+            printf("[ERR]: Could not open memory trace at %s\n", path.c_str());
+            return false;
+        }
+        std::string line;
+        std::getline(file, line);
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            std::string kind;
+            fields >> kind;
+            if (kind == "source") {
+                trace.source_path = line.substr(7);
+            }
+            else if (kind == "line_size") {
+                fields >> trace.line_size;
+            }
+            else if (kind == "line") {
+                CacheLine cache_line;
+                if (fields >> cache_line.index >> cache_line.reads >> cache_line.writes) {
+                    trace.lines.push_back(cache_line);
+                }
+            }
+            else if (kind == "site") {
+                AccessSite site;
+                if (fields >> site.line >> site.column >> site.keyword >> site.accesses
+                           >> site.split >> site.outside >> site.first >> site.last) {
+                    trace.sites.push_back(site);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool LoadSource(const std::string& path, std::vector<std::string>& lines) {
+        std::ifstream source(path);
+        if (!source) {
+            printf("[ERR]: Could not open source file at %s\n", path.c_str());
+            return false;
+        }
+        std::string text;
+        while (std::getline(source, text)) { lines.push_back(text); }
+        return true;
+    }
+
+    void ReportMemTrace(const MemTrace& trace, const std::vector<std::string>& lines, size_t top) {
+        printf("Memory trace of %s\n", trace.source_path.c_str());
+
+        std::vector<CacheLine> hottest = trace.lines;
+        std::stable_sort(hottest.begin(), hottest.end(), [](const CacheLine& a, const CacheLine& b) {
+            return a.reads + a.writes > b.reads + b.writes;
+        });
+        if (hottest.size() > top) { hottest.resize(top); }
+        printf("\n%zu cache lines of %zu bytes touched; the hottest:\n", trace.lines.size(), trace.line_size);
+        printf("%14s %14s | %s\n", "Reads", "Writes", "Bytes of mem");
+        for (auto& cache_line : hottest) {
+            printf("%14llu %14llu | %zu-%zu\n", (unsigned long long)cache_line.reads, (unsigned long long)cache_line.writes,
+                   cache_line.index * trace.line_size, (cache_line.index + 1) * trace.line_size - 1);
+        }
+
+        printf("\nLoads and stores:\n");
+        printf("%14s %10s %10s | %15s | %9s | %-6s | %s\n", "Accesses", "Split", "Outside", "Cache lines", "Location", "Access", "Source");
+        for (auto& site : trace.sites) {
+            if (site.accesses == 0 && site.outside == 0) { continue; }
+            std::string range = "-";
+            if (site.accesses) { range = std::to_string(site.first) + '-' + std::to_string(site.last); }
+            const char* text = site.line >= 1 && site.line <= lines.size() ? lines[site.line - 1].c_str() : "";
+            std::string location = std::to_string(site.line) + ':' + std::to_string(site.column);
+            printf("%14llu %10llu %10llu | %15s | %9s | %-6s | %s\n", (unsigned long long)site.accesses,
+                   (unsigned long long)site.split, (unsigned long long)site.outside, range.c_str(),
+                   location.c_str(), site.keyword.c_str(), text);
+        }
+    }
+
+    bool LoadProfile(const std::string& path, Profile& profile) {
+        std::ifstream file(path);
+        if (!file) {
+            printf("[ERR]: Could not open profile at %s\n", path.c_str());
+            return false;
+        }
+        std::string line;
+        if (!std::getline(file, line) || (line != "# corth profile" && line != "# corth samples")) {
+            printf("[ERR]: %s is not a Corth profile\n", path.c_str());
+            return false;
+        }
+        profile.sampled = line == "# corth samples";
+        while (std::getline(file, line)) {
+            if (line.compare(0, 7, "source ") == 0) {
+                profile.source_path = line.substr(7);
+                continue;
+            }
+            if (line.compare(0, 8, "outside ") == 0) {
+                profile.outside = strtoull(line.c_str() + 8, nullptr, 10);
+                continue;
+            }
+            if (line.compare(0, 8, "dropped ") == 0) {
+                profile.dropped = strtoull(line.c_str() + 8, nullptr, 10);
+                continue;
+            }
+            std::istringstream fields(line);
+            Block block;
+            if (profile.sampled) {
+                block.starts_line = false;
+                if (fields >> block.line >> block.column >> block.count) {
+                    profile.blocks.push_back(block);
+                }
+            }
+            else if (fields >> block.line >> block.column >> block.starts_line >> block.count) {
+                profile.blocks.push_back(block);
+            }
+        }
+        // Entries are written in program order, which is already source order.
+        std::stable_sort(profile.blocks.begin(), profile.blocks.end(), [](const Block& a, const Block& b) {
+            return a.line < b.line || (a.line == b.line && a.column < b.column);
+        });
+        return true;
+    }
+
+    // Lines that hold nothing but whitespace and comments don't run.
+    bool HasCode(const std::string& line) {
+        size_t start = line.find_first_not_of(" \t\r");
+        return start != std::string::npos && line.compare(start, 2, "//") != 0;
+    }
+
+    void PrintUsage() {
+        printf("\n%s\n", "Usage: `corthprof <program>.prof|<program>.samples|<program>.memtrace [Path/To/Source.corth]`");
+        printf("    %s\n", "Prints the source of a profiled Corth program, with how many times each line ran (`.prof`),");
+        printf("    %s\n", "  or how many samples landed in it and their share of the total (`.samples`).");
+        printf("    %s\n", "For a `.memtrace`, prints the hottest cache lines of `mem` and the accesses of every load and store.");
+        printf("    %s\n", "The source path recorded in the profile is used unless another one is given.");
+        printf("        %s\n", "-t, --top <count>  | How many of the hottest lines (or cache lines) to list. (default: 10)");
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace CorthProf;
+
+    std::vector<std::string> paths;
+    size_t top = 10;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-t" || arg == "--top") && i + 1 < argc) {
+            top = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "-h" || arg == "--help" || arg[0] == '-') {
+            PrintUsage();
+            return arg[0] == '-' && arg != "-h" && arg != "--help";
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty() || paths.size() > 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (ReadHeader(paths[0]) == "# corth memtrace") {
+        MemTrace trace;
+        if (!LoadMemTrace(paths[0], trace)) { return 1; }
+        if (paths.size() == 2) { trace.source_path = paths[1]; }
+        std::vector<std::string> lines;
+        if (!LoadSource(trace.source_path, lines)) { return 1; }
+        ReportMemTrace(trace, lines, top);
+        return 0;
+    }
+
+    Profile profile;
+    if (!LoadProfile(paths[0], profile)) { return 1; }
+    if (paths.size() == 2) { profile.source_path = paths[1]; }
+
+    std::vector<std::string> lines;
+    if (!LoadSource(profile.source_path, lines)) { return 1; }
+
+    std::vector<uint64_t> counts(lines.size(), 0);
+    std::vector<bool> ran(lines.size(), false);
+    uint64_t total = profile.outside;
+    if (profile.sampled) {
+        // Hits of every line: the sum of the hits of its tokens.
+        for (auto& hit : profile.blocks) {
+            if (hit.line == 0 || hit.line > lines.size()) { continue; }
+            counts[hit.line - 1] += hit.count;
+            ran[hit.line - 1] = true;
+            total += hit.count;
+        }
+    }
+    // Count of every line: that of the block its first token is in, or of a hotter block starting on it.
+    size_t block = 0;
+    bool in_block = false;
+    uint64_t current = 0;
+    for (size_t line = 1; line <= lines.size() && !profile.sampled; line++) {
+        bool covered = in_block;
+        uint64_t count = in_block ? current : 0;
+        while (block < profile.blocks.size() && profile.blocks[block].line == line) {
+            if (profile.blocks[block].starts_line) { count = profile.blocks[block].count; }
+            else { count = std::max(count, profile.blocks[block].count); }
+            current = profile.blocks[block].count;
+            covered = in_block = true;
+            block++;
+        }
+        if (covered && HasCode(lines[line - 1])) {
+            counts[line - 1] = count;
+            ran[line - 1] = true;
+        }
+    }
+
+    auto print_line = [&](size_t i) {
+        if (!ran[i]) {
+            printf("%12s | %5zu | %s\n", "-", i + 1, lines[i].c_str());
+        }
+        else if (profile.sampled) {
+            printf("%6llu %4.1f%% | %5zu | %s\n", (unsigned long long)counts[i],
+                   total ? 100.0 * counts[i] / total : 0.0, i + 1, lines[i].c_str());
+        }
+        else {
+            printf("%12llu | %5zu | %s\n", (unsigned long long)counts[i], i + 1, lines[i].c_str());
+        }
+    };
+
+    printf("Profile of %s\n\n", profile.source_path.c_str());
+    for (size_t i = 0; i < lines.size(); i++) { print_line(i); }
+    if (profile.sampled) {
+        printf("\n%llu samples, %llu of them outside of the program's own code (i.e. in the C library)\n",
+               (unsigned long long)total, (unsigned long long)profile.outside);
+        if (profile.dropped) {
+            printf("%llu earlier samples were dropped because the program's sample buffer was full\n",
+                   (unsigned long long)profile.dropped);
+        }
+    }
+
+    std::vector<size_t> hottest;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (ran[i] && counts[i] > 0) { hottest.push_back(i); }
+    }
+    std::stable_sort(hottest.begin(), hottest.end(), [&counts](size_t a, size_t b) {
+        return counts[a] > counts[b];
+    });
+    if (hottest.size() > top) { hottest.resize(top); }
+    if (!hottest.empty()) {
+        printf("\nHottest lines:\n");
+        for (size_t i : hottest) { print_line(i); }
+    }
+    return 0;
+}